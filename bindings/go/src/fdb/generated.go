@@ -81,7 +81,7 @@ func (o NetworkOptions) SetTraceLogGroup(param string) error {
 	return o.setOpt(33, []byte(param))
 }
 
-// Select the format of the log files. xml (the default) and json are supported.
+// Select the format of the log files. xml (the default), json and binary are supported.
 //
 // Parameter: Format of trace files
 func (o NetworkOptions) SetTraceFormat(param string) error {
@@ -373,6 +373,11 @@ func (o DatabaseOptions) SetTransactionBypassUnreadable() error {
 	return o.setOpt(700, nil)
 }
 
+// Allows transactions to use a cached read version that may be a short time old. This sets the ``use_grv_cache`` option of each transaction created by this database. See the transaction option description for more information.
+func (o DatabaseOptions) SetTransactionUseGrvCache() error {
+	return o.setOpt(701, nil)
+}
+
 // Use configuration database.
 func (o DatabaseOptions) SetUseConfigDatabase() error {
 	return o.setOpt(800, nil)
@@ -598,6 +603,11 @@ func (o TransactionOptions) SetBypassUnreadable() error {
 	return o.setOpt(1100, nil)
 }
 
+// The read version may be taken from a cache of recent read versions that the client keeps up to date in the background, instead of being requested from a GRV proxy. The version can be older than the latest committed version by up to the client's GRV_CACHE_MAX_LAG knob, but is never older than a commit this client has completed. Transactions with throttling tags or at batch or immediate priority always request a read version, and so do all transactions while read version requests are being delayed.
+func (o TransactionOptions) SetUseGrvCache() error {
+	return o.setOpt(1101, nil)
+}
+
 type StreamingMode int
 
 const (
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#
+# binary_trace_decoder.py
+#
+# This source file is part of the FoundationDB open source project
+#
+# Copyright 2013-2022 Apple Inc. and the FoundationDB project authors
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Converts trace files written with --trace-format binary to the xml or json trace formats, so that they can be read
+# by TraceLogHelper and the other trace tools. The format is described in flow/BinaryTraceLogFormatter.h.
+#
+# Usage: ./binary_trace_decoder.py trace.1.2.btrace > trace.1.2.xml
+#        ./binary_trace_decoder.py --format json trace.1.2.btrace > trace.1.2.json
+
+import argparse
+import struct
+import sys
+
+HEADER = b'FDBBinaryTrace1\n'
+
+
+class Reader:
+    def __init__(self, data, pos):
+        self.data = data
+        self.pos = pos
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise EOFError()
+        self.pos += 1
+        return self.data[self.pos - 1]
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7f) << shift
+            if not b & 0x80:
+                return value
+            shift += 7
+
+    def bytes(self, n):
+        if self.pos + n > len(self.data):
+            raise EOFError()
+        self.pos += n
+        return self.data[self.pos - n:self.pos]
+
+
+def decode(data):
+    """Yields each event in data as a list of (name, value) byte string pairs."""
+    if not data.startswith(HEADER):
+        raise ValueError('not a binary trace file')
+    strings = []
+    schemas = []
+    r = Reader(data, len(HEADER))
+    try:
+        while r.pos < len(data):
+            record = r.byte()
+            if record == ord('D'):
+                strings.append(r.bytes(r.varint()))
+            elif record == ord('S'):
+                schemas.append([strings[r.varint()] for _ in range(r.varint())])
+            elif record == ord('E'):
+                fields = []
+                for name in schemas[r.varint()]:
+                    tag = r.byte()
+                    if tag == 0:
+                        value = r.bytes(r.varint())
+                    elif tag == 1:
+                        value = strings[r.varint()]
+                    elif tag == 2:
+                        v = r.varint()
+                        value = str((v >> 1) ^ -(v & 1)).encode()
+                    elif tag == 3 or tag == 4:
+                        d = struct.unpack('<d', r.bytes(8))[0]
+                        value = (('%g' if tag == 3 else '%.6f') % d).encode()
+                    else:
+                        raise ValueError('unknown value tag %d at offset %d' % (tag, r.pos - 1))
+                    fields.append((name, value))
+                yield fields
+            else:
+                raise ValueError('unknown record type %d at offset %d' % (record, r.pos - 1))
+    except EOFError:
+        # The last record was cut off, for example because the process died while writing it
+        pass
+
+
+def escape_xml(s):
+    out = bytearray()
+    for c in s:
+        if c == ord('&'):
+            out += b'&amp;'
+        elif c == ord('"'):
+            out += b'&quot;'
+        elif c == ord('<'):
+            out += b'&lt;'
+        elif c == ord('>'):
+            out += b'&gt;'
+        elif c in (ord('\r'), ord('\n'), 0):
+            out += b' '
+        else:
+            out.append(c)
+    return bytes(out)
+
+
+def escape_json(s):
+    out = bytearray()
+    for c in s:
+        if c == ord('"'):
+            out += b'\\"'
+        elif c == ord('\\'):
+            out += b'\\\\'
+        elif c == ord('\n'):
+            out += b'\\n'
+        elif c == ord('\r'):
+            out += b'\\r'
+        elif 0x20 <= c < 0x7f:
+            out.append(c)
+        else:
+            out += b'\\x%02x' % c
+    return bytes(out)
+
+
+def write_xml(events, out):
+    out.write(b'<?xml version="1.0"?>\r\n<Trace>\r\n')
+    for fields in events:
+        out.write(b'<Event ' + b''.join(escape_xml(k) + b'="' + escape_xml(v) + b'" ' for k, v in fields) + b'/>\r\n')
+    out.write(b'</Trace>\r\n')
+
+
+def write_json(events, out):
+    for fields in events:
+        out.write(b'{  ' + b', '.join(b'"' + escape_json(k) + b'": "' + escape_json(v) + b'"' for k, v in fields) +
+                  b' }\r\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a binary trace file to xml or json')
+    parser.add_argument('--format', choices=['xml', 'json'], default='xml')
+    parser.add_argument('path')
+    args = parser.parse_args()
+
+    with open(args.path, 'rb') as f:
+        data = f.read()
+    writer = write_xml if args.format == 'xml' else write_json
+    writer(decode(data), sys.stdout.buffer)
+
+
+if __name__ == '__main__':
+    main()
@@ -27,7 +27,7 @@
 #include "fdbclient/CommitTransaction.h"
 #include "fdbclient/FDBTypes.h"
 
-// file format of actual blob files
+// contents of blob granule files, see BlobGranuleFiles.h for how they are stored
 struct GranuleSnapshot : VectorRef<KeyValueRef> {
 
 	constexpr static FileIdentifier file_identifier = 1300395;
@@ -20,195 +20,628 @@
 
 #include "contrib/fmt-8.0.1/include/fmt/format.h"
 #include "flow/serialize.h"
+#include "fdbclient/Atomic.h"
 #include "fdbclient/BlobGranuleFiles.h"
 #include "fdbclient/SystemData.h" // for allKeys unit test - could remove
 #include "flow/UnitTest.h"
 
 #define BG_READ_DEBUG false
 
-// FIXME: implement actual proper file format for this
-
 // Implements granule file parsing and materialization with normal c++ functions (non-actors) so that this can be used
 // outside the FDB network thread.
 
-static Arena loadSnapshotFile(const StringRef& snapshotData,
-                              KeyRangeRef keyRange,
-                              std::map<KeyRef, ValueRef>& dataMap) {
+// Granule files are made up of a fixed size header, a block index, and key-ordered blocks:
+//
+//   header: magic, format version, file type, index size, and the version range of the deltas in the file
+//   index:  block count, then for each block its first key, offset, length, item count and codec
+//   blocks: snapshot rows, or delta boundaries, with each key prefix-compressed against the previous key in its block
+//
+// Readers binary search the index for the blocks intersecting the range being read, so the bytes fetched and the work
+// done to materialize a range are proportional to the range rather than to the whole granule. Deltas are sorted by key
+// when a file is written, so a read combines the snapshot and all of the delta files with one ordered merge.
 
-	Arena parseArena;
-	GranuleSnapshot snapshot;
-	ObjectReader reader(snapshotData.begin(), Unversioned());
-	reader.deserialize(FileIdentifierFor<GranuleSnapshot>::value, snapshot, parseArena);
-
-	// TODO REMOVE sanity check eventually
-	for (int i = 0; i < snapshot.size() - 1; i++) {
-		if (snapshot[i].key >= snapshot[i + 1].key) {
-			printf("BG SORT ORDER VIOLATION IN SNAPSHOT FILE: '%s', '%s'\n",
-			       snapshot[i].key.printable().c_str(),
-			       snapshot[i + 1].key.printable().c_str());
-		}
-		ASSERT(snapshot[i].key < snapshot[i + 1].key);
-	}
+static const uint32_t granuleFileMagic = 0x46474266;
+static const uint8_t granuleFileFormatVersion = 1;
+static const int granuleFileHeaderSize =
+    sizeof(uint32_t) + 2 * sizeof(uint8_t) + sizeof(uint32_t) + 2 * sizeof(Version);
+
+// A change to one key in key-sorted deltas
+struct DeltaValueRef {
+	Version version;
+	MutationRef::Type type; // SetValue, or ClearRange to clear just this key
+	ValueRef value;
+
+	DeltaValueRef() {}
+	DeltaValueRef(Version version, MutationRef::Type type, ValueRef value)
+	  : version(version), type(type), value(value) {}
+};
 
+// Deltas sorted by key are a list of boundaries. Every key that is set, or that begins or ends a clear, is a boundary
+// holding the changes to exactly that key. No key strictly between two boundaries is written by the deltas, so the gap
+// after a boundary only records whether it was cleared, and the earliest such clear decides that at any read version.
+struct DeltaBoundaryRef {
+	KeyRef key;
+	VectorRef<DeltaValueRef> values; // in version order
+	Version clearAfterVersion = invalidVersion;
+};
+
+// The boundaries of one set of deltas that intersect a key range, and the clear version of the gap the range begins in
+struct SortedDeltas {
+	VectorRef<DeltaBoundaryRef> boundaries;
+	Version clearBeforeFirst = invalidVersion;
+};
+
+static int commonPrefixLength(KeyRef a, KeyRef b) {
+	int n = std::min(a.size(), b.size());
 	int i = 0;
-	while (i < snapshot.size() && snapshot[i].key < keyRange.begin) {
-		/*if (snapshot.size() < 10) { // debug
-		    printf("  Pruning %s < %s\n", snapshot[i].key.printable().c_str(), keyRange.begin.printable().c_str());
-		}*/
+	while (i < n && a[i] == b[i]) {
 		i++;
 	}
-	while (i < snapshot.size() && snapshot[i].key < keyRange.end) {
-		dataMap.insert({ snapshot[i].key, snapshot[i].value });
-		/*if (snapshot.size() < 10) { // debug
-		    printf("  Including %s\n", snapshot[i].key.printable().c_str());
-		}*/
-		i++;
+	return i;
+}
+
+// Sorts the mutations at or below readVersion by key, clipping them to range. The returned boundaries reference keys
+// and values in the deltas' arena.
+//
+// Rather than inserting every mutation into an ordered map, the single key mutations and the clears are collected into
+// flat arrays and sorted once. A sweep over the sorted boundary keys then tracks the clears covering each key, and
+// interleaves them with the key's own mutations in commit order.
+static VectorRef<DeltaBoundaryRef> sortDeltasByKey(Arena& arena,
+                                                   const GranuleDeltas& deltas,
+                                                   KeyRangeRef range,
+                                                   Version readVersion) {
+	// Mutations within a version are applied in the order they were committed, which order records
+	struct PointDelta {
+		KeyRef key;
+		int order;
+		DeltaValueRef change;
+	};
+	struct ClearDelta {
+		KeyRangeRef range;
+		int order;
+		Version version;
+	};
+	std::vector<PointDelta> points;
+	std::vector<ClearDelta> clears;
+	std::vector<KeyRef> keys;
+
+	int order = 0;
+	for (const MutationsAndVersionRef& delta : deltas) {
+		if (delta.version > readVersion) {
+			break;
+		}
+		for (const MutationRef& m : delta.mutations) {
+			order++;
+			if (m.type == MutationRef::ClearRange) {
+				KeyRef begin = std::max(m.param1, range.begin);
+				KeyRef end = std::min(m.param2, range.end);
+				if (begin >= end) {
+					continue;
+				}
+				clears.push_back(ClearDelta{ KeyRangeRef(begin, end), order, delta.version });
+				keys.push_back(begin);
+				keys.push_back(end);
+			} else {
+				// Atomic ops are kept as they are and applied to the value below them when the granule is read
+				ASSERT(isSingleKeyMutation((MutationRef::Type)m.type));
+				if (!range.contains(m.param1)) {
+					continue;
+				}
+				points.push_back(
+				    PointDelta{ m.param1, order, DeltaValueRef(delta.version, (MutationRef::Type)m.type, m.param2) });
+				keys.push_back(m.param1);
+			}
+		}
 	}
-	/*if (snapshot.size() < 10) { // debug
-	    while (i < snapshot.size()) {
-	        printf("  Pruning %s >= %s\n", snapshot[i].key.printable().c_str(), keyRange.end.printable().c_str());
-	        i++;
-	    }
-	}*/
-	if (BG_READ_DEBUG) {
-		fmt::print("Started with {0} rows from snapshot after pruning to [{1} - {2})\n",
-		           dataMap.size(),
-		           keyRange.begin.printable(),
-		           keyRange.end.printable());
+
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+	std::sort(points.begin(), points.end(), [](const PointDelta& a, const PointDelta& b) {
+		return a.key < b.key || (a.key == b.key && a.order < b.order);
+	});
+	std::stable_sort(clears.begin(), clears.end(), [](const ClearDelta& a, const ClearDelta& b) {
+		return a.range.begin < b.range.begin;
+	});
+
+	VectorRef<DeltaBoundaryRef> sorted;
+	sorted.reserve(arena, keys.size());
+	// the clears covering the current key, in commit order
+	std::vector<const ClearDelta*> active;
+	auto point = points.begin();
+	auto clear = clears.begin();
+	for (KeyRef key : keys) {
+		active.erase(std::remove_if(active.begin(),
+		                            active.end(),
+		                            [key](const ClearDelta* c) { return c->range.end <= key; }),
+		             active.end());
+		for (; clear != clears.end() && clear->range.begin == key; ++clear) {
+			const ClearDelta* c = &*clear;
+			active.insert(std::upper_bound(active.begin(),
+			                               active.end(),
+			                               c,
+			                               [](const ClearDelta* a, const ClearDelta* b) { return a->order < b->order; }),
+			              c);
+		}
+
+		DeltaBoundaryRef b;
+		b.key = key;
+		auto pointEnd = point;
+		while (pointEnd != points.end() && pointEnd->key == key) {
+			++pointEnd;
+		}
+		b.values.reserve(arena, (pointEnd - point) + active.size());
+		auto c = active.begin();
+		while (point != pointEnd || c != active.end()) {
+			if (c == active.end() || (point != pointEnd && point->order < (*c)->order)) {
+				b.values.push_back(arena, point->change);
+				++point;
+				continue;
+			}
+			// clearing a key that is already cleared does not change it at any read version
+			if (b.values.empty() || b.values.back().type != MutationRef::ClearRange) {
+				b.values.push_back(arena, DeltaValueRef((*c)->version, MutationRef::ClearRange, ValueRef()));
+			}
+			++c;
+		}
+		// The gap up to the next key is covered by exactly the clears covering this key, the earliest of which decides
+		// it at any read version
+		if (!active.empty()) {
+			b.clearAfterVersion = active.front()->version;
+		}
+		sorted.push_back(arena, b);
 	}
+	return sorted;
+}
 
-	return parseArena;
+// Applies the atomic op change to the value of a key, returning its new value
+static Optional<ValueRef> applyAtomicOp(const Optional<ValueRef>& existing, const DeltaValueRef& change, Arena& arena) {
+	switch (change.type) {
+	case MutationRef::AddValue:
+		return doLittleEndianAdd(existing, change.value, arena);
+	case MutationRef::And:
+		return doAnd(existing, change.value, arena);
+	case MutationRef::AndV2:
+		return doAndV2(existing, change.value, arena);
+	case MutationRef::Or:
+		return doOr(existing, change.value, arena);
+	case MutationRef::Xor:
+		return doXor(existing, change.value, arena);
+	case MutationRef::AppendIfFits:
+		return doAppendIfFits(existing, change.value, arena);
+	case MutationRef::Max:
+		return doMax(existing, change.value, arena);
+	case MutationRef::Min:
+		return doMin(existing, change.value, arena);
+	case MutationRef::MinV2:
+		return doMinV2(existing, change.value, arena);
+	case MutationRef::ByteMin:
+		return doByteMin(existing, change.value, arena);
+	case MutationRef::ByteMax:
+		return doByteMax(existing, change.value, arena);
+	case MutationRef::CompareAndClear:
+		return doCompareAndClear(existing, change.value, arena);
+	default:
+		// versionstamped mutations are rewritten into sets before they reach storage
+		throw unsupported_operation();
+	}
 }
 
-static void applyDelta(KeyRangeRef keyRange, MutationRef m, std::map<KeyRef, ValueRef>& dataMap) {
-	if (m.type == MutationRef::ClearRange) {
-		if (m.param2 <= keyRange.begin || m.param1 >= keyRange.end) {
-			return;
+// Builds a granule file from items added in key order, finishing each block once it reaches the target size
+class GranuleFileWriter {
+public:
+	GranuleFileWriter(BlobGranuleFileType type, int targetBlockBytes)
+	  : type(type), targetBlockBytes(targetBlockBytes), data(Unversioned()) {}
+
+	// Starts an item with the given key, returning the writer for the rest of the item
+	BinaryWriter& addItem(KeyRef key) {
+		ASSERT(key.size() <= std::numeric_limits<uint16_t>::max());
+		if (blockItems > 0 && data.getLength() - blockOffset >= targetBlockBytes) {
+			finishBlock();
 		}
-		// keyRange is inclusive on start, lower_bound is inclusive with the argument, and erase is inclusive for the
-		// begin. So if lower bound didn't find the exact key, we need to go up one so it doesn't erase an extra key
-		// outside the range.
-		std::map<KeyRef, ValueRef>::iterator itStart = dataMap.lower_bound(m.param1);
-		if (itStart != dataMap.end() && itStart->first < m.param1) {
-			itStart++;
+		uint16_t prefixLength = 0;
+		if (blockItems == 0) {
+			blockOffset = data.getLength();
+			blockFirstKey = key;
+		} else {
+			ASSERT(prevKey < key);
+			prefixLength = commonPrefixLength(prevKey, key);
 		}
+		uint16_t suffixLength = key.size() - prefixLength;
+		data << prefixLength << suffixLength;
+		data.serializeBytes(key.begin() + prefixLength, suffixLength);
+		prevKey = key;
+		blockItems++;
+		return data;
+	}
 
-		// keyRange is exclusive on end, lower bound is inclusive with the argument, and erase is exclusive for the end
-		// key. So if lower bound didn't find the exact key, we need to go up one so it doesn't skip the last key it
-		// should erase
-		std::map<KeyRef, ValueRef>::iterator itEnd = dataMap.lower_bound(m.param2);
-		if (itEnd != dataMap.end() && itEnd->first < m.param2) {
-			itEnd++;
-		}
-		dataMap.erase(itStart, itEnd);
-	} else {
-		// We don't need atomics here since eager reads handles it
-		ASSERT(m.type == MutationRef::SetValue);
-		if (m.param1 < keyRange.begin || m.param1 >= keyRange.end) {
-			return;
+	Value finish(Version minVersion, Version maxVersion) {
+		if (blockItems > 0) {
+			finishBlock();
 		}
 
-		std::map<KeyRef, ValueRef>::iterator it = dataMap.find(m.param1);
-		if (it == dataMap.end()) {
-			dataMap.insert({ m.param1, m.param2 });
-		} else {
-			it->second = m.param2;
+		BinaryWriter index(Unversioned());
+		index << (uint32_t)blocks.size();
+		for (const BlobGranuleFileBlockRef& block : blocks) {
+			index << (uint16_t)block.firstKey.size();
+			index.serializeBytes(block.firstKey);
+			index << block.offset << block.length << block.count << (uint8_t)block.codec;
 		}
+
+		BinaryWriter file(Unversioned());
+		file << granuleFileMagic << granuleFileFormatVersion << (uint8_t)type << (uint32_t)index.getLength()
+		     << minVersion << maxVersion;
+		file.serializeBytes(index.getData(), index.getLength());
+		file.serializeBytes(data.getData(), data.getLength());
+		return file.toValue();
 	}
+
+private:
+	void finishBlock() {
+		BlobGranuleFileBlockRef block;
+		block.firstKey = blockFirstKey;
+		block.offset = blockOffset;
+		block.length = data.getLength() - blockOffset;
+		block.count = blockItems;
+		block.codec = BlobGranuleFileCodec::None;
+		blocks.push_back(block);
+		blockItems = 0;
+	}
+
+	BlobGranuleFileType type;
+	int targetBlockBytes;
+	BinaryWriter data;
+	std::vector<BlobGranuleFileBlockRef> blocks;
+	KeyRef blockFirstKey;
+	int blockOffset = 0;
+	int blockItems = 0;
+	KeyRef prevKey;
+};
+
+static void writeValue(BinaryWriter& writer, ValueRef value) {
+	writer << (uint32_t)value.size();
+	writer.serializeBytes(value);
 }
 
-static void applyDeltas(const GranuleDeltas& deltas,
-                        KeyRangeRef keyRange,
-                        Version readVersion,
-                        Version& lastFileEndVersion,
-                        std::map<KeyRef, ValueRef>& dataMap) {
-	if (!deltas.empty()) {
-		// check that consecutive delta file versions are disjoint
-		ASSERT(lastFileEndVersion < deltas.front().version);
+Value serializeSnapshotFile(const GranuleSnapshot& snapshot, int targetBlockBytes) {
+	GranuleFileWriter writer(BlobGranuleFileType::Snapshot, targetBlockBytes);
+	for (const KeyValueRef& kv : snapshot) {
+		writeValue(writer.addItem(kv.key), kv.value);
 	}
-	for (const MutationsAndVersionRef& delta : deltas) {
-		if (delta.version > readVersion) {
-			lastFileEndVersion = readVersion;
-			return;
-		}
-		for (auto& m : delta.mutations) {
-			applyDelta(keyRange, m, dataMap);
+	return writer.finish(invalidVersion, invalidVersion);
+}
+
+Value serializeDeltaFile(const GranuleDeltas& deltas, KeyRangeRef fileRange, int targetBlockBytes) {
+	Arena arena;
+	VectorRef<DeltaBoundaryRef> boundaries = sortDeltasByKey(arena, deltas, fileRange, MAX_VERSION);
+
+	GranuleFileWriter writer(BlobGranuleFileType::Delta, targetBlockBytes);
+	for (const DeltaBoundaryRef& boundary : boundaries) {
+		BinaryWriter& item = writer.addItem(boundary.key);
+		item << boundary.clearAfterVersion << (uint32_t)boundary.values.size();
+		for (const DeltaValueRef& v : boundary.values) {
+			item << v.version << (uint8_t)v.type;
+			if (v.type != MutationRef::ClearRange) {
+				writeValue(item, v.value);
+			}
 		}
 	}
-	if (!deltas.empty()) {
-		lastFileEndVersion = deltas.back().version;
+	return deltas.empty() ? writer.finish(invalidVersion, invalidVersion)
+	                      : writer.finish(deltas.front().version, deltas.back().version);
+}
+
+// Reads the fixed size header of a granule file into index, returning the size of the index that follows it
+static uint32_t readFileHeader(BinaryReader& reader, BlobGranuleFileIndexRef& index) {
+	uint32_t magic;
+	uint8_t formatVersion;
+	uint8_t type;
+	uint32_t indexSize;
+	reader >> magic >> formatVersion >> type >> indexSize >> index.minVersion >> index.maxVersion;
+	if (magic != granuleFileMagic || formatVersion != granuleFileFormatVersion) {
+		throw unsupported_format_version();
 	}
+	index.type = (BlobGranuleFileType)type;
+	index.dataOffset = granuleFileHeaderSize + indexSize;
+	return indexSize;
 }
 
-static Arena loadDeltaFile(StringRef deltaData,
-                           KeyRangeRef keyRange,
-                           Version readVersion,
-                           Version& lastFileEndVersion,
-                           std::map<KeyRef, ValueRef>& dataMap) {
-	Arena parseArena;
-	GranuleDeltas deltas;
-	ObjectReader reader(deltaData.begin(), Unversioned());
-	reader.deserialize(FileIdentifierFor<GranuleDeltas>::value, deltas, parseArena);
+int64_t blobGranuleFileIndexSize(StringRef filePrefix) {
+	BlobGranuleFileIndexRef index;
+	BinaryReader reader(filePrefix, Unversioned());
+	readFileHeader(reader, index);
+	return index.dataOffset;
+}
+
+BlobGranuleFileIndexRef parseBlobGranuleFileIndex(Arena& arena, StringRef filePrefix) {
+	BlobGranuleFileIndexRef index;
+	BinaryReader reader(filePrefix, Unversioned());
+	readFileHeader(reader, index);
+	ASSERT(filePrefix.size() >= index.dataOffset);
+
+	uint32_t blockCount;
+	reader >> blockCount;
+	index.blocks.reserve(arena, blockCount);
+	for (int i = 0; i < blockCount; i++) {
+		BlobGranuleFileBlockRef block;
+		uint16_t keyLength;
+		uint8_t codec;
+		reader >> keyLength;
+		block.firstKey = KeyRef((const uint8_t*)reader.readBytes(keyLength), keyLength);
+		reader >> block.offset >> block.length >> block.count >> codec;
+		block.codec = (BlobGranuleFileCodec)codec;
+		index.blocks.push_back(arena, block);
+	}
+	return index;
+}
+
+std::pair<int, int> BlobGranuleFileIndexRef::blocksFor(KeyRangeRef range) const {
+	// the first block that may hold range.begin is the last one starting at or before it
+	const BlobGranuleFileBlockRef* begin =
+	    std::upper_bound(blocks.begin(), blocks.end(), range.begin, [](KeyRef key, const BlobGranuleFileBlockRef& b) {
+		    return key < b.firstKey;
+	    });
+	if (begin != blocks.begin()) {
+		--begin;
+	}
+	const BlobGranuleFileBlockRef* end =
+	    std::lower_bound(begin, blocks.end(), range.end, [](const BlobGranuleFileBlockRef& b, KeyRef key) {
+		    return b.firstKey < key;
+	    });
+	return { begin - blocks.begin(), end - blocks.begin() };
+}
+
+std::pair<int64_t, int64_t> BlobGranuleFileIndexRef::blockSpan(KeyRangeRef range) const {
+	auto [begin, end] = blocksFor(range);
+	if (begin == end) {
+		return { dataOffset, dataOffset };
+	}
+	return { dataOffset + blocks[begin].offset, dataOffset + blocks[end - 1].offset + blocks[end - 1].length };
+}
 
+GranuleFileView::GranuleFileView(StringRef fileData) : data(fileData) {
+	index = parseBlobGranuleFileIndex(arena, fileData);
+}
+
+static StringRef getBlock(const GranuleFileView& file, int blockIdx) {
+	const BlobGranuleFileBlockRef& block = file.index.blocks[blockIdx];
+	if (block.codec != BlobGranuleFileCodec::None) {
+		throw unsupported_format_version();
+	}
+	int64_t offset = file.index.dataOffset + block.offset - file.dataFileOffset;
+	ASSERT(offset >= 0 && offset + block.length <= file.data.size());
+	return file.data.substr(offset, block.length);
+}
+
+// Reads the items of one block, undoing the key prefix compression. Keys that share no prefix with the previous key,
+// and all values, reference the block's memory directly.
+class GranuleBlockReader {
+public:
+	explicit GranuleBlockReader(StringRef block) : reader(block, Unversioned()) {}
+
+	KeyRef readKey(Arena& arena) {
+		uint16_t prefixLength;
+		uint16_t suffixLength;
+		reader >> prefixLength >> suffixLength;
+		const uint8_t* suffix = (const uint8_t*)reader.readBytes(suffixLength);
+		if (prefixLength == 0) {
+			prevKey = KeyRef(suffix, suffixLength);
+		} else {
+			ASSERT(prefixLength <= prevKey.size());
+			uint8_t* key = new (arena) uint8_t[prefixLength + suffixLength];
+			memcpy(key, prevKey.begin(), prefixLength);
+			memcpy(key + prefixLength, suffix, suffixLength);
+			prevKey = KeyRef(key, prefixLength + suffixLength);
+		}
+		return prevKey;
+	}
+
+	ValueRef readValue() {
+		uint32_t length;
+		reader >> length;
+		return ValueRef((const uint8_t*)reader.readBytes(length), length);
+	}
+
+	BinaryReader reader;
+
+private:
+	KeyRef prevKey;
+};
+
+static VectorRef<KeyValueRef> readSnapshotRows(Arena& arena, const GranuleFileView& file, KeyRangeRef keyRange) {
+	ASSERT(file.index.type == BlobGranuleFileType::Snapshot);
+	VectorRef<KeyValueRef> rows;
+	auto [beginBlock, endBlock] = file.index.blocksFor(keyRange);
+	for (int b = beginBlock; b < endBlock; b++) {
+		GranuleBlockReader reader(getBlock(file, b));
+		for (int i = 0; i < file.index.blocks[b].count; i++) {
+			KeyRef key = reader.readKey(arena);
+			ValueRef value = reader.readValue();
+			if (key >= keyRange.end) {
+				return rows;
+			}
+			if (key >= keyRange.begin) {
+				rows.push_back(arena, KeyValueRef(key, value));
+			}
+		}
+	}
 	if (BG_READ_DEBUG) {
-		fmt::print("Parsed {}} deltas from file\n", deltas.size());
+		fmt::print("Started with {0} rows from snapshot after pruning to [{1} - {2})\n",
+		           rows.size(),
+		           keyRange.begin.printable(),
+		           keyRange.end.printable());
 	}
+	return rows;
+}
 
-	// TODO REMOVE sanity check
-	for (int i = 0; i < deltas.size() - 1; i++) {
-		if (deltas[i].version > deltas[i + 1].version) {
-			fmt::print(
-			    "BG VERSION ORDER VIOLATION IN DELTA FILE: '{0}', '{1}'\n", deltas[i].version, deltas[i + 1].version);
+static SortedDeltas readDeltaBoundaries(Arena& arena, const GranuleFileView& file, KeyRangeRef keyRange) {
+	ASSERT(file.index.type == BlobGranuleFileType::Delta);
+	SortedDeltas deltas;
+	auto [beginBlock, endBlock] = file.index.blocksFor(keyRange);
+	for (int b = beginBlock; b < endBlock; b++) {
+		GranuleBlockReader reader(getBlock(file, b));
+		for (int i = 0; i < file.index.blocks[b].count; i++) {
+			DeltaBoundaryRef boundary;
+			uint32_t valueCount;
+			boundary.key = reader.readKey(arena);
+			reader.reader >> boundary.clearAfterVersion >> valueCount;
+			if (boundary.key >= keyRange.end) {
+				return deltas;
+			}
+			bool inRange = boundary.key >= keyRange.begin;
+			if (inRange) {
+				boundary.values.reserve(arena, valueCount);
+			}
+			for (int v = 0; v < valueCount; v++) {
+				DeltaValueRef value;
+				uint8_t type;
+				reader.reader >> value.version >> type;
+				value.type = (MutationRef::Type)type;
+				if (value.type != MutationRef::ClearRange) {
+					value.value = reader.readValue();
+				}
+				if (inRange) {
+					boundary.values.push_back(arena, value);
+				}
+			}
+			if (inRange) {
+				deltas.boundaries.push_back(arena, boundary);
+			} else {
+				deltas.clearBeforeFirst = boundary.clearAfterVersion;
+			}
 		}
-		ASSERT(deltas[i].version <= deltas[i + 1].version);
+	}
+	return deltas;
+}
+
+// Merges the snapshot rows with each set of sorted deltas, oldest first, in one ordered pass over all of them. The
+// number of delta sets is bounded by the number of delta files between snapshots, so the next key is found with a
+// linear scan over the sources.
+static RangeResult mergeSortedDeltas(Arena& arena,
+                                     VectorRef<KeyValueRef> snapshotRows,
+                                     const std::vector<SortedDeltas>& deltas,
+                                     Version readVersion) {
+	struct Cursor {
+		const VectorRef<DeltaBoundaryRef>* boundaries;
+		int idx = 0;
+		Version gapClearVersion;
+	};
+	std::vector<Cursor> cursors;
+	cursors.reserve(deltas.size());
+	for (const SortedDeltas& d : deltas) {
+		cursors.push_back(Cursor{ &d.boundaries, 0, d.clearBeforeFirst });
 	}
 
-	applyDeltas(deltas, keyRange, readVersion, lastFileEndVersion, dataMap);
-	return parseArena;
+	RangeResult result;
+	int snapshotIdx = 0;
+	loop {
+		const KeyRef* nextKey = snapshotIdx < snapshotRows.size() ? &snapshotRows[snapshotIdx].key : nullptr;
+		for (const Cursor& c : cursors) {
+			if (c.idx < c.boundaries->size() && (!nextKey || (*c.boundaries)[c.idx].key < *nextKey)) {
+				nextKey = &(*c.boundaries)[c.idx].key;
+			}
+		}
+		if (!nextKey) {
+			break;
+		}
+		KeyRef key = *nextKey;
+
+		Optional<ValueRef> value;
+		if (snapshotIdx < snapshotRows.size() && snapshotRows[snapshotIdx].key == key) {
+			value = snapshotRows[snapshotIdx].value;
+			snapshotIdx++;
+		}
+		for (Cursor& c : cursors) {
+			if (c.idx < c.boundaries->size() && (*c.boundaries)[c.idx].key == key) {
+				const DeltaBoundaryRef& boundary = (*c.boundaries)[c.idx];
+				// The last set or clear at or before the read version replaces the value, and the atomic ops after it
+				// are applied on top. Without one, they apply to the value from the older sources.
+				int last = boundary.values.size() - 1;
+				while (last >= 0 && boundary.values[last].version > readVersion) {
+					last--;
+				}
+				int base = last;
+				while (base >= 0 && isAtomicOp(boundary.values[base].type)) {
+					base--;
+				}
+				if (base >= 0) {
+					if (boundary.values[base].type == MutationRef::ClearRange) {
+						value.reset();
+					} else {
+						value = boundary.values[base].value;
+					}
+				}
+				for (int v = base + 1; v <= last; v++) {
+					value = applyAtomicOp(value, boundary.values[v], arena);
+				}
+				c.gapClearVersion = boundary.clearAfterVersion;
+				c.idx++;
+			} else if (c.gapClearVersion != invalidVersion && c.gapClearVersion <= readVersion) {
+				value.reset();
+			}
+		}
+
+		if (value.present()) {
+			result.push_back_deep(result.arena(), KeyValueRef(key, value.get()));
+		}
+	}
+	return result;
 }
 
 RangeResult materializeBlobGranule(const BlobGranuleChunkRef& chunk,
                                    KeyRangeRef keyRange,
                                    Version readVersion,
-                                   Optional<StringRef> snapshotData,
-                                   StringRef deltaFileData[]) {
+                                   const GranuleFileView& snapshotFile,
+                                   const GranuleFileView deltaFiles[]) {
 	// TODO REMOVE with V2 of protocol
 	ASSERT(readVersion == chunk.includedVersion);
 	ASSERT(chunk.snapshotFile.present());
-	ASSERT(snapshotData.present());
 
-	// Arena to hold all allocations for applying deltas. Most of it, and the arenas produced by reading the files,
-	// will likely be tossed if there are a significant number of mutations, so we copy at the end instead of doing a
-	// dependsOn.
-	// FIXME: probably some threshold of a small percentage of the data is actually changed, where it makes sense to
-	// just to dependsOn instead of copy, to use a little extra memory footprint to help cpu?
+	// Arena for everything decoded from the files. Only the rows in the result are copied out of it, so decoding
+	// garbage and the file data are released once the result is built.
 	Arena arena;
-	std::map<KeyRef, ValueRef> dataMap;
-	Version lastFileEndVersion = invalidVersion;
-
-	if (snapshotData.present()) {
-		Arena snapshotArena = loadSnapshotFile(snapshotData.get(), keyRange, dataMap);
-		arena.dependsOn(snapshotArena);
-	}
+	VectorRef<KeyValueRef> snapshotRows = readSnapshotRows(arena, snapshotFile, keyRange);
 
 	if (BG_READ_DEBUG) {
 		fmt::print("Applying {} delta files\n", chunk.deltaFiles.size());
 	}
+	std::vector<SortedDeltas> deltas;
+	deltas.reserve(chunk.deltaFiles.size() + 1);
+	Version lastFileEndVersion = invalidVersion;
 	for (int deltaIdx = 0; deltaIdx < chunk.deltaFiles.size(); deltaIdx++) {
-		Arena deltaArena = loadDeltaFile(deltaFileData[deltaIdx], keyRange, readVersion, lastFileEndVersion, dataMap);
-		arena.dependsOn(deltaArena);
+		const BlobGranuleFileIndexRef& index = deltaFiles[deltaIdx].index;
+		if (index.minVersion != invalidVersion) {
+			// check that consecutive delta file versions are disjoint
+			ASSERT(lastFileEndVersion < index.minVersion);
+			lastFileEndVersion = std::min(index.maxVersion, readVersion);
+		}
+		deltas.push_back(readDeltaBoundaries(arena, deltaFiles[deltaIdx], keyRange));
 	}
+
 	if (BG_READ_DEBUG) {
 		fmt::print("Applying {} memory deltas\n", chunk.newDeltas.size());
 	}
-	applyDeltas(chunk.newDeltas, keyRange, readVersion, lastFileEndVersion, dataMap);
-
-	RangeResult ret;
-	for (auto& it : dataMap) {
-		ret.push_back_deep(ret.arena(), KeyValueRef(it.first, it.second));
+	if (!chunk.newDeltas.empty()) {
+		ASSERT(lastFileEndVersion < chunk.newDeltas.front().version);
+		SortedDeltas memoryDeltas;
+		memoryDeltas.boundaries = sortDeltasByKey(arena, chunk.newDeltas, keyRange, readVersion);
+		deltas.push_back(memoryDeltas);
 	}
 
-	return ret;
+	return mergeSortedDeltas(arena, snapshotRows, deltas, readVersion);
+}
+
+RangeResult materializeBlobGranule(const BlobGranuleChunkRef& chunk,
+                                   KeyRangeRef keyRange,
+                                   Version readVersion,
+                                   Optional<StringRef> snapshotData,
+                                   StringRef deltaFileData[]) {
+	ASSERT(snapshotData.present());
+	GranuleFileView snapshotFile(snapshotData.get());
+	std::vector<GranuleFileView> deltaFiles;
+	deltaFiles.reserve(chunk.deltaFiles.size());
+	for (int deltaIdx = 0; deltaIdx < chunk.deltaFiles.size(); deltaIdx++) {
+		deltaFiles.emplace_back(deltaFileData[deltaIdx]);
+	}
+	return materializeBlobGranule(chunk, keyRange, readVersion, snapshotFile, deltaFiles.data());
 }
 
 ErrorOr<RangeResult> loadAndMaterializeBlobGranules(const Standalone<VectorRef<BlobGranuleChunkRef>>& files,
@@ -278,8 +711,39 @@ ErrorOr<RangeResult> loadAndMaterializeBlobGranules(const Standalone<VectorRef<B
 	}
 }
 
-// FIXME: re-enable test!
-TEST_CASE(":/blobgranule/files/applyDelta") {
+// Applies m to data the way a granule read would: data is written as a snapshot file and m as a delta file, and the
+// part of data within keyRange is replaced with the materialized rows.
+static void testApplyDelta(Arena& a, KeyRangeRef keyRange, MutationRef m, std::map<KeyRef, ValueRef>& data) {
+	GranuleSnapshot snapshot;
+	for (auto& it : data) {
+		snapshot.push_back(a, KeyValueRef(it.first, it.second));
+	}
+	GranuleDeltas deltas;
+	MutationsAndVersionRef delta(1, 1);
+	delta.mutations.push_back(a, m);
+	deltas.push_back(a, delta);
+
+	Value snapshotData = serializeSnapshotFile(snapshot, 16);
+	Value deltaData = serializeDeltaFile(deltas, allKeys, 16);
+	a.dependsOn(snapshotData.arena());
+	a.dependsOn(deltaData.arena());
+
+	BlobGranuleChunkRef chunk;
+	chunk.keyRange = allKeys;
+	chunk.includedVersion = 1;
+	chunk.snapshotFile = BlobFilePointerRef(a, "snapshot", 0, snapshotData.size());
+	chunk.deltaFiles.push_back(a, BlobFilePointerRef(a, "delta", 0, deltaData.size()));
+	StringRef deltaFileData[] = { deltaData };
+	RangeResult result = materializeBlobGranule(chunk, keyRange, 1, Optional<StringRef>(snapshotData), deltaFileData);
+	a.dependsOn(result.arena());
+
+	data.erase(data.lower_bound(keyRange.begin), data.lower_bound(keyRange.end));
+	for (auto& kv : result) {
+		data.insert({ kv.key, kv.value });
+	}
+}
+
+TEST_CASE("/blobgranule/files/applyDelta") {
 	printf("Testing blob granule delta applying\n");
 	Arena a;
 
@@ -316,56 +780,56 @@ TEST_CASE(":/blobgranule/files/applyDelta") {
 	MutationRef mClearEverything(MutationRef::ClearRange, allKeys.begin, allKeys.end);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearEverything, data);
+	testApplyDelta(a, allKeys, mClearEverything, data);
 	correctData.clear();
 	ASSERT(data == correctData);
 
 	MutationRef mClearEverything2(MutationRef::ClearRange, allKeys.begin, k_c);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearEverything2, data);
+	testApplyDelta(a, allKeys, mClearEverything2, data);
 	correctData.clear();
 	ASSERT(data == correctData);
 
 	MutationRef mClearEverything3(MutationRef::ClearRange, k_a, allKeys.end);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearEverything3, data);
+	testApplyDelta(a, allKeys, mClearEverything3, data);
 	correctData.clear();
 	ASSERT(data == correctData);
 
 	MutationRef mClearEverything4(MutationRef::ClearRange, k_a, k_c);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearEverything, data);
+	testApplyDelta(a, allKeys, mClearEverything, data);
 	correctData.clear();
 	ASSERT(data == correctData);
 
 	MutationRef mClearFirst(MutationRef::ClearRange, k_a, k_ab);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearFirst, data);
+	testApplyDelta(a, allKeys, mClearFirst, data);
 	correctData.erase(k_a);
 	ASSERT(data == correctData);
 
 	MutationRef mClearSecond(MutationRef::ClearRange, k_ab, k_b);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearSecond, data);
+	testApplyDelta(a, allKeys, mClearSecond, data);
 	correctData.erase(k_ab);
 	ASSERT(data == correctData);
 
 	MutationRef mClearThird(MutationRef::ClearRange, k_b, k_c);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearThird, data);
+	testApplyDelta(a, allKeys, mClearThird, data);
 	correctData.erase(k_b);
 	ASSERT(data == correctData);
 
 	MutationRef mClearFirst2(MutationRef::ClearRange, k_a, k_b);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearFirst2, data);
+	testApplyDelta(a, allKeys, mClearFirst2, data);
 	correctData.erase(k_a);
 	correctData.erase(k_ab);
 	ASSERT(data == correctData);
@@ -373,7 +837,7 @@ TEST_CASE(":/blobgranule/files/applyDelta") {
 	MutationRef mClearLast2(MutationRef::ClearRange, k_ab, k_c);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mClearLast2, data);
+	testApplyDelta(a, allKeys, mClearLast2, data);
 	correctData.erase(k_ab);
 	correctData.erase(k_b);
 	ASSERT(data == correctData);
@@ -382,28 +846,28 @@ TEST_CASE(":/blobgranule/files/applyDelta") {
 	MutationRef mSetA(MutationRef::SetValue, k_a, val2);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mSetA, data);
+	testApplyDelta(a, allKeys, mSetA, data);
 	correctData[k_a] = val2;
 	ASSERT(data == correctData);
 
 	MutationRef mSetAB(MutationRef::SetValue, k_ab, val2);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mSetAB, data);
+	testApplyDelta(a, allKeys, mSetAB, data);
 	correctData[k_ab] = val2;
 	ASSERT(data == correctData);
 
 	MutationRef mSetB(MutationRef::SetValue, k_b, val2);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mSetB, data);
+	testApplyDelta(a, allKeys, mSetB, data);
 	correctData[k_b] = val2;
 	ASSERT(data == correctData);
 
 	MutationRef mSetC(MutationRef::SetValue, k_c, val2);
 	data = originalData;
 	correctData = originalData;
-	applyDelta(allKeys, mSetC, data);
+	testApplyDelta(a, allKeys, mSetC, data);
 	correctData[k_c] = val2;
 	ASSERT(data == correctData);
 
@@ -411,17 +875,156 @@ TEST_CASE(":/blobgranule/files/applyDelta") {
 
 	MutationRef mSetZ(MutationRef::SetValue, k_z, val2);
 	data = originalData;
-	applyDelta(KeyRangeRef(k_a, k_c), mSetZ, data);
+	testApplyDelta(a, KeyRangeRef(k_a, k_c), mSetZ, data);
 	ASSERT(data == originalData);
 
-	applyDelta(KeyRangeRef(k_ab, k_c), mSetA, data);
+	testApplyDelta(a, KeyRangeRef(k_ab, k_c), mSetA, data);
 	ASSERT(data == originalData);
 
-	applyDelta(KeyRangeRef(k_ab, k_c), mClearFirst, data);
+	testApplyDelta(a, KeyRangeRef(k_ab, k_c), mClearFirst, data);
 	ASSERT(data == originalData);
 
-	applyDelta(KeyRangeRef(k_a, k_ab), mClearThird, data);
+	testApplyDelta(a, KeyRangeRef(k_a, k_ab), mClearThird, data);
 	ASSERT(data == originalData);
 
 	return Void();
-}
\ No newline at end of file
+}
+
+// Builds the view of a file that a reader fetching only the blocks for range would have
+static GranuleFileView testPartialView(StringRef fileData, KeyRangeRef range) {
+	GranuleFileView view;
+	view.index = parseBlobGranuleFileIndex(view.arena, fileData.substr(0, blobGranuleFileIndexSize(fileData)));
+	std::pair<int64_t, int64_t> span = view.index.blockSpan(range);
+	view.data = fileData.substr(span.first, span.second - span.first);
+	view.dataFileOffset = span.first;
+	return view;
+}
+
+static KeyRef randomTestKey(Arena& a) {
+	// short keys over a small alphabet, so keys share prefixes and deltas overlap the snapshot and each other
+	std::string key;
+	int length = deterministicRandom()->randomInt(1, 5);
+	for (int i = 0; i < length; i++) {
+		key += (char)('a' + deterministicRandom()->randomInt(0, 4));
+	}
+	return StringRef(a, key);
+}
+
+static void testApplyMutation(Arena& a, MutationRef m, std::map<KeyRef, ValueRef>& data) {
+	if (m.type == MutationRef::ClearRange) {
+		if (m.param1 < m.param2) {
+			data.erase(data.lower_bound(m.param1), data.lower_bound(m.param2));
+		}
+	} else if (m.type == MutationRef::SetValue) {
+		data[m.param1] = m.param2;
+	} else {
+		auto it = data.find(m.param1);
+		Optional<ValueRef> existing = it != data.end() ? it->second : Optional<ValueRef>();
+		Optional<ValueRef> result = applyAtomicOp(existing, DeltaValueRef(0, (MutationRef::Type)m.type, m.param2), a);
+		if (result.present()) {
+			data[m.param1] = result.get();
+		} else {
+			data.erase(m.param1);
+		}
+	}
+}
+
+static MutationRef::Type randomTestAtomicOp() {
+	const MutationRef::Type types[] = { MutationRef::AddValue,     MutationRef::Or,      MutationRef::Xor,
+		                                MutationRef::AppendIfFits, MutationRef::Max,     MutationRef::ByteMin,
+		                                MutationRef::AndV2,        MutationRef::MinV2,   MutationRef::CompareAndClear };
+	return types[deterministicRandom()->randomInt(0, sizeof(types) / sizeof(types[0]))];
+}
+
+TEST_CASE("/blobgranule/files/materializeRandom") {
+	for (int iteration = 0; iteration < 100; iteration++) {
+		Arena a;
+		std::map<KeyRef, ValueRef> expected;
+		int rowCount = deterministicRandom()->randomInt(0, 100);
+		for (int i = 0; i < rowCount; i++) {
+			expected[randomTestKey(a)] = StringRef(a, deterministicRandom()->randomAlphaNumeric(10));
+		}
+		GranuleSnapshot snapshot;
+		for (auto& it : expected) {
+			snapshot.push_back(a, KeyValueRef(it.first, it.second));
+		}
+		int targetBlockBytes = deterministicRandom()->randomInt(1, 200);
+		Value snapshotData = serializeSnapshotFile(snapshot, targetBlockBytes);
+
+		// the last set of deltas is kept in memory instead of being written to a file
+		int deltaFileCount = deterministicRandom()->randomInt(0, 4);
+		std::vector<GranuleDeltas> deltaSets;
+		Version version = 0;
+		for (int f = 0; f <= deltaFileCount; f++) {
+			GranuleDeltas deltas;
+			int versionCount = deterministicRandom()->randomInt(0, 4);
+			for (int v = 0; v < versionCount; v++) {
+				version += deterministicRandom()->randomInt(1, 3);
+				MutationsAndVersionRef delta(version, version);
+				int mutationCount = deterministicRandom()->randomInt(1, 5);
+				for (int m = 0; m < mutationCount; m++) {
+					KeyRef k1 = randomTestKey(a);
+					if (deterministicRandom()->random01() < 0.3) {
+						KeyRef k2 = randomTestKey(a);
+						delta.mutations.push_back(
+						    a, MutationRef(MutationRef::ClearRange, std::min(k1, k2), std::max(k1, k2)));
+					} else {
+						StringRef value(a, deterministicRandom()->randomAlphaNumeric(5));
+						MutationRef::Type type =
+						    deterministicRandom()->random01() < 0.3 ? randomTestAtomicOp() : MutationRef::SetValue;
+						delta.mutations.push_back(a, MutationRef(type, k1, value));
+					}
+				}
+				deltas.push_back(a, delta);
+			}
+			deltaSets.push_back(deltas);
+		}
+		Version readVersion = deterministicRandom()->randomInt(0, version + 1);
+		for (const GranuleDeltas& deltas : deltaSets) {
+			for (const MutationsAndVersionRef& delta : deltas) {
+				if (delta.version <= readVersion) {
+					for (const MutationRef& m : delta.mutations) {
+						testApplyMutation(a, m, expected);
+					}
+				}
+			}
+		}
+
+		KeyRef k1 = randomTestKey(a);
+		KeyRef k2 = randomTestKey(a);
+		KeyRangeRef readRange = deterministicRandom()->random01() < 0.2 ? normalKeys
+		                                                                : KeyRangeRef(std::min(k1, k2), std::max(k1, k2));
+
+		BlobGranuleChunkRef chunk;
+		chunk.keyRange = normalKeys;
+		chunk.includedVersion = readVersion;
+		chunk.snapshotFile = BlobFilePointerRef(a, "snapshot", 0, snapshotData.size());
+		std::vector<Value> deltaData;
+		std::vector<StringRef> deltaDataRefs;
+		std::vector<GranuleFileView> partialDeltaFiles;
+		for (int f = 0; f < deltaFileCount; f++) {
+			deltaData.push_back(serializeDeltaFile(deltaSets[f], chunk.keyRange, targetBlockBytes));
+			chunk.deltaFiles.push_back(a, BlobFilePointerRef(a, "delta", 0, deltaData.back().size()));
+		}
+		for (int f = 0; f < deltaFileCount; f++) {
+			deltaDataRefs.push_back(deltaData[f]);
+			partialDeltaFiles.push_back(testPartialView(deltaData[f], readRange));
+		}
+		chunk.newDeltas = deltaSets.back();
+
+		RangeResult expectedRows;
+		for (auto it = expected.lower_bound(readRange.begin); it != expected.end() && it->first < readRange.end; ++it) {
+			expectedRows.push_back_deep(expectedRows.arena(), KeyValueRef(it->first, it->second));
+		}
+
+		RangeResult fromFiles = materializeBlobGranule(
+		    chunk, readRange, readVersion, Optional<StringRef>(snapshotData), deltaDataRefs.data());
+		ASSERT(fromFiles == expectedRows);
+
+		RangeResult fromBlocks = materializeBlobGranule(
+		    chunk, readRange, readVersion, testPartialView(snapshotData, readRange), partialDeltaFiles.data());
+		ASSERT(fromBlocks == expectedRows);
+	}
+
+	return Void();
+}
@@ -25,6 +25,62 @@
 
 #include "fdbclient/BlobGranuleCommon.h"
 
+enum class BlobGranuleFileType : uint8_t { Snapshot = 0, Delta = 1 };
+
+// Per-block compression codec recorded in a granule file's index. Only uncompressed blocks are produced today, but
+// readers check the codec of every block so compressed blocks can be introduced without a format version change.
+enum class BlobGranuleFileCodec : uint8_t { None = 0 };
+
+struct BlobGranuleFileBlockRef {
+	KeyRef firstKey;
+	int64_t offset; // relative to the end of the index
+	int32_t length;
+	int32_t count; // rows in a snapshot block, boundaries in a delta block
+	BlobGranuleFileCodec codec;
+};
+
+// The header and block index of a granule file
+struct BlobGranuleFileIndexRef {
+	BlobGranuleFileType type;
+	// version range of the mutations in a delta file, invalidVersion if the file has none
+	Version minVersion;
+	Version maxVersion;
+	// size of the header and index, which is also the file offset of the first block
+	int64_t dataOffset;
+	VectorRef<BlobGranuleFileBlockRef> blocks;
+
+	// Returns the indexes [begin, end) of the blocks which may contain keys in range
+	std::pair<int, int> blocksFor(KeyRangeRef range) const;
+
+	// Returns the byte range [begin, end) of the file, relative to its start, holding every block that may contain
+	// keys in range
+	std::pair<int64_t, int64_t> blockSpan(KeyRangeRef range) const;
+};
+
+// Returns the number of bytes at the start of a granule file that must be read to parse its header and index. The
+// prefix must contain at least the fixed size header.
+int64_t blobGranuleFileIndexSize(StringRef filePrefix);
+
+BlobGranuleFileIndexRef parseBlobGranuleFileIndex(Arena& arena, StringRef filePrefix);
+
+// A parsed granule file, or the part of one needed to read a key range: its index, plus a contiguous window of the
+// file that holds the blocks being read.
+struct GranuleFileView {
+	Arena arena;
+	BlobGranuleFileIndexRef index;
+	StringRef data;
+	int64_t dataFileOffset = 0; // offset of data relative to the start of the file
+
+	GranuleFileView() {}
+	// View of an entire file held in memory
+	explicit GranuleFileView(StringRef fileData);
+};
+
+Value serializeSnapshotFile(const GranuleSnapshot& snapshot, int targetBlockBytes);
+
+// Deltas are sorted by key when the file is written. Mutations are clipped to fileRange.
+Value serializeDeltaFile(const GranuleDeltas& deltas, KeyRangeRef fileRange, int targetBlockBytes);
+
 ErrorOr<RangeResult> loadAndMaterializeBlobGranules(const Standalone<VectorRef<BlobGranuleChunkRef>>& files,
                                                     const KeyRangeRef& keyRange,
                                                     Version beginVersion,
@@ -37,4 +93,10 @@ RangeResult materializeBlobGranule(const BlobGranuleChunkRef& chunk,
                                    Optional<StringRef> snapshotData,
                                    StringRef deltaFileData[]);
 
+RangeResult materializeBlobGranule(const BlobGranuleChunkRef& chunk,
+                                   KeyRangeRef keyRange,
+                                   Version readVersion,
+                                   const GranuleFileView& snapshotFile,
+                                   const GranuleFileView deltaFiles[]);
+
 #endif
\ No newline at end of file
@@ -30,27 +30,49 @@
 #include "fdbclient/BlobWorkerInterface.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
 
-// TODO more efficient data structure besides std::map? PTree is unecessary since this isn't versioned, but some other
-// sorted thing could work. And if it used arenas it'd probably be more efficient with allocations, since everything
-// else is in 1 arena and discarded at the end.
-
 // TODO could refactor the file reading code from here and the delta file function into another actor,
 // then this part would also be testable? but meh
 
-ACTOR Future<Standalone<StringRef>> readFile(Reference<BackupContainerFileSystem> bstore, BlobFilePointerRef f) {
+// Reads the parts of a granule file needed for keyRange: the header and index from the start of the file, and then the
+// contiguous run of blocks that intersect keyRange. Small files are covered entirely by the first read.
+ACTOR Future<GranuleFileView> readGranuleFile(Reference<BackupContainerFileSystem> bstore,
+                                              BlobFilePointerRef f,
+                                              KeyRangeRef keyRange,
+                                              Optional<BlobWorkerStats*> stats) {
 	try {
-		state Arena arena;
-		// printf("Starting read of snapshot file %s\n", filename.c_str());
+		state GranuleFileView file;
 		state Reference<IAsyncFile> reader = wait(bstore->readFile(f.filename.toString()));
-		// printf("Got snapshot file size %lld\n", size);
-		state uint8_t* data = new (arena) uint8_t[f.length];
-		// printf("Reading %lld bytes from snapshot file %s\n", size, filename.c_str());
-		int readSize = wait(reader->read(data, f.length, f.offset));
-		// printf("Read %lld bytes from snapshot file %s\n", readSize, filename.c_str());
-		ASSERT(f.length == readSize);
-
-		StringRef dataRef(data, f.length);
-		return Standalone<StringRef>(dataRef, arena);
+		state int64_t prefixLength = std::min<int64_t>(f.length, CLIENT_KNOBS->BG_FILE_READ_PREFIX_BYTES);
+		state uint8_t* prefix = new (file.arena) uint8_t[prefixLength];
+		int readSize = wait(reader->read(prefix, prefixLength, f.offset));
+		ASSERT(prefixLength == readSize);
+
+		state int64_t indexSize = blobGranuleFileIndexSize(StringRef(prefix, prefixLength));
+		if (indexSize > prefixLength) {
+			prefixLength = indexSize;
+			prefix = new (file.arena) uint8_t[prefixLength];
+			if (stats.present()) {
+				++stats.get()->s3GetReqs;
+			}
+			int indexReadSize = wait(reader->read(prefix, prefixLength, f.offset));
+			ASSERT(prefixLength == indexReadSize);
+		}
+		file.index = parseBlobGranuleFileIndex(file.arena, StringRef(prefix, prefixLength));
+
+		state std::pair<int64_t, int64_t> span = file.index.blockSpan(keyRange);
+		if (span.second <= prefixLength) {
+			file.data = StringRef(prefix + span.first, span.second - span.first);
+		} else {
+			state uint8_t* blocks = new (file.arena) uint8_t[span.second - span.first];
+			if (stats.present()) {
+				++stats.get()->s3GetReqs;
+			}
+			int blockReadSize = wait(reader->read(blocks, span.second - span.first, f.offset + span.first));
+			ASSERT(span.second - span.first == blockReadSize);
+			file.data = StringRef(blocks, span.second - span.first);
+		}
+		file.dataFileOffset = span.first;
+		return file;
 	} catch (Error& e) {
 		printf("Reading file %s got error %s\n", f.toString().c_str(), e.name());
 		throw e;
@@ -72,38 +94,32 @@ ACTOR Future<RangeResult> readBlobGranule(BlobGranuleChunkRef chunk,
 	ASSERT(readVersion == chunk.includedVersion);
 	ASSERT(chunk.snapshotFile.present());
 
-	state Arena arena;
-
 	try {
-		Future<Standalone<StringRef>> readSnapshotFuture = readFile(bstore, chunk.snapshotFile.get());
-		state std::vector<Future<Standalone<StringRef>>> readDeltaFutures;
+		Future<GranuleFileView> readSnapshotFuture = readGranuleFile(bstore, chunk.snapshotFile.get(), keyRange, stats);
+		state std::vector<Future<GranuleFileView>> readDeltaFutures;
 		if (stats.present()) {
 			++stats.get()->s3GetReqs;
 		}
 
 		readDeltaFutures.reserve(chunk.deltaFiles.size());
 		for (BlobFilePointerRef deltaFile : chunk.deltaFiles) {
-			readDeltaFutures.push_back(readFile(bstore, deltaFile));
+			readDeltaFutures.push_back(readGranuleFile(bstore, deltaFile, keyRange, stats));
 			if (stats.present()) {
 				++stats.get()->s3GetReqs;
 			}
 		}
 
-		state Standalone<StringRef> snapshotData = wait(readSnapshotFuture);
-		arena.dependsOn(snapshotData.arena());
-
-		state int numDeltaFiles = chunk.deltaFiles.size();
-		state StringRef* deltaData = new (arena) StringRef[numDeltaFiles];
+		state GranuleFileView snapshotFile = wait(readSnapshotFuture);
+		state std::vector<GranuleFileView> deltaFiles;
 		state int deltaIdx;
 
-		// for (Future<Standalone<StringRef>> deltaFuture : readDeltaFutures) {
-		for (deltaIdx = 0; deltaIdx < numDeltaFiles; deltaIdx++) {
-			Standalone<StringRef> data = wait(readDeltaFutures[deltaIdx]);
-			deltaData[deltaIdx] = data;
-			arena.dependsOn(data.arena());
+		deltaFiles.reserve(readDeltaFutures.size());
+		for (deltaIdx = 0; deltaIdx < readDeltaFutures.size(); deltaIdx++) {
+			GranuleFileView deltaFile = wait(readDeltaFutures[deltaIdx]);
+			deltaFiles.push_back(deltaFile);
 		}
 
-		return materializeBlobGranule(chunk, keyRange, readVersion, snapshotData, deltaData);
+		return materializeBlobGranule(chunk, keyRange, readVersion, snapshotFile, deltaFiles.data());
 
 	} catch (Error& e) {
 		printf("Reading blob granule got error %s\n", e.name());
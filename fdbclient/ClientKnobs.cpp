@@ -83,9 +83,16 @@ void ClientKnobs::initialize(Randomize randomize) {
 	init( GRV_BATCH_TIMEOUT,                     0.005 ); if( randomize && BUGGIFY ) GRV_BATCH_TIMEOUT = 0.1;
 	init( BROADCAST_BATCH_SIZE,                     20 ); if( randomize && BUGGIFY ) BROADCAST_BATCH_SIZE = 1;
 	init( TRANSACTION_TIMEOUT_DELAY_INTERVAL,     10.0 ); if( randomize && BUGGIFY ) TRANSACTION_TIMEOUT_DELAY_INTERVAL = 1.0;
+	init( GRV_CACHE_MAX_LAG,                       0.1 ); if( randomize && BUGGIFY ) GRV_CACHE_MAX_LAG = 1.0;
+	init( GRV_CACHE_REFRESH_INTERVAL,             0.05 ); if( randomize && BUGGIFY ) GRV_CACHE_REFRESH_INTERVAL = deterministicRandom()->coinflip() ? 0.001 : 2.0;
+	init( GRV_CACHE_IDLE_TIMEOUT,                  5.0 ); if( randomize && BUGGIFY ) GRV_CACHE_IDLE_TIMEOUT = 0.1;
+	init( GRV_CACHE_MAX_REPLY_LATENCY,            0.05 ); if( randomize && BUGGIFY ) GRV_CACHE_MAX_REPLY_LATENCY = 0.001;
 
 	init( LOCATION_CACHE_EVICTION_SIZE,         600000 );
 	init( LOCATION_CACHE_EVICTION_SIZE_SIM,         10 ); if( randomize && BUGGIFY ) LOCATION_CACHE_EVICTION_SIZE_SIM = 3;
+	init( LOCATION_CACHE_SHARED_EVICTION_SIZE, 1000000 );
+	init( LOCATION_CACHE_SHARED_EVICTION_SIZE_SIM,  20 ); if( randomize && BUGGIFY ) LOCATION_CACHE_SHARED_EVICTION_SIZE_SIM = deterministicRandom()->coinflip() ? 0 : 3;
+	init( LOCATION_CACHE_PREFETCH_SHARDS,            8 ); if( randomize && BUGGIFY ) LOCATION_CACHE_PREFETCH_SHARDS = 1;
 
 	init( GET_RANGE_SHARD_LIMIT,                     2 );
 	init( WARM_RANGE_SHARD_LIMIT,                  100 );
@@ -269,6 +276,7 @@ void ClientKnobs::initialize(Randomize randomize) {
 
 	// blob granules
 	init( ENABLE_BLOB_GRANULES,                   false );
+	init( BG_FILE_READ_PREFIX_BYTES,              64000 ); if( randomize && BUGGIFY ) BG_FILE_READ_PREFIX_BYTES = 100;
 
 	// clang-format on
 }
@@ -82,10 +82,24 @@ public:
 	double GRV_BATCH_TIMEOUT;
 	int BROADCAST_BATCH_SIZE;
 	double TRANSACTION_TIMEOUT_DELAY_INTERVAL;
+	// Read versions cached for transactions with USE_GRV_CACHE are used for at most GRV_CACHE_MAX_LAG seconds after
+	// they were requested. While the cache is in use it is refreshed every GRV_CACHE_REFRESH_INTERVAL, and refreshing
+	// stops once no transaction has used it for GRV_CACHE_IDLE_TIMEOUT. The cache is not used while read version requests
+	// take longer than GRV_CACHE_MAX_REPLY_LATENCY, since that means the proxies are delaying them.
+	double GRV_CACHE_MAX_LAG;
+	double GRV_CACHE_REFRESH_INTERVAL;
+	double GRV_CACHE_IDLE_TIMEOUT;
+	double GRV_CACHE_MAX_REPLY_LATENCY;
 
 	// When locationCache in DatabaseContext gets to be this size, items will be evicted
 	int LOCATION_CACHE_EVICTION_SIZE;
 	int LOCATION_CACHE_EVICTION_SIZE_SIM;
+	// The same for the location cache shared by the DatabaseContexts in a process connected to one cluster; 0 turns
+	// sharing off
+	int LOCATION_CACHE_SHARED_EVICTION_SIZE;
+	int LOCATION_CACHE_SHARED_EVICTION_SIZE_SIM;
+	// The number of shards, starting at the one looked up, whose locations are fetched on a location cache miss
+	int LOCATION_CACHE_PREFETCH_SHARDS;
 
 	int GET_RANGE_SHARD_LIMIT;
 	int WARM_RANGE_SHARD_LIMIT;
@@ -260,6 +274,7 @@ public:
 
 	// blob granules
 	bool ENABLE_BLOB_GRANULES;
+	int BG_FILE_READ_PREFIX_BYTES; // bytes read from the start of a granule file to get its index
 
 	ClientKnobs(Randomize randomize);
 	void initialize(Randomize randomize);
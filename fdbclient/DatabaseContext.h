@@ -66,9 +66,73 @@ struct LocationInfo : MultiInterface<ReferencedInterface<StorageServerInterface>
 	LocationInfo& operator=(const LocationInfo&) = delete;
 	LocationInfo& operator=(LocationInfo&&) = delete;
 	bool hasCaches = false;
+	bool referenced = false; // Set when read from the location cache; see evictLocation()
 	Reference<Locations> locations() { return Reference<Locations>::addRef(this); }
 };
 
+// Evicts one location from a location cache using the clock algorithm. The hand sweeps across the key space; a location
+// that has been read since the hand last passed it has its referenced flag cleared and is passed over once more.
+template <class Location>
+void evictLocation(CoalescedKeyRangeMap<Reference<Location>>& cache, Key& hand) {
+	auto r = cache.rangeContaining(hand);
+	// Every location has been passed over at most once by the end of one sweep, so the second sweep evicts one
+	for (int steps = 2 * cache.size(); steps > 0; --steps, ++r) {
+		if (r == cache.ranges().end()) {
+			r = cache.ranges().begin();
+		}
+		if (!r->value()) {
+			continue;
+		}
+		if (!r->value()->referenced) {
+			Key begin = r->begin(), end = r->end(); // insert invalidates r, so can't be passed a mere reference into it
+			cache.insert(KeyRangeRef(begin, end), Reference<Location>());
+			hand = end;
+			return;
+		}
+		r->value()->referenced = false;
+	}
+}
+
+// The shard locations returned by the commit proxies, shared by the DatabaseContexts in a process that are connected to
+// the same cluster. A context that misses in its own location cache looks here before asking the commit proxies, so
+// that each context does not have to warm up separately, and so that the first context to find a location out of date
+// refreshes it for the others.
+class SharedLocationCache : public ReferenceCounted<SharedLocationCache>, NonCopyable {
+public:
+	// Returns the cache for clusterKey, creating it if no context in this process is using it
+	static Reference<SharedLocationCache> forCluster(Key const& clusterKey);
+	~SharedLocationCache();
+
+	// Returns the shard containing key (or the key before it), if its location is cached
+	Optional<std::pair<KeyRange, std::vector<StorageServerInterface>>> get(const KeyRef& key, Reverse isBackward);
+	// Returns the shards intersecting range, up to limit of them from the beginning (or end) of range, if all of their
+	// locations are cached
+	bool get(const KeyRangeRef& range,
+	         std::vector<std::pair<KeyRange, std::vector<StorageServerInterface>>>& result,
+	         int limit,
+	         Reverse reverse);
+	void set(const KeyRangeRef& keys, const std::vector<StorageServerInterface>& servers);
+	void invalidate(const KeyRef& key, Reverse isBackward);
+	void invalidate(const KeyRangeRef& keys);
+
+private:
+	struct Location : ReferenceCounted<Location>, FastAllocated<Location> {
+		std::vector<StorageServerInterface> servers;
+		bool referenced = false;
+
+		explicit Location(const std::vector<StorageServerInterface>& servers) : servers(servers) {}
+	};
+
+	typedef std::pair<Key, NetworkAddress> CacheID;
+	static std::map<CacheID, SharedLocationCache*>& caches();
+
+	CacheID id;
+	CoalescedKeyRangeMap<Reference<Location>> locations;
+	Key evictionHand;
+
+	explicit SharedLocationCache(CacheID const& id) : id(id) {}
+};
+
 using CommitProxyInfo = ModelInterface<CommitProxyInterface>;
 using GrvProxyInfo = ModelInterface<GrvProxyInterface>;
 
@@ -238,6 +302,7 @@ public:
 	                        int limit,
 	                        Reverse reverse);
 	Reference<LocationInfo> setCachedLocation(const KeyRangeRef&, const std::vector<struct StorageServerInterface>&);
+	Reference<LocationInfo> setLocalCachedLocation(const KeyRangeRef&, const std::vector<struct StorageServerInterface>&);
 	void invalidateCache(const KeyRef&, Reverse isBackward = Reverse::False);
 	void invalidateCache(const KeyRangeRef&);
 
@@ -365,9 +430,13 @@ public:
 		Promise<GetReadVersionReply> reply;
 		TagSet tags;
 		Optional<UID> debugID;
+		double deadline; // See TransactionState::deadline
 
-		VersionRequest(SpanID spanContext, TagSet tags = TagSet(), Optional<UID> debugID = Optional<UID>())
-		  : spanContext(spanContext), tags(tags), debugID(debugID) {}
+		VersionRequest(SpanID spanContext,
+		               TagSet tags = TagSet(),
+		               Optional<UID> debugID = Optional<UID>(),
+		               double deadline = 0)
+		  : spanContext(spanContext), tags(tags), debugID(debugID), deadline(deadline) {}
 	};
 
 	// Transaction start request batching
@@ -385,6 +454,21 @@ public:
 	Version minAcceptableReadVersion = std::numeric_limits<Version>::max();
 	void validateVersion(Version) const;
 
+	// Read version cache for transactions with the USE_GRV_CACHE option at the default priority. Every default priority
+	// GRV reply updates it, and while transactions are using it a background actor keeps it fresh at that priority. A
+	// cached version is only handed out if it is recent enough and no older than the latest commit made through this
+	// database, so that the client still reads its writes, and not while the proxies are delaying read versions, so
+	// that the cache does not let transactions skip ratekeeper's throttling.
+	GetReadVersionReply cachedReadVersion;
+	double cachedReadVersionTime = 0; // When cachedReadVersion was requested
+	double lastGrvCacheUse = 0;
+	double grvCacheRefreshTime = 0; // When the outstanding refresh request was sent, or 0 if there is none
+	bool grvCacheDelayed = false; // The last default priority read version took too long to come back
+	Version lastCommitVersion = invalidVersion;
+	Future<Void> grvCacheRefresher;
+	void updateCachedReadVersion(double requestTime, GetReadVersionReply const& reply);
+	Optional<GetReadVersionReply> getCachedReadVersion();
+
 	// Client status updater
 	struct ClientStatusUpdater {
 		std::vector<std::pair<std::string, BinaryWriter>> inStatusQ;
@@ -396,6 +480,9 @@ public:
 	// Cache of location information
 	int locationCacheSize;
 	CoalescedKeyRangeMap<Reference<LocationInfo>> locationCache;
+	Key locationCacheEvictionHand;
+	Reference<SharedLocationCache> sharedLocationCache; // Null if there is no connection record or sharing is off
+	void attachSharedLocationCache();
 
 	std::map<UID, StorageServerInfo*> server_interf;
 	std::map<UID, BlobWorkerInterface> blobWorker_interf; // blob workers don't change endpoints for the same ID
@@ -420,6 +507,7 @@ public:
 	Counter transactionReadVersions;
 	Counter transactionReadVersionsThrottled;
 	Counter transactionReadVersionsCompleted;
+	Counter transactionReadVersionsFromCache;
 	Counter transactionReadVersionBatches;
 	Counter transactionBatchReadVersions;
 	Counter transactionDefaultReadVersions;
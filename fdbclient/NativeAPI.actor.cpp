@@ -248,6 +248,94 @@ StorageServerInfo::~StorageServerInfo() {
 	}
 }
 
+std::map<SharedLocationCache::CacheID, SharedLocationCache*>& SharedLocationCache::caches() {
+	static std::map<CacheID, SharedLocationCache*> caches;
+	return caches;
+}
+
+Reference<SharedLocationCache> SharedLocationCache::forCluster(Key const& clusterKey) {
+	// In simulation every simulated process has its own caches
+	CacheID id(clusterKey, g_network->getLocalAddress());
+	auto it = caches().find(id);
+	if (it != caches().end()) {
+		return Reference<SharedLocationCache>::addRef(it->second);
+	}
+	Reference<SharedLocationCache> cache(new SharedLocationCache(id));
+	caches()[id] = cache.getPtr();
+	return cache;
+}
+
+SharedLocationCache::~SharedLocationCache() {
+	caches().erase(id);
+}
+
+Optional<std::pair<KeyRange, std::vector<StorageServerInterface>>> SharedLocationCache::get(const KeyRef& key,
+                                                                                           Reverse isBackward) {
+	auto range = isBackward ? locations.rangeContainingKeyBefore(key) : locations.rangeContaining(key);
+	if (!range->value()) {
+		return Optional<std::pair<KeyRange, std::vector<StorageServerInterface>>>();
+	}
+	range->value()->referenced = true;
+	return std::make_pair(KeyRange(range->range()), range->value()->servers);
+}
+
+bool SharedLocationCache::get(const KeyRangeRef& range,
+                              std::vector<std::pair<KeyRange, std::vector<StorageServerInterface>>>& result,
+                              int limit,
+                              Reverse reverse) {
+	result.clear();
+
+	auto begin = locations.rangeContaining(range.begin);
+	auto end = locations.rangeContainingKeyBefore(range.end);
+
+	loop {
+		auto r = reverse ? end : begin;
+		if (!r->value()) {
+			result.clear();
+			return false;
+		}
+		r->value()->referenced = true;
+		result.emplace_back(r->range(), r->value()->servers);
+		if (result.size() == limit || begin == end) {
+			break;
+		}
+
+		if (reverse)
+			--end;
+		else
+			++begin;
+	}
+
+	return true;
+}
+
+void SharedLocationCache::set(const KeyRangeRef& keys, const std::vector<StorageServerInterface>& servers) {
+	int maxSize = g_network->isSimulated() ? CLIENT_KNOBS->LOCATION_CACHE_SHARED_EVICTION_SIZE_SIM
+	                                       : CLIENT_KNOBS->LOCATION_CACHE_SHARED_EVICTION_SIZE;
+	int maxEvictionAttempts = 100, attempts = 0;
+	while (locations.size() > maxSize && attempts < maxEvictionAttempts) {
+		TEST(true); // NativeAPI shared locationCache entry evicted
+		attempts++;
+		evictLocation(locations, evictionHand);
+	}
+	locations.insert(keys, makeReference<Location>(servers));
+}
+
+void SharedLocationCache::invalidate(const KeyRef& key, Reverse isBackward) {
+	if (isBackward) {
+		locations.rangeContainingKeyBefore(key)->value() = Reference<Location>();
+	} else {
+		locations.rangeContaining(key)->value() = Reference<Location>();
+	}
+}
+
+void SharedLocationCache::invalidate(const KeyRangeRef& keys) {
+	auto rs = locations.intersectingRanges(keys);
+	Key begin = rs.begin().begin(),
+	    end = rs.end().begin(); // insert invalidates rs, so can't be passed a mere reference into it
+	locations.insert(KeyRangeRef(begin, end), Reference<Location>());
+}
+
 std::string printable(const VectorRef<KeyValueRef>& val) {
 	std::string s;
 	for (int i = 0; i < val.size(); i++)
@@ -1204,6 +1292,7 @@ DatabaseContext::DatabaseContext(Reference<AsyncVar<Reference<IClusterConnection
     cc("TransactionMetrics"), transactionReadVersions("ReadVersions", cc),
     transactionReadVersionsThrottled("ReadVersionsThrottled", cc),
     transactionReadVersionsCompleted("ReadVersionsCompleted", cc),
+    transactionReadVersionsFromCache("ReadVersionsFromCache", cc),
     transactionReadVersionBatches("ReadVersionBatches", cc),
     transactionBatchReadVersions("BatchPriorityReadVersions", cc),
     transactionDefaultReadVersions("DefaultPriorityReadVersions", cc),
@@ -1251,6 +1340,7 @@ DatabaseContext::DatabaseContext(Reference<AsyncVar<Reference<IClusterConnection
 	logger = databaseLogger(this);
 	locationCacheSize = g_network->isSimulated() ? CLIENT_KNOBS->LOCATION_CACHE_EVICTION_SIZE_SIM
 	                                             : CLIENT_KNOBS->LOCATION_CACHE_EVICTION_SIZE;
+	attachSharedLocationCache();
 
 	getValueSubmitted.init(LiteralStringRef("NativeAPI.GetValueSubmitted"));
 	getValueCompleted.init(LiteralStringRef("NativeAPI.GetValueCompleted"));
@@ -1461,6 +1551,7 @@ DatabaseContext::DatabaseContext(const Error& err)
   : deferredError(err), internal(IsInternal::False), cc("TransactionMetrics"),
     transactionReadVersions("ReadVersions", cc), transactionReadVersionsThrottled("ReadVersionsThrottled", cc),
     transactionReadVersionsCompleted("ReadVersionsCompleted", cc),
+    transactionReadVersionsFromCache("ReadVersionsFromCache", cc),
     transactionReadVersionBatches("ReadVersionBatches", cc),
     transactionBatchReadVersions("BatchPriorityReadVersions", cc),
     transactionDefaultReadVersions("DefaultPriorityReadVersions", cc),
@@ -1520,20 +1611,39 @@ DatabaseContext::~DatabaseContext() {
 	clientDBInfoMonitor.cancel();
 	monitorTssInfoChange.cancel();
 	tssMismatchHandler.cancel();
+	grvCacheRefresher.cancel();
 	for (auto it = server_interf.begin(); it != server_interf.end(); it = server_interf.erase(it))
 		it->second->notifyContextDestroyed();
 	ASSERT_ABORT(server_interf.empty());
 	locationCache.insert(allKeys, Reference<LocationInfo>());
 }
 
-std::pair<KeyRange, Reference<LocationInfo>> DatabaseContext::getCachedLocation(const KeyRef& key, Reverse isBackward) {
-	if (isBackward) {
-		auto range = locationCache.rangeContainingKeyBefore(key);
-		return std::make_pair(range->range(), range->value());
+void DatabaseContext::attachSharedLocationCache() {
+	int sharedSize = g_network->isSimulated() ? CLIENT_KNOBS->LOCATION_CACHE_SHARED_EVICTION_SIZE_SIM
+	                                          : CLIENT_KNOBS->LOCATION_CACHE_SHARED_EVICTION_SIZE;
+	if (sharedSize > 0 && connectionRecord && connectionRecord->get()) {
+		sharedLocationCache =
+		    SharedLocationCache::forCluster(connectionRecord->get()->getConnectionString().clusterKey());
 	} else {
-		auto range = locationCache.rangeContaining(key);
+		sharedLocationCache.clear();
+	}
+}
+
+std::pair<KeyRange, Reference<LocationInfo>> DatabaseContext::getCachedLocation(const KeyRef& key, Reverse isBackward) {
+	auto range = isBackward ? locationCache.rangeContainingKeyBefore(key) : locationCache.rangeContaining(key);
+	if (range->value()) {
+		range->value()->referenced = true;
 		return std::make_pair(range->range(), range->value());
 	}
+	if (sharedLocationCache) {
+		auto shared = sharedLocationCache->get(key, isBackward);
+		if (shared.present()) {
+			TEST(true); // NativeAPI location found in shared locationCache
+			auto loc = setLocalCachedLocation(shared.get().first, shared.get().second);
+			return std::make_pair(shared.get().first, loc);
+		}
+	}
+	return std::make_pair(range->range(), range->value());
 }
 
 bool DatabaseContext::getCachedLocations(const KeyRangeRef& range,
@@ -1550,11 +1660,12 @@ bool DatabaseContext::getCachedLocations(const KeyRangeRef& range,
 		if (!r->value()) {
 			TEST(result.size()); // had some but not all cached locations
 			result.clear();
-			return false;
+			break;
 		}
+		r->value()->referenced = true;
 		result.emplace_back(r->range() & range, r->value());
 		if (result.size() == limit || begin == end) {
-			break;
+			return true;
 		}
 
 		if (reverse)
@@ -1563,11 +1674,27 @@ bool DatabaseContext::getCachedLocations(const KeyRangeRef& range,
 			++begin;
 	}
 
+	std::vector<std::pair<KeyRange, std::vector<StorageServerInterface>>> shared;
+	if (!sharedLocationCache || !sharedLocationCache->get(range, shared, limit, reverse)) {
+		return false;
+	}
+	TEST(true); // NativeAPI locations found in shared locationCache
+	for (const auto& [keys, servers] : shared) {
+		result.emplace_back(keys & range, setLocalCachedLocation(keys, servers));
+	}
 	return true;
 }
 
 Reference<LocationInfo> DatabaseContext::setCachedLocation(const KeyRangeRef& keys,
                                                            const std::vector<StorageServerInterface>& servers) {
+	if (sharedLocationCache) {
+		sharedLocationCache->set(keys, servers);
+	}
+	return setLocalCachedLocation(keys, servers);
+}
+
+Reference<LocationInfo> DatabaseContext::setLocalCachedLocation(const KeyRangeRef& keys,
+                                                                const std::vector<StorageServerInterface>& servers) {
 	std::vector<Reference<ReferencedInterface<StorageServerInterface>>> serverRefs;
 	serverRefs.reserve(servers.size());
 	for (const auto& interf : servers) {
@@ -1579,9 +1706,7 @@ Reference<LocationInfo> DatabaseContext::setCachedLocation(const KeyRangeRef& ke
 	while (locationCache.size() > locationCacheSize && attempts < maxEvictionAttempts) {
 		TEST(true); // NativeAPI storage server locationCache entry evicted
 		attempts++;
-		auto r = locationCache.randomRange();
-		Key begin = r.begin(), end = r.end(); // insert invalidates r, so can't be passed a mere reference into it
-		locationCache.insert(KeyRangeRef(begin, end), Reference<LocationInfo>());
+		evictLocation(locationCache, locationCacheEvictionHand);
 	}
 	locationCache.insert(keys, loc);
 	return loc;
@@ -1593,6 +1718,9 @@ void DatabaseContext::invalidateCache(const KeyRef& key, Reverse isBackward) {
 	} else {
 		locationCache.rangeContaining(key)->value() = Reference<LocationInfo>();
 	}
+	if (sharedLocationCache) {
+		sharedLocationCache->invalidate(key, isBackward);
+	}
 }
 
 void DatabaseContext::invalidateCache(const KeyRangeRef& keys) {
@@ -1600,6 +1728,9 @@ void DatabaseContext::invalidateCache(const KeyRangeRef& keys) {
 	Key begin = rs.begin().begin(),
 	    end = rs.end().begin(); // insert invalidates rs, so can't be passed a mere reference into it
 	locationCache.insert(KeyRangeRef(begin, end), Reference<LocationInfo>());
+	if (sharedLocationCache) {
+		sharedLocationCache->invalidate(keys);
+	}
 }
 
 Future<Void> DatabaseContext::onProxiesChanged() const {
@@ -1733,6 +1864,8 @@ ACTOR static Future<Void> switchConnectionRecordImpl(Reference<IClusterConnectio
 	self->commitProxies.clear();
 	self->grvProxies.clear();
 	self->minAcceptableReadVersion = std::numeric_limits<Version>::max();
+	// The shared cache's locations are still good for the other contexts on the former cluster
+	self->sharedLocationCache.clear();
 	self->invalidateCache(allKeys);
 
 	auto clearedClientInfo = self->clientInfo->get();
@@ -1741,6 +1874,7 @@ ACTOR static Future<Void> switchConnectionRecordImpl(Reference<IClusterConnectio
 	clearedClientInfo.id = deterministicRandom()->randomUniqueID();
 	self->clientInfo->set(clearedClientInfo);
 	self->connectionRecord->set(connRecord);
+	self->attachSharedLocationCache();
 
 	state Database db(Reference<DatabaseContext>::addRef(self));
 	state Transaction tr(db);
@@ -2437,6 +2571,9 @@ ACTOR Future<std::pair<KeyRange, Reference<LocationInfo>>> getKeyLocation_intern
 	if (debugID.present())
 		g_traceBatch.addEvent("TransactionDebug", debugID.get().first(), "NativeAPI.getKeyLocation.Before");
 
+	// Also fetch the locations of the next few shards in the direction of the lookup, which a scan or a client working
+	// through a range of keys is likely to want next
+	state int prefetchShards = std::max(1, std::min(CLIENT_KNOBS->LOCATION_CACHE_PREFETCH_SHARDS, cx->locationCacheSize));
 	loop {
 		++cx->transactionKeyServerLocationRequests;
 		choose {
@@ -2444,13 +2581,20 @@ ACTOR Future<std::pair<KeyRange, Reference<LocationInfo>>> getKeyLocation_intern
 			when(GetKeyServerLocationsReply rep = wait(basicLoadBalance(
 			         cx->getCommitProxies(useProvisionalProxies),
 			         &CommitProxyInterface::getKeyServersLocations,
-			         GetKeyServerLocationsRequest(span.context, key, Optional<KeyRef>(), 100, isBackward, key.arena()),
+			         isBackward ? GetKeyServerLocationsRequest(
+			                          span.context, allKeys.begin, key, prefetchShards, isBackward, key.arena())
+			                    : GetKeyServerLocationsRequest(
+			                          span.context, key, allKeys.end, prefetchShards, isBackward, key.arena()),
 			         TaskPriority::DefaultPromiseEndpoint))) {
 				++cx->transactionKeyServerLocationRequestsCompleted;
 				if (debugID.present())
 					g_traceBatch.addEvent("TransactionDebug", debugID.get().first(), "NativeAPI.getKeyLocation.After");
-				ASSERT(rep.results.size() == 1);
+				ASSERT(rep.results.size() >= 1 && rep.results.size() <= prefetchShards);
 
+				// The shard containing key is the first, so it is cached last and can't be evicted by the others
+				for (int shard = rep.results.size() - 1; shard > 0; shard--) {
+					cx->setCachedLocation(rep.results[shard].first, rep.results[shard].second);
+				}
 				auto locationInfo = cx->setCachedLocation(rep.results[0].first, rep.results[0].second);
 				updateTssMappings(cx, rep);
 				return std::make_pair(KeyRange(rep.results[0].first, rep.arena), locationInfo);
@@ -2493,6 +2637,15 @@ Future<std::pair<KeyRange, Reference<LocationInfo>>> getKeyLocation(Reference<Tr
 	    trState->cx, key, member, trState->spanID, trState->debugID, trState->useProvisionalProxies, isBackward);
 }
 
+// Waits out WRONG_SHARD_SERVER_DELAY after a read found the cached location of key out of date. The location is looked
+// up again during the delay rather than after it, so that the retry doesn't wait for both.
+ACTOR Future<Void> relocateAfterWrongShard(Reference<TransactionState> trState, Key key, Reverse isBackward) {
+	state Future<Void> located = success(getKeyLocation_internal(
+	    trState->cx, key, trState->spanID, trState->debugID, trState->useProvisionalProxies, isBackward));
+	wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, trState->taskID) && located);
+	return Void();
+}
+
 ACTOR Future<std::vector<std::pair<KeyRange, Reference<LocationInfo>>>> getKeyRangeLocations_internal(
     Database cx,
     KeyRange keys,
@@ -2664,12 +2817,20 @@ Reference<TransactionState> TransactionState::cloneAndReset(Reference<Transactio
 
 	newState->numErrors = numErrors;
 	newState->startTime = startTime;
+	newState->deadline = deadline;
 	newState->committedVersion = committedVersion;
 	newState->conflictingKeys = conflictingKeys;
 
 	return newState;
 }
 
+Optional<double> TransactionState::timeBudget() const {
+	if (deadline == 0) {
+		return Optional<double>();
+	}
+	return std::max(deadline - now(), 0.0);
+}
+
 Future<Void> Transaction::warmRange(KeyRange keys) {
 	return warmRange_impl(trState, keys);
 }
@@ -2714,18 +2875,19 @@ ACTOR Future<Optional<Value>> getValue(Reference<TransactionState> trState,
 					throw deterministicRandom()->randomChoice(
 					    std::vector<Error>{ transaction_too_old(), future_version() });
 				}
+				GetValueRequest req(span.context,
+				                    key,
+				                    ver,
+				                    trState->cx->sampleReadTags() ? trState->options.readTags : Optional<TagSet>(),
+				                    getValueID);
+				req.timeBudget = trState->timeBudget();
 				choose {
 					when(wait(trState->cx->connectionFileChanged())) { throw transaction_too_old(); }
 					when(GetValueReply _reply = wait(loadBalance(
 					         trState->cx.getPtr(),
 					         ssi.second,
 					         &StorageServerInterface::getValue,
-					         GetValueRequest(span.context,
-					                         key,
-					                         ver,
-					                         trState->cx->sampleReadTags() ? trState->options.readTags
-					                                                       : Optional<TagSet>(),
-					                         getValueID),
+					         req,
 					         TaskPriority::DefaultPromiseEndpoint,
 					         AtMostOnce::False,
 					         trState->cx->enableLocalityLoadBalance ? &trState->cx->queueModel : nullptr))) {
@@ -2776,7 +2938,7 @@ ACTOR Future<Optional<Value>> getValue(Reference<TransactionState> trState,
 			if (e.code() == error_code_wrong_shard_server || e.code() == error_code_all_alternatives_failed ||
 			    (e.code() == error_code_transaction_too_old && ver == latestVersion)) {
 				trState->cx->invalidateCache(key);
-				wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, trState->taskID));
+				wait(relocateAfterWrongShard(trState, key, Reverse::False));
 			} else {
 				if (trState->trLogInfo && recordLogInfo)
 					trState->trLogInfo->addLog(FdbClientLogEvents::EventGetError(
@@ -2831,6 +2993,7 @@ ACTOR Future<Key> getKey(Reference<TransactionState> trState, KeySelector k, Fut
 			                  trState->cx->sampleReadTags() ? trState->options.readTags : Optional<TagSet>(),
 			                  getKeyID);
 			req.arena.dependsOn(k.arena());
+			req.timeBudget = trState->timeBudget();
 
 			state GetKeyReply reply;
 			try {
@@ -2867,7 +3030,7 @@ ACTOR Future<Key> getKey(Reference<TransactionState> trState, KeySelector k, Fut
 			if (e.code() == error_code_wrong_shard_server || e.code() == error_code_all_alternatives_failed) {
 				trState->cx->invalidateCache(k.getKey(), Reverse{ k.isBackward() });
 
-				wait(delay(CLIENT_KNOBS->WRONG_SHARD_SERVER_DELAY, trState->taskID));
+				wait(relocateAfterWrongShard(trState, k.getKey(), Reverse{ k.isBackward() }));
 			} else {
 				TraceEvent(SevInfo, "GetKeyError").error(e).detail("AtKey", k.getKey()).detail("Offset", k.offset);
 				throw e;
@@ -3217,6 +3380,7 @@ Future<RangeResult> getExactRange(Reference<TransactionState> trState,
 			req.begin = firstGreaterOrEqual(range.begin);
 			req.end = firstGreaterOrEqual(range.end);
 			req.spanContext = span.context;
+			req.timeBudget = trState->timeBudget();
 
 			// keep shard's arena around in case of async tss comparison
 			req.arena.dependsOn(locations[shard].first.arena());
@@ -3538,6 +3702,7 @@ Future<RangeResult> getRange(Reference<TransactionState> trState,
 
 			req.isFetchKeys = (trState->taskID == TaskPriority::FetchKeys);
 			req.version = readVersion;
+			req.timeBudget = trState->timeBudget();
 
 			// In case of async tss comparison, also make req arena depend on begin, end, and/or shard's arena depending
 			// on which  is used
@@ -4935,6 +5100,7 @@ void TransactionOptions::clear() {
 	readTags = TagSet{};
 	priority = TransactionPriority::DEFAULT;
 	expensiveClearCostEstimation = false;
+	useGrvCache = false;
 }
 
 TransactionOptions::TransactionOptions() {
@@ -5280,6 +5446,7 @@ ACTOR static Future<Void> tryCommit(Reference<TransactionState> trState,
 					if (debugID.present())
 						TraceEvent(interval.end()).detail("CommittedVersion", v);
 					trState->committedVersion = v;
+					trState->cx->lastCommitVersion = std::max(trState->cx->lastCommitVersion, v);
 					if (v > trState->cx->metadataVersionCache[trState->cx->mvCacheInsertLocation].first) {
 						trState->cx->mvCacheInsertLocation =
 						    (trState->cx->mvCacheInsertLocation + 1) % trState->cx->metadataVersionCache.size();
@@ -5703,6 +5870,11 @@ void Transaction::setOption(FDBTransactionOptions::Option option, Optional<Strin
 		trState->options.expensiveClearCostEstimation = true;
 		break;
 
+	case FDBTransactionOptions::USE_GRV_CACHE:
+		validateOptionValueNotPresent(value);
+		trState->options.useGrvCache = true;
+		break;
+
 	default:
 		break;
 	}
@@ -5714,8 +5886,10 @@ ACTOR Future<GetReadVersionReply> getConsistentReadVersion(SpanID parentSpan,
                                                            TransactionPriority priority,
                                                            uint32_t flags,
                                                            TransactionTagMap<uint32_t> tags,
-                                                           Optional<UID> debugID) {
+                                                           Optional<UID> debugID,
+                                                           double deadline) {
 	state Span span("NAPI:getConsistentReadVersion"_loc, parentSpan);
+	state double requestTime;
 
 	++cx->transactionReadVersionBatches;
 	if (debugID.present())
@@ -5723,6 +5897,10 @@ ACTOR Future<GetReadVersionReply> getConsistentReadVersion(SpanID parentSpan,
 	loop {
 		try {
 			state GetReadVersionRequest req(span.context, transactionCount, priority, flags, tags, debugID);
+			if (deadline != 0) {
+				req.timeBudget = std::max(deadline - now(), 0.0);
+			}
+			requestTime = now();
 
 			choose {
 				when(wait(cx->onProxiesChanged())) {}
@@ -5754,11 +5932,17 @@ ACTOR Future<GetReadVersionReply> getConsistentReadVersion(SpanID parentSpan,
 						    "TransactionDebug", debugID.get().first(), "NativeAPI.getConsistentReadVersion.After");
 					ASSERT(v.version > 0);
 					cx->minAcceptableReadVersion = std::min(cx->minAcceptableReadVersion, v.version);
+					if (priority == TransactionPriority::DEFAULT &&
+					    !(flags & (GetReadVersionRequest::FLAG_CAUSAL_READ_RISKY |
+					               GetReadVersionRequest::FLAG_USE_PROVISIONAL_PROXIES))) {
+						cx->updateCachedReadVersion(requestTime, v);
+					}
 					return v;
 				}
 			}
 		} catch (Error& e) {
-			if (e.code() != error_code_broken_promise && e.code() != error_code_batch_transaction_throttled)
+			if (e.code() != error_code_broken_promise && e.code() != error_code_batch_transaction_throttled &&
+			    e.code() != error_code_transaction_timed_out)
 				TraceEvent(SevError, "GetConsistentReadVersionError").error(e);
 			if (e.code() == error_code_batch_transaction_throttled && !cx->apiVersionAtLeast(630)) {
 				wait(delayJittered(5.0));
@@ -5769,6 +5953,61 @@ ACTOR Future<GetReadVersionReply> getConsistentReadVersion(SpanID parentSpan,
 	}
 }
 
+// Keeps the read version cache fresh while transactions are using it. getConsistentReadVersion() updates the cache with
+// each reply, and if a request fails transactions request their own read versions until the cache catches up.
+ACTOR Future<Void> refreshCachedReadVersion(DatabaseContext* cx) {
+	state double lastRequestTime;
+	loop {
+		if (now() - cx->lastGrvCacheUse > CLIENT_KNOBS->GRV_CACHE_IDLE_TIMEOUT) {
+			return Void();
+		}
+		lastRequestTime = now();
+		cx->grvCacheRefreshTime = lastRequestTime;
+		try {
+			wait(success(getConsistentReadVersion(SpanID(),
+			                                      cx,
+			                                      1,
+			                                      TransactionPriority::DEFAULT,
+			                                      GetReadVersionRequest::PRIORITY_DEFAULT,
+			                                      TransactionTagMap<uint32_t>(),
+			                                      Optional<UID>(),
+			                                      0)));
+		} catch (Error& e) {
+			if (e.code() == error_code_actor_cancelled) {
+				throw;
+			}
+		}
+		cx->grvCacheRefreshTime = 0;
+		wait(delay(std::max(0.0, lastRequestTime + CLIENT_KNOBS->GRV_CACHE_REFRESH_INTERVAL - now()),
+		           TaskPriority::GetConsistentReadVersion));
+	}
+}
+
+void DatabaseContext::updateCachedReadVersion(double requestTime, GetReadVersionReply const& reply) {
+	grvCacheDelayed = now() - requestTime > CLIENT_KNOBS->GRV_CACHE_MAX_REPLY_LATENCY;
+	if (reply.version > cachedReadVersion.version) {
+		cachedReadVersion = reply;
+		cachedReadVersionTime = requestTime;
+	}
+}
+
+Optional<GetReadVersionReply> DatabaseContext::getCachedReadVersion() {
+	lastGrvCacheUse = now();
+	if (!grvCacheRefresher.isValid() || grvCacheRefresher.isReady()) {
+		grvCacheRefresher = refreshCachedReadVersion(this);
+	}
+	// While read versions are being delayed, for example because ratekeeper is throttling, transactions wait for them
+	// like any other transaction
+	bool delayed = grvCacheDelayed ||
+	               (grvCacheRefreshTime > 0 && now() - grvCacheRefreshTime > CLIENT_KNOBS->GRV_CACHE_MAX_REPLY_LATENCY);
+	TEST(delayed); // Read version cache not used while read versions are delayed
+	if (!delayed && cachedReadVersion.version > 0 && cachedReadVersion.version >= lastCommitVersion &&
+	    now() - cachedReadVersionTime <= CLIENT_KNOBS->GRV_CACHE_MAX_LAG) {
+		return cachedReadVersion;
+	}
+	return Optional<GetReadVersionReply>();
+}
+
 ACTOR Future<Void> readVersionBatcher(DatabaseContext* cx,
                                       FutureStream<DatabaseContext::VersionRequest> versionStream,
                                       TransactionPriority priority,
@@ -5795,6 +6034,8 @@ ACTOR Future<Void> readVersionBatcher(DatabaseContext* cx,
 	state double lastRequestTime = now();
 
 	state TransactionTagMap<uint32_t> tags;
+	// The latest deadline of the batched requests; 0 once any of them has none, since the batch then has to be answered
+	state double deadline = -1;
 
 	// dynamic batching
 	state PromiseStream<double> replyTimes;
@@ -5813,6 +6054,9 @@ ACTOR Future<Void> readVersionBatcher(DatabaseContext* cx,
 				}
 				span.addParent(req.spanContext);
 				requests.push_back(req.reply);
+				if (deadline != 0) {
+					deadline = req.deadline == 0 ? 0 : std::max(deadline, req.deadline);
+				}
 				for (auto tag : req.tags) {
 					++tags[tag];
 				}
@@ -5851,13 +6095,15 @@ ACTOR Future<Void> readVersionBatcher(DatabaseContext* cx,
 			addActor.send(ready(timeReply(GRVReply.getFuture(), replyTimes)));
 
 			Future<Void> batch = incrementalBroadcastWithError(
-			    getConsistentReadVersion(span.context, cx, count, priority, flags, std::move(tags), std::move(debugID)),
+			    getConsistentReadVersion(
+			        span.context, cx, count, priority, flags, std::move(tags), std::move(debugID), deadline),
 			    std::move(requests),
 			    CLIENT_KNOBS->BROADCAST_BATCH_SIZE);
 
 			span = Span("NAPI:readVersionBatcher"_loc);
 			tags.clear();
 			debugID = Optional<UID>();
+			deadline = -1;
 			requests.clear();
 			addActor.send(batch);
 			timeout = Future<Void>();
@@ -5984,15 +6230,29 @@ Future<Version> Transaction::getReadVersion(uint32_t flags) {
 			}
 		}
 
+		Location location = "NAPI:getReadVersion"_loc;
+		UID spanContext = generateSpanID(trState->cx->transactionTracingSample, trState->spanID);
+
+		// Batch and immediate priority transactions must not take read versions throttled at another priority
+		if (trState->options.useGrvCache && trState->options.priority == TransactionPriority::DEFAULT &&
+		    trState->options.tags.empty() && !(flags & GetReadVersionRequest::FLAG_USE_PROVISIONAL_PROXIES)) {
+			Optional<GetReadVersionReply> cached = trState->cx->getCachedReadVersion();
+			if (cached.present()) {
+				++trState->cx->transactionReadVersionsFromCache;
+				trState->startTime = now();
+				readVersion = extractReadVersion(trState, location, spanContext, cached.get(), metadataVersion);
+				return readVersion;
+			}
+		}
+
 		auto& batcher = trState->cx->versionBatcher[flags];
 		if (!batcher.actor.isValid()) {
 			batcher.actor =
 			    readVersionBatcher(trState->cx.getPtr(), batcher.stream.getFuture(), trState->options.priority, flags);
 		}
 
-		Location location = "NAPI:getReadVersion"_loc;
-		UID spanContext = generateSpanID(trState->cx->transactionTracingSample, trState->spanID);
-		auto const req = DatabaseContext::VersionRequest(spanContext, trState->options.tags, trState->debugID);
+		auto const req =
+		    DatabaseContext::VersionRequest(spanContext, trState->options.tags, trState->debugID, trState->deadline);
 		batcher.stream.send(req);
 		trState->startTime = now();
 		readVersion = extractReadVersion(trState, location, spanContext, req.reply.getFuture(), metadataVersion);
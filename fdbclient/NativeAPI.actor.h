@@ -157,6 +157,7 @@ struct TransactionOptions {
 	bool includePort : 1;
 	bool reportConflictingKeys : 1;
 	bool expensiveClearCostEstimation : 1;
+	bool useGrvCache : 1;
 
 	TransactionPriority priority;
 
@@ -244,6 +245,8 @@ struct TransactionState : ReferenceCounted<TransactionState> {
 
 	int numErrors = 0;
 	double startTime = 0;
+	// The now() at which whoever is waiting on the transaction stops waiting (its timeout), or 0 if there is none
+	double deadline = 0;
 	Promise<Standalone<StringRef>> versionstampPromise;
 
 	Version committedVersion{ invalidVersion };
@@ -260,6 +263,9 @@ struct TransactionState : ReferenceCounted<TransactionState> {
 	  : cx(cx), trLogInfo(trLogInfo), options(cx), taskID(taskID), spanID(spanID) {}
 
 	Reference<TransactionState> cloneAndReset(Reference<TransactionLogInfo> newTrLogInfo, bool generateNewSpan) const;
+
+	// What is left before the deadline, sent with read requests so that servers can drop them once nobody is waiting
+	Optional<double> timeBudget() const;
 };
 
 class Transaction : NonCopyable {
@@ -268,6 +274,7 @@ public:
 	~Transaction();
 
 	void setVersion(Version v);
+	void setDeadline(double deadline) { trState->deadline = deadline; }
 	Future<Version> getReadVersion() { return getReadVersion(0); }
 	Future<Version> getRawReadVersion();
 	Optional<Version> getCachedReadVersion() const;
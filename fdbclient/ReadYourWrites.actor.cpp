@@ -1371,6 +1371,7 @@ ACTOR Future<Void> timebomb(double endTime, Promise<Void> resetPromise) {
 void ReadYourWritesTransaction::resetTimeout() {
 	timeoutActor =
 	    options.timeoutInSeconds == 0.0 ? Void() : timebomb(options.timeoutInSeconds + creationTime, resetPromise);
+	tr.setDeadline(options.timeoutInSeconds == 0.0 ? 0.0 : options.timeoutInSeconds + creationTime);
 }
 
 Future<Version> ReadYourWritesTransaction::getReadVersion() {
@@ -2530,6 +2531,7 @@ void ReadYourWritesTransaction::reset() {
 	options.reset(tr);
 	transactionDebugInfo.clear();
 	tr.fullReset();
+	tr.setDeadline(0.0);
 	versionStampFuture = tr.getVersionstamp();
 	std::copy(tr.getDatabase().getTransactionDefaults().begin(),
 	          tr.getDatabase().getTransactionDefaults().end(),
@@ -77,6 +77,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES,            2e9 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES = 2e6;
 	init( TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK,           100 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK = 1;
 	init( TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH,           16<<10 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH = 500;
+	init( TLOG_SPILLED_PEEK_THREADS,                               2 ); if ( randomize && BUGGIFY ) TLOG_SPILLED_PEEK_THREADS = 1;
+	init( TLOG_SPILLED_PEEK_MAX_CONCURRENT_READS,                  8 ); if ( randomize && BUGGIFY ) TLOG_SPILLED_PEEK_MAX_CONCURRENT_READS = 1;
 	init( DISK_QUEUE_FILE_EXTENSION_BYTES,                    10<<20 ); // BUGGIFYd per file within the DiskQueue
 	init( DISK_QUEUE_FILE_SHRINK_BYTES,                      100<<20 ); // BUGGIFYd per file within the DiskQueue
 	init( DISK_QUEUE_MAX_TRUNCATE_BYTES,                     2LL<<30 ); if ( randomize && BUGGIFY ) DISK_QUEUE_MAX_TRUNCATE_BYTES = 0;
@@ -287,6 +289,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( SQLITE_CHUNK_SIZE_PAGES,                             25600 );  // 100MB
 	init( SQLITE_CHUNK_SIZE_PAGES_SIM,                          1024 );  // 4MB
 	init( SQLITE_READER_THREADS,                                  64 );  // number of read threads
+	init( SQLITE_BATCH_READ_KEYS,                                 32 ); if( randomize && BUGGIFY ) SQLITE_BATCH_READ_KEYS = deterministicRandom()->randomInt(1, 5);
 	init( SQLITE_WRITE_WINDOW_SECONDS,                            -1 );
 	init( SQLITE_WRITE_WINDOW_LIMIT,                              -1 );
 	if( randomize && BUGGIFY ) {
@@ -345,12 +348,17 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( ROCKSDB_UNSAFE_AUTO_FSYNC,                           false );
 	init( ROCKSDB_PERIODIC_COMPACTION_SECONDS,                     0 );
 	init( ROCKSDB_PREFIX_LEN,                                      0 );
+	init( ROCKSDB_PREFIX_TUPLE_ELEMENTS,                           0 );
+	init( ROCKSDB_FILTER_BITS_PER_KEY,                          10.0 );
+	init( ROCKSDB_RIBBON_FILTER,                               false );
+	init( ROCKSDB_PARTITIONED_INDEX_FILTERS,                   false );
 	init( ROCKSDB_BLOCK_CACHE_SIZE,                                0 );
 	init( ROCKSDB_METRICS_DELAY,                                60.0 );
 	init( ROCKSDB_READ_VALUE_TIMEOUT,                            5.0 );
 	init( ROCKSDB_READ_VALUE_PREFIX_TIMEOUT,                     5.0 );
 	init( ROCKSDB_READ_RANGE_TIMEOUT,                            5.0 );
 	init( ROCKSDB_READ_QUEUE_WAIT,                               1.0 );
+	init( ROCKSDB_MULTIGET_KEYS,                                  64 ); if( randomize && BUGGIFY ) ROCKSDB_MULTIGET_KEYS = deterministicRandom()->randomInt(1, 5);
 	init( ROCKSDB_READ_QUEUE_HARD_MAX,                          1000 );
 	init( ROCKSDB_READ_QUEUE_SOFT_MAX,                           500 );
 	init( ROCKSDB_FETCH_QUEUE_HARD_MAX,                          100 );
@@ -424,6 +432,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( TXN_STATE_SEND_AMOUNT,                                    4 );
 	init( REPORT_TRANSACTION_COST_ESTIMATION_DELAY,               0.1 );
 	init( PROXY_REJECT_BATCH_QUEUED_TOO_LONG,                    true );
+	init( PROXY_TAG_ASSIGNMENT_THREADS,                             1 ); if( randomize && BUGGIFY ) PROXY_TAG_ASSIGNMENT_THREADS = deterministicRandom()->randomInt(2, 9);
+	init( PROXY_TAG_ASSIGNMENT_MIN_MUTATIONS,                    1000 ); if( randomize && BUGGIFY ) PROXY_TAG_ASSIGNMENT_MIN_MUTATIONS = deterministicRandom()->randomInt(0, 100);
 
 	init( RESET_MASTER_BATCHES,                                   200 );
 	init( RESET_RESOLVER_BATCHES,                                 200 );
@@ -453,6 +463,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( SAMPLE_EXPIRATION_TIME,                                1.0 );
 	init( SAMPLE_POLL_TIME,                                      0.1 );
 	init( RESOLVER_STATE_MEMORY_LIMIT,                           1e6 );
+	init( RESOLVER_USE_BTREE_CONFLICT_SET,                     false ); if( randomize && BUGGIFY ) RESOLVER_USE_BTREE_CONFLICT_SET = true;
+	init( RESOLVER_CONFLICT_SET_THREADS,                           1 ); if( randomize && BUGGIFY ) RESOLVER_CONFLICT_SET_THREADS = deterministicRandom()->randomInt(2, 9);
 	init( LAST_LIMITED_RATIO,                                    2.0 );
 
 	// Backup Worker
@@ -627,10 +639,12 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( STORAGE_LIMIT_BYTES,                                500000 );
 	init( BUGGIFY_LIMIT_BYTES,                                  1000 );
 	init( FETCH_USING_STREAMING,                                true ); if( randomize && BUGGIFY ) FETCH_USING_STREAMING = false; //Determines if fetch keys uses streaming reads
+	init( FETCH_KEYS_INGEST,                                   false ); if( randomize && BUGGIFY ) FETCH_KEYS_INGEST = true; //Determines if fetch keys hands blocks to the storage engine to ingest
 	init( FETCH_BLOCK_BYTES,                                     2e6 );
 	init( FETCH_KEYS_PARALLELISM_BYTES,                          4e6 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLELISM_BYTES = 3e6;
 	init( FETCH_KEYS_PARALLELISM,                                  2 );
 	init( FETCH_KEYS_LOWER_PRIORITY,                               0 );
+	init( STORAGE_VERSION_CHAINS,                              false ); if( randomize && BUGGIFY ) STORAGE_VERSION_CHAINS = true;
 	init( BUGGIFY_BLOCK_BYTES,                                 10000 );
 	init( STORAGE_COMMIT_BYTES,                             10000000 ); if( randomize && BUGGIFY ) STORAGE_COMMIT_BYTES = 2000000;
 	init( STORAGE_FETCH_BYTES,                               2500000 ); if( randomize && BUGGIFY ) STORAGE_FETCH_BYTES =  500000;
@@ -646,6 +660,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( BYTE_SAMPLE_LOAD_PARALLELISM,                            8 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_LOAD_PARALLELISM = 1;
 	init( BYTE_SAMPLE_LOAD_DELAY,                                0.0 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_LOAD_DELAY = 0.1;
 	init( BYTE_SAMPLE_START_DELAY,                               1.0 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_START_DELAY = 0.0;
+	init( BYTE_SAMPLE_CHECKPOINT_BYTES,                         20e6 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_CHECKPOINT_BYTES = deterministicRandom()->coinflip() ? 0 : 1e5;
+	init( BYTE_SAMPLE_CHECKPOINT_INTERVAL,                      60.0 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_CHECKPOINT_INTERVAL = 1.0;
 	init( UPDATE_STORAGE_PROCESS_STATS_INTERVAL,                 5.0 );
 	init( BEHIND_CHECK_DELAY,                                    2.0 );
 	init( BEHIND_CHECK_COUNT,                                      2 );
@@ -781,6 +797,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( REDWOOD_EXTENT_CONCURRENT_READS,                         4 );
 	init( REDWOOD_KVSTORE_CONCURRENT_READS,                       64 );
 	init( REDWOOD_KVSTORE_RANGE_PREFETCH,                       true );
+	init( REDWOOD_KVSTORE_BATCH_READ_KEYS,                        32 ); if( randomize && BUGGIFY ) REDWOOD_KVSTORE_BATCH_READ_KEYS = deterministicRandom()->randomInt(1, 5);
 	init( REDWOOD_PAGE_REBUILD_MAX_SLACK,                       0.33 );
 	init( REDWOOD_LAZY_CLEAR_BATCH_SIZE_PAGES,                    10 );
 	init( REDWOOD_LAZY_CLEAR_MIN_PAGES,                            0 );
@@ -791,6 +808,10 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( REDWOOD_METRICS_INTERVAL,                              5.0 );
 	init( REDWOOD_HISTOGRAM_INTERVAL,                           30.0 );
 	init( REDWOOD_EVICT_UPDATED_PAGES,                          true ); if( randomize && BUGGIFY ) { REDWOOD_EVICT_UPDATED_PAGES = false; }
+	init( REDWOOD_PAGE_CACHE_INTERNAL_FRACTION,                  0.2 ); if( randomize && BUGGIFY ) { REDWOOD_PAGE_CACHE_INTERNAL_FRACTION = deterministicRandom()->random01() * 0.5; }
+	init( REDWOOD_PAGE_CACHE_PROTECTED_FRACTION,                 0.8 ); if( randomize && BUGGIFY ) { REDWOOD_PAGE_CACHE_PROTECTED_FRACTION = deterministicRandom()->random01(); }
+	init( REDWOOD_PAGE_COMPRESSION,                                0 ); if( randomize && BUGGIFY ) { REDWOOD_PAGE_COMPRESSION = deterministicRandom()->randomInt(0, 3); }
+	init( REDWOOD_COMPRESSED_LEAF_BLOCKS,                          4 ); if( randomize && BUGGIFY ) { REDWOOD_COMPRESSED_LEAF_BLOCKS = deterministicRandom()->randomInt(1, 9); }
 
 	// Server request latency measurement
 	init( LATENCY_SAMPLE_SIZE,                                100000 );
@@ -807,6 +828,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( BG_SNAPSHOT_FILE_TARGET_BYTES,                    10000000 ); if( randomize && BUGGIFY ) { deterministicRandom()->random01() < 0.1 ? BG_SNAPSHOT_FILE_TARGET_BYTES /= 100 : BG_SNAPSHOT_FILE_TARGET_BYTES /= 10; }
 	init( BG_DELTA_BYTES_BEFORE_COMPACT, BG_SNAPSHOT_FILE_TARGET_BYTES/2 );
 	init( BG_DELTA_FILE_TARGET_BYTES,   BG_DELTA_BYTES_BEFORE_COMPACT/10 );
+	init( BG_FILE_BLOCK_BYTES,                                 64000 ); if( randomize && BUGGIFY ) BG_FILE_BLOCK_BYTES = deterministicRandom()->randomInt(100, 5000);
 
 	init( BLOB_WORKER_TIMEOUT,                                  10.0 ); if( randomize && BUGGIFY ) BLOB_WORKER_TIMEOUT = 1.0;
 
@@ -85,6 +85,8 @@ public:
 	int64_t TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES;
 	int64_t TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK;
 	int64_t TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH;
+	int TLOG_SPILLED_PEEK_THREADS; // Threads parsing spilled commits for peeks, off the TLog network thread
+	int TLOG_SPILLED_PEEK_MAX_CONCURRENT_READS; // Peeks that may be reading spilled data from disk at once
 	int64_t DISK_QUEUE_FILE_EXTENSION_BYTES; // When we grow the disk queue, by how many bytes should it grow?
 	int64_t DISK_QUEUE_FILE_SHRINK_BYTES; // When we shrink the disk queue, by how many bytes should it shrink?
 	int64_t DISK_QUEUE_MAX_TRUNCATE_BYTES; // A truncate larger than this will cause the file to be replaced instead.
@@ -250,6 +252,7 @@ public:
 	int SQLITE_CHUNK_SIZE_PAGES;
 	int SQLITE_CHUNK_SIZE_PAGES_SIM;
 	int SQLITE_READER_THREADS;
+	int SQLITE_BATCH_READ_KEYS; // Batched reads are split into reader thread actions of this many keys
 	int SQLITE_WRITE_WINDOW_LIMIT;
 	double SQLITE_WRITE_WINDOW_SECONDS;
 
@@ -276,12 +279,18 @@ public:
 	bool ROCKSDB_UNSAFE_AUTO_FSYNC;
 	int64_t ROCKSDB_PERIODIC_COMPACTION_SECONDS;
 	int ROCKSDB_PREFIX_LEN;
+	int ROCKSDB_PREFIX_TUPLE_ELEMENTS; // If > 0, prefix filters use the first N tuple elements of keys as the prefix
+	                                   // instead of ROCKSDB_PREFIX_LEN bytes
+	double ROCKSDB_FILTER_BITS_PER_KEY;
+	bool ROCKSDB_RIBBON_FILTER; // Use ribbon instead of bloom filters for prefix filtering
+	bool ROCKSDB_PARTITIONED_INDEX_FILTERS; // Partition index and filter blocks and load them through the block cache
 	int64_t ROCKSDB_BLOCK_CACHE_SIZE;
 	double ROCKSDB_METRICS_DELAY;
 	double ROCKSDB_READ_VALUE_TIMEOUT;
 	double ROCKSDB_READ_VALUE_PREFIX_TIMEOUT;
 	double ROCKSDB_READ_RANGE_TIMEOUT;
 	double ROCKSDB_READ_QUEUE_WAIT;
+	int ROCKSDB_MULTIGET_KEYS; // Batched reads are split into MultiGets of this many keys across the read threads
 	int ROCKSDB_READ_QUEUE_SOFT_MAX;
 	int ROCKSDB_READ_QUEUE_HARD_MAX;
 	int ROCKSDB_FETCH_QUEUE_SOFT_MAX;
@@ -349,6 +358,8 @@ public:
 	int TXN_STATE_SEND_AMOUNT;
 	double REPORT_TRANSACTION_COST_ESTIMATION_DELAY;
 	bool PROXY_REJECT_BATCH_QUEUED_TOO_LONG;
+	int PROXY_TAG_ASSIGNMENT_THREADS; // Threads to look up the storage servers of a batch's mutations on
+	int PROXY_TAG_ASSIGNMENT_MIN_MUTATIONS; // Smaller batches are looked up on the proxy's thread alone
 
 	int RESET_MASTER_BATCHES;
 	int RESET_RESOLVER_BATCHES;
@@ -375,6 +386,8 @@ public:
 	double SAMPLE_EXPIRATION_TIME;
 	double SAMPLE_POLL_TIME;
 	int64_t RESOLVER_STATE_MEMORY_LIMIT;
+	bool RESOLVER_USE_BTREE_CONFLICT_SET; // Keep the write history in a SIMD searched B+tree instead of a skip list
+	int RESOLVER_CONFLICT_SET_THREADS; // Threads to split each batch's conflict detection across, by key range
 
 	// Backup Worker
 	double BACKUP_TIMEOUT; // master's reaction time for backup failure
@@ -566,10 +579,12 @@ public:
 	int STORAGE_LIMIT_BYTES;
 	int BUGGIFY_LIMIT_BYTES;
 	bool FETCH_USING_STREAMING;
+	bool FETCH_KEYS_INGEST;
 	int FETCH_BLOCK_BYTES;
 	int FETCH_KEYS_PARALLELISM_BYTES;
 	int FETCH_KEYS_PARALLELISM;
 	int FETCH_KEYS_LOWER_PRIORITY;
+	bool STORAGE_VERSION_CHAINS; // Keep the window of recent versions in a B+tree with per-key version chains
 	int BUGGIFY_BLOCK_BYTES;
 	double STORAGE_DURABILITY_LAG_REJECT_THRESHOLD;
 	double STORAGE_DURABILITY_LAG_MIN_RATE;
@@ -585,6 +600,8 @@ public:
 	int BYTE_SAMPLE_LOAD_PARALLELISM;
 	double BYTE_SAMPLE_LOAD_DELAY;
 	double BYTE_SAMPLE_START_DELAY;
+	int64_t BYTE_SAMPLE_CHECKPOINT_BYTES; // Target sampled bytes per chunk of the byte sample checkpoint, 0 to disable
+	double BYTE_SAMPLE_CHECKPOINT_INTERVAL;
 	double UPDATE_STORAGE_PROCESS_STATS_INTERVAL;
 	double BEHIND_CHECK_DELAY;
 	int BEHIND_CHECK_COUNT;
@@ -728,6 +745,7 @@ public:
 	int REDWOOD_EXTENT_CONCURRENT_READS; // Max number of simultaneous extent disk reads in progress.
 	int REDWOOD_KVSTORE_CONCURRENT_READS; // Max number of simultaneous point or range reads in progress.
 	bool REDWOOD_KVSTORE_RANGE_PREFETCH; // Whether to use range read prefetching
+	int REDWOOD_KVSTORE_BATCH_READ_KEYS; // Batched reads are split into concurrent cursors of this many keys
 	double REDWOOD_PAGE_REBUILD_MAX_SLACK; // When rebuilding pages, max slack to allow in page
 	int REDWOOD_LAZY_CLEAR_BATCH_SIZE_PAGES; // Number of pages to try to pop from the lazy delete queue and process at
 	                                         // once
@@ -742,6 +760,13 @@ public:
 	double REDWOOD_METRICS_INTERVAL;
 	double REDWOOD_HISTOGRAM_INTERVAL;
 	bool REDWOOD_EVICT_UPDATED_PAGES; // Whether to prioritize eviction of updated pages from cache.
+	double REDWOOD_PAGE_CACHE_INTERNAL_FRACTION; // Fraction of the page cache reserved for internal BTree pages
+	double REDWOOD_PAGE_CACHE_PROTECTED_FRACTION; // Fraction of each page cache budget that re-referenced pages
+	                                              // can hold before being demoted back to probation
+	int REDWOOD_PAGE_COMPRESSION; // Codec for compressing leaf pages of new or rewritten leaves, 0 = none, 1 = LZ4,
+	                              // 2 = LZ4HC.  Pages can always be read regardless of this setting.
+	int REDWOOD_COMPRESSED_LEAF_BLOCKS; // Number of blocks of uncompressed data leaf pages are built to hold when
+	                                    // compression is enabled
 
 	// Server request latency measurement
 	int LATENCY_SAMPLE_SIZE;
@@ -760,6 +785,7 @@ public:
 	int BG_SNAPSHOT_FILE_TARGET_BYTES;
 	int BG_DELTA_FILE_TARGET_BYTES;
 	int BG_DELTA_BYTES_BEFORE_COMPACT;
+	int BG_FILE_BLOCK_BYTES;
 
 	double BLOB_WORKER_TIMEOUT; // Blob Manager's reaction time to a blob worker failure
 
@@ -241,7 +241,7 @@ struct GetValueRequest : TimedRequest {
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		serializer(ar, key, version, tags, debugID, reply, spanContext);
+		serializer(ar, key, version, tags, debugID, reply, spanContext, timeBudget);
 	}
 };
 
@@ -318,7 +318,19 @@ struct GetKeyValuesRequest : TimedRequest {
 	GetKeyValuesRequest() : isFetchKeys(false) {}
 	template <class Ar>
 	void serialize(Ar& ar) {
-		serializer(ar, begin, end, version, limit, limitBytes, isFetchKeys, tags, debugID, reply, spanContext, arena);
+		serializer(ar,
+		           begin,
+		           end,
+		           version,
+		           limit,
+		           limitBytes,
+		           isFetchKeys,
+		           tags,
+		           debugID,
+		           reply,
+		           spanContext,
+		           arena,
+		           timeBudget);
 	}
 };
 
@@ -354,8 +366,20 @@ struct GetKeyValuesAndFlatMapRequest : TimedRequest {
 	GetKeyValuesAndFlatMapRequest() : isFetchKeys(false) {}
 	template <class Ar>
 	void serialize(Ar& ar) {
-		serializer(
-		    ar, begin, end, mapper, version, limit, limitBytes, isFetchKeys, tags, debugID, reply, spanContext, arena);
+		serializer(ar,
+		           begin,
+		           end,
+		           mapper,
+		           version,
+		           limit,
+		           limitBytes,
+		           isFetchKeys,
+		           tags,
+		           debugID,
+		           reply,
+		           spanContext,
+		           arena,
+		           timeBudget);
 	}
 };
 
@@ -439,7 +463,7 @@ struct GetKeyRequest : TimedRequest {
 
 	template <class Ar>
 	void serialize(Ar& ar) {
-		serializer(ar, sel, version, tags, debugID, reply, spanContext, arena);
+		serializer(ar, sel, version, tags, debugID, reply, spanContext, arena, timeBudget);
 	}
 };
 
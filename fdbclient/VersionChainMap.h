@@ -0,0 +1,599 @@
+/*
+ * VersionChainMap.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2022 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBCLIENT_VERSIONCHAINMAP_H
+#define FDBCLIENT_VERSIONCHAINMAP_H
+#pragma once
+
+#include <algorithm>
+#include <deque>
+
+#include "flow/flow.h"
+#include "fdbclient/FDBTypes.h"
+
+// VersionChainMap is the B+tree behind VersionedMap when it is constructed with useVersionChains. Unlike a PTree it is
+// not persistent: there is a single tree of keys, and each leaf entry holds the key's newest state inline with older
+// states in a chain of FastAllocated nodes. A read at version v uses the newest state written at or before v, so
+// readers of older versions do not see later inserts and erases. Most keys have a single state in the window of
+// versions being kept, so a read touches one node per level plus a leaf, and an insert of a new key allocates nothing
+// unless its leaf splits.
+//
+// Keys are not copied. Like the PTree, the map refers to the memory of every key it was given for as long as a version
+// at or after the oldest version can read that key, and internal nodes only refer to keys still present in a leaf.
+//
+// Iterators survive inserts and erases into the latest version. If the tree's structure has changed since an iterator
+// last looked at it, the iterator finds its key again, which is still in the tree as long as the iterator's version has
+// not been forgotten.
+template <class K, class T>
+class VersionChainMap : NonCopyable {
+	struct State {
+		Version version; // The version at which the key was set to this state
+		Version insertVersion; // Reported by iterators; may be older than version
+		T value;
+		bool present; // False if the key was erased at version
+
+		State() : version(invalidVersion), insertVersion(invalidVersion), present(false) {}
+		State(Version version, Version insertVersion, T const& value, bool present)
+		  : version(version), insertVersion(insertVersion), value(value), present(present) {}
+	};
+
+	// An older state of a key, newest first
+	struct Chain : FastAllocated<Chain> {
+		State state;
+		Chain* older;
+
+		Chain(State const& state, Chain* older) : state(state), older(older) {}
+	};
+
+	struct Internal;
+
+	struct Node {
+		Internal* parent = nullptr;
+		int count = 0; // Entries in a leaf, children of an internal node
+		bool leaf;
+
+		explicit Node(bool leaf) : leaf(leaf) {}
+	};
+
+	static constexpr int leafBytes = 2048;
+	static constexpr int leafCapacity =
+	    (leafBytes - sizeof(Node) - 2 * sizeof(void*)) / (sizeof(K) + sizeof(State) + sizeof(Chain*));
+	static_assert(leafCapacity >= 4, "VersionChainMap leaf is too small for its entries");
+
+	struct Leaf : Node, FastAllocated<Leaf> {
+		Leaf* prev = nullptr;
+		Leaf* next = nullptr;
+		K keys[leafCapacity];
+		State states[leafCapacity];
+		Chain* older[leafCapacity];
+
+		Leaf() : Node(true) {}
+	};
+
+	static constexpr int internalBytes = 2048;
+	static constexpr int internalCapacity = (internalBytes - sizeof(Node) - sizeof(void*)) / (sizeof(K) + sizeof(void*));
+	static_assert(internalCapacity >= 4, "VersionChainMap internal node is too small for its keys");
+
+	// keys[i] is the smallest key under children[i + 1], and is the same K as that key's leaf entry holds
+	struct Internal : Node, FastAllocated<Internal> {
+		K keys[internalCapacity];
+		Node* children[internalCapacity + 1];
+
+		Internal() : Node(false) {}
+	};
+
+	struct Position {
+		Leaf* leaf = nullptr; // Null at the end
+		int index = 0;
+	};
+
+public:
+	class Cursor {
+	public:
+		Cursor() : map(nullptr), at(invalidVersion), epoch(0) {}
+		Cursor(VersionChainMap const* map, Version at, Position p) : map(map), at(at), position(p), epoch(map->epoch) {
+			skip(true);
+		}
+
+		bool valid() const { return position.leaf != nullptr; }
+		K const& key() const { return key_; }
+		Version insertVersion() const { return state().insertVersion; }
+		T const& value() const { return state().value; }
+
+		void next() {
+			if (!valid()) {
+				position = map->first();
+			} else {
+				sync();
+				position = map->next(position);
+			}
+			skip(true);
+		}
+		void previous() {
+			if (!valid()) {
+				position = map->last();
+			} else {
+				sync();
+				position = map->previous(position);
+			}
+			skip(false);
+		}
+
+		bool operator==(Cursor const& r) const {
+			if (valid() && r.valid())
+				return key_ == r.key_;
+			return valid() == r.valid();
+		}
+
+	private:
+		VersionChainMap const* map;
+		Version at;
+		mutable Position position;
+		mutable uint64_t epoch;
+		K key_;
+
+		// Finds this cursor's entry again if the tree has changed shape since the cursor last looked at it
+		void sync() const {
+			if (epoch != map->epoch) {
+				position = map->lowerBound(key_);
+				ASSERT(position.leaf && position.leaf->keys[position.index] == key_);
+				epoch = map->epoch;
+			}
+		}
+
+		State const& state() const {
+			sync();
+			State const* s = stateAt(position, at);
+			ASSERT(s);
+			return *s;
+		}
+
+		// Moves to the nearest entry which is present at the cursor's version
+		void skip(bool forward) {
+			while (position.leaf && !stateAt(position, at)) {
+				position = forward ? map->next(position) : map->previous(position);
+			}
+			if (position.leaf) {
+				key_ = position.leaf->keys[position.index];
+			}
+			epoch = map->epoch;
+		}
+	};
+
+	VersionChainMap() : oldestVersion(0), latestVersion(0), epoch(0) {
+		root = head = tail = new Leaf;
+	}
+	~VersionChainMap() { destroy(root); }
+
+	Version getOldestVersion() const { return oldestVersion; }
+	Version getLatestVersion() const { return latestVersion; }
+
+	void createNewVersion(Version version) {
+		ASSERT(version >= latestVersion);
+		latestVersion = version;
+	}
+
+	// Frees the states which no version at or after newOldestVersion can read
+	void forgetVersionsBefore(Version newOldestVersion) {
+		ASSERT(newOldestVersion <= latestVersion);
+		oldestVersion = std::max(oldestVersion, newOldestVersion);
+		while (!superseded.empty() && superseded.front().first <= oldestVersion) {
+			collect(superseded.front().second);
+			superseded.pop_front();
+		}
+	}
+
+	void insert(K const& k, T const& t, Version insertAt) {
+		Position p;
+		p.leaf = findLeaf(k);
+		p.index = std::lower_bound(p.leaf->keys, p.leaf->keys + p.leaf->count, k) - p.leaf->keys;
+		if (p.index < p.leaf->count && p.leaf->keys[p.index] == k) {
+			// The caller's copy of the key stays valid for at least as long as the one it replaces
+			p.leaf->keys[p.index] = k;
+			if (p.index == 0)
+				refreshSeparator(p.leaf);
+			setState(p, State(latestVersion, insertAt, t, true));
+		} else {
+			insertEntry(p, k, State(latestVersion, insertAt, t, true));
+		}
+	}
+
+	// The key must be present at the latest version
+	void erase(K const& k) {
+		Position p = lowerBound(k);
+		ASSERT(p.leaf && p.leaf->keys[p.index] == k && p.leaf->states[p.index].present);
+		eraseAt(p);
+	}
+
+	void erase(K const& begin, K const& end) {
+		Position p = lowerBound(begin);
+		while (p.leaf && p.leaf->keys[p.index] < end) {
+			if (p.leaf->states[p.index].present)
+				p = eraseAt(p);
+			else
+				p = next(p);
+		}
+	}
+
+	Cursor begin(Version at) const { return Cursor(this, at, first()); }
+	Cursor end(Version at) const { return Cursor(this, at, Position()); }
+	Cursor lowerBound(Version at, K const& k) const { return Cursor(this, at, lowerBound(k)); }
+	Cursor upperBound(Version at, K const& k) const { return Cursor(this, at, upperBound(k)); }
+
+	void validate() const {
+		int entries = 0;
+		validate(root, nullptr, nullptr, entries);
+		Position p = first();
+		for (Position q = p; q.leaf; p = q) {
+			q = next(p);
+			ASSERT(!q.leaf || p.leaf->keys[p.index] < q.leaf->keys[q.index]);
+		}
+	}
+
+private:
+	Node* root;
+	Leaf* head;
+	Leaf* tail;
+	Version oldestVersion, latestVersion;
+	uint64_t epoch; // Changed whenever an entry moves, so that cursors know to look for their key again
+
+	// The keys whose states were superseded at each version, in version order. Once that version is forgotten the
+	// older states can be freed.
+	std::deque<std::pair<Version, K>> superseded;
+
+	static State const* stateAt(Position p, Version at) {
+		State const* s = &p.leaf->states[p.index];
+		if (s->version > at) {
+			Chain const* c = p.leaf->older[p.index];
+			while (c && c->state.version > at)
+				c = c->older;
+			s = c ? &c->state : nullptr;
+		}
+		return s && s->present ? s : nullptr;
+	}
+
+	void setState(Position p, State const& s) {
+		State& current = p.leaf->states[p.index];
+		if (current.version != latestVersion) {
+			p.leaf->older[p.index] = new Chain(current, p.leaf->older[p.index]);
+			superseded.emplace_back(latestVersion, p.leaf->keys[p.index]);
+		}
+		current = s;
+	}
+
+	// Erases the entry at p, which must be present at the latest version, and returns the position after it
+	Position eraseAt(Position p) {
+		State& current = p.leaf->states[p.index];
+		if (current.version == latestVersion && !p.leaf->older[p.index]) {
+			// No other version can see this entry
+			return removeEntry(p);
+		}
+		setState(p, State(latestVersion, latestVersion, T(), false));
+		return next(p);
+	}
+
+	// Frees the states of k that are older than the newest one at or before oldestVersion, and the entry itself if no
+	// version from oldestVersion on can see it
+	void collect(K const& k) {
+		Position p = lowerBound(k);
+		if (!p.leaf || !(p.leaf->keys[p.index] == k))
+			return;
+		Chain** link = &p.leaf->older[p.index];
+		if (p.leaf->states[p.index].version <= oldestVersion) {
+			freeChain(*link);
+			*link = nullptr;
+			if (!p.leaf->states[p.index].present)
+				removeEntry(p);
+			return;
+		}
+		while (*link && (*link)->state.version > oldestVersion)
+			link = &(*link)->older;
+		if (!*link)
+			return;
+		if ((*link)->state.present) {
+			freeChain((*link)->older);
+			(*link)->older = nullptr;
+		} else {
+			freeChain(*link);
+			*link = nullptr;
+		}
+	}
+
+	static void freeChain(Chain* c) {
+		while (c) {
+			Chain* older = c->older;
+			delete c;
+			c = older;
+		}
+	}
+
+	Position first() const {
+		Position p;
+		if (head->count) {
+			p.leaf = head;
+		}
+		return p;
+	}
+	Position last() const {
+		Position p;
+		if (tail->count) {
+			p.leaf = tail;
+			p.index = tail->count - 1;
+		}
+		return p;
+	}
+	static Position next(Position p) {
+		if (++p.index == p.leaf->count) {
+			p.leaf = p.leaf->next;
+			p.index = 0;
+		}
+		return p;
+	}
+	static Position previous(Position p) {
+		if (p.index-- == 0) {
+			p.leaf = p.leaf->prev;
+			p.index = p.leaf ? p.leaf->count - 1 : 0;
+		}
+		return p;
+	}
+
+	Leaf* findLeaf(K const& k) const {
+		Node* n = root;
+		while (!n->leaf) {
+			Internal* i = static_cast<Internal*>(n);
+			n = i->children[std::upper_bound(i->keys, i->keys + i->count - 1, k) - i->keys];
+		}
+		return static_cast<Leaf*>(n);
+	}
+	// The first entry >= k, or the end
+	Position lowerBound(K const& k) const {
+		Position p;
+		p.leaf = findLeaf(k);
+		p.index = std::lower_bound(p.leaf->keys, p.leaf->keys + p.leaf->count, k) - p.leaf->keys;
+		if (p.index == p.leaf->count) {
+			p.leaf = p.leaf->next;
+			p.index = 0;
+		}
+		return p;
+	}
+	// The first entry > k, or the end
+	Position upperBound(K const& k) const {
+		Position p;
+		p.leaf = findLeaf(k);
+		p.index = std::upper_bound(p.leaf->keys, p.leaf->keys + p.leaf->count, k) - p.leaf->keys;
+		if (p.index == p.leaf->count) {
+			p.leaf = p.leaf->next;
+			p.index = 0;
+		}
+		return p;
+	}
+
+	static int childIndex(Internal const* parent, Node const* child) {
+		int i = 0;
+		while (parent->children[i] != child)
+			++i;
+		return i;
+	}
+
+	static K const& smallestKey(Node const* n) {
+		while (!n->leaf)
+			n = static_cast<Internal const*>(n)->children[0];
+		return static_cast<Leaf const*>(n)->keys[0];
+	}
+
+	// Points the separator for n's subtree at its current smallest key
+	void refreshSeparator(Node* n) {
+		Node* child = n;
+		Internal* parent = n->parent;
+		while (parent && parent->children[0] == child) {
+			child = parent;
+			parent = parent->parent;
+		}
+		if (parent) {
+			parent->keys[childIndex(parent, child) - 1] = smallestKey(n);
+		}
+	}
+
+	// Inserts a new key before p, which must be in a leaf (it may be one past the leaf's last entry)
+	void insertEntry(Position p, K const& k, State const& s) {
+		++epoch;
+		Leaf* leaf = p.leaf;
+		if (leaf->count == leafCapacity) {
+			Leaf* right = splitLeaf(leaf);
+			if (p.index > leaf->count) {
+				p.index -= leaf->count;
+				leaf = right;
+			}
+		}
+		int i = p.index;
+		std::move_backward(leaf->keys + i, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+		std::move_backward(leaf->states + i, leaf->states + leaf->count, leaf->states + leaf->count + 1);
+		std::move_backward(leaf->older + i, leaf->older + leaf->count, leaf->older + leaf->count + 1);
+		leaf->keys[i] = k;
+		leaf->states[i] = s;
+		leaf->older[i] = nullptr;
+		++leaf->count;
+		if (i == 0)
+			refreshSeparator(leaf);
+	}
+
+	// Moves the upper half of a full leaf into a new leaf after it
+	Leaf* splitLeaf(Leaf* leaf) {
+		Leaf* right = new Leaf;
+		int keep = leaf->count / 2;
+		int moved = leaf->count - keep;
+		std::move(leaf->keys + keep, leaf->keys + leaf->count, right->keys);
+		std::move(leaf->states + keep, leaf->states + leaf->count, right->states);
+		std::move(leaf->older + keep, leaf->older + leaf->count, right->older);
+		leaf->count = keep;
+		right->count = moved;
+
+		right->prev = leaf;
+		right->next = leaf->next;
+		if (leaf->next)
+			leaf->next->prev = right;
+		else
+			tail = right;
+		leaf->next = right;
+
+		insertChild(leaf, right->keys[0], right);
+		return right;
+	}
+
+	// Adds right to left's parent just after left, separated by key
+	void insertChild(Node* left, K const& key, Node* right) {
+		Internal* parent = left->parent;
+		if (!parent) {
+			Internal* newRoot = new Internal;
+			newRoot->children[0] = left;
+			newRoot->children[1] = right;
+			newRoot->keys[0] = key;
+			newRoot->count = 2;
+			left->parent = right->parent = newRoot;
+			root = newRoot;
+			return;
+		}
+		if (parent->count == internalCapacity + 1) {
+			splitInternal(parent);
+			parent = left->parent;
+		}
+		int i = childIndex(parent, left);
+		std::move_backward(parent->keys + i, parent->keys + parent->count - 1, parent->keys + parent->count);
+		std::move_backward(parent->children + i + 1, parent->children + parent->count, parent->children + parent->count + 1);
+		parent->keys[i] = key;
+		parent->children[i + 1] = right;
+		right->parent = parent;
+		++parent->count;
+	}
+
+	void splitInternal(Internal* node) {
+		Internal* right = new Internal;
+		int keep = node->count / 2;
+		int moved = node->count - keep;
+		std::move(node->children + keep, node->children + node->count, right->children);
+		std::move(node->keys + keep, node->keys + node->count - 1, right->keys);
+		for (int i = 0; i < moved; i++)
+			right->children[i]->parent = right;
+		right->count = moved;
+		node->count = keep;
+		insertChild(node, node->keys[keep - 1], right);
+	}
+
+	// Removes the entry at p and returns the position after it
+	Position removeEntry(Position p) {
+		++epoch;
+		Leaf* leaf = p.leaf;
+		freeChain(leaf->older[p.index]);
+		if (leaf->count == 1 && leaf != root) {
+			Position after;
+			after.leaf = leaf->next;
+			removeNode(leaf);
+			return after;
+		}
+		int i = p.index;
+		std::move(leaf->keys + i + 1, leaf->keys + leaf->count, leaf->keys + i);
+		std::move(leaf->states + i + 1, leaf->states + leaf->count, leaf->states + i);
+		std::move(leaf->older + i + 1, leaf->older + leaf->count, leaf->older + i);
+		--leaf->count;
+		// Don't hold on to the memory of keys and values that are no longer in the map
+		leaf->keys[leaf->count] = K();
+		leaf->states[leaf->count] = State();
+		if (i == 0 && leaf->count)
+			refreshSeparator(leaf);
+		return i < leaf->count ? p : Position{ leaf->next, 0 };
+	}
+
+	// Unlinks and frees an empty leaf or internal node, which is not the root
+	void removeNode(Node* n) {
+		Internal* parent = n->parent;
+		int i = childIndex(parent, n);
+		if (n->leaf) {
+			Leaf* leaf = static_cast<Leaf*>(n);
+			(leaf->prev ? leaf->prev->next : head) = leaf->next;
+			(leaf->next ? leaf->next->prev : tail) = leaf->prev;
+			delete leaf;
+		} else {
+			delete static_cast<Internal*>(n);
+		}
+
+		// Removing children[i] also removes the key separating it from its neighbour
+		if (parent->count > 1) {
+			int k = std::max(i - 1, 0);
+			std::move(parent->keys + k + 1, parent->keys + parent->count - 1, parent->keys + k);
+		}
+		std::move(parent->children + i + 1, parent->children + parent->count, parent->children + i);
+		--parent->count;
+
+		if (parent == root && parent->count == 1) {
+			root = parent->children[0];
+			root->parent = nullptr;
+			delete parent;
+		} else if (parent->count == 0) {
+			removeNode(parent);
+		} else if (i == 0) {
+			refreshSeparator(parent);
+		}
+	}
+
+	void destroy(Node* n) {
+		if (n->leaf) {
+			Leaf* leaf = static_cast<Leaf*>(n);
+			for (int i = 0; i < leaf->count; i++)
+				freeChain(leaf->older[i]);
+			delete leaf;
+		} else {
+			Internal* node = static_cast<Internal*>(n);
+			for (int i = 0; i < node->count; i++)
+				destroy(node->children[i]);
+			delete node;
+		}
+	}
+
+	void validate(Node const* n, K const* min, K const* max, int& entries) const {
+		if (n->leaf) {
+			Leaf const* leaf = static_cast<Leaf const*>(n);
+			ASSERT(leaf->count > 0 || leaf == root);
+			for (int i = 0; i < leaf->count; i++) {
+				ASSERT((!min || !(leaf->keys[i] < *min)) && (!max || leaf->keys[i] < *max));
+				Version v = leaf->states[i].version;
+				ASSERT(v <= latestVersion);
+				for (Chain const* c = leaf->older[i]; c; c = c->older) {
+					ASSERT(c->state.version < v);
+					v = c->state.version;
+				}
+			}
+			entries += leaf->count;
+			return;
+		}
+		Internal const* node = static_cast<Internal const*>(n);
+		ASSERT(node->count >= 2 || (node->count >= 1 && node != root));
+		for (int i = 0; i < node->count; i++) {
+			ASSERT(node->children[i]->parent == node);
+			if (i > 0)
+				ASSERT(node->keys[i - 1] == smallestKey(node->children[i]));
+			validate(node->children[i],
+			         i > 0 ? &node->keys[i - 1] : min,
+			         i < node->count - 1 ? &node->keys[i] : max,
+			         entries);
+		}
+	}
+};
+
+#endif
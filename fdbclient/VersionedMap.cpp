@@ -27,6 +27,8 @@ struct VersionedMapHarness {
 
 	map s;
 
+	explicit VersionedMapHarness(bool useVersionChains = false) : s(useVersionChains) {}
+
 	void insert(K const& k) { s.insert(k, 1); }
 	result find(K const& k) const { return result(s.atLatest().find(k)); }
 	result not_found() const { return result(s.atLatest().end()); }
@@ -54,4 +56,82 @@ TEST_CASE("performance/map/StringRef/VersionedMap") {
 	return Void();
 }
 
+TEST_CASE("performance/map/int/VersionedMap/versionChains") {
+	VersionedMapHarness<int> tree(true);
+
+	treeBenchmark(tree, *randomInt);
+
+	return Void();
+}
+
+TEST_CASE("performance/map/StringRef/VersionedMap/versionChains") {
+	Arena arena;
+	VersionedMapHarness<StringRef> tree(true);
+
+	treeBenchmark(tree, [&arena]() { return randomStr(arena); });
+
+	return Void();
+}
+
+// Applies the same random sets and clears to a PTree and a version chain VersionedMap, and checks that they agree at
+// every version still in the window
+TEST_CASE("/fdbclient/VersionedMap/versionChains") {
+	VersionedMap<int, int> ptree;
+	VersionedMap<int, int> chains(true);
+	const int keys = deterministicRandom()->randomInt(1, 5000);
+
+	auto check = [&](Version v) {
+		auto p = ptree.at(v);
+		auto c = chains.at(v);
+		auto i = p.begin();
+		auto j = c.begin();
+		for (; i != p.end(); ++i, ++j) {
+			ASSERT(j != c.end() && i.key() == j.key() && *i == *j && i.insertVersion() == j.insertVersion());
+		}
+		ASSERT(j == c.end());
+		for (int n = 0; n < 20; n++) {
+			int k = deterministicRandom()->randomInt(-1, keys + 1);
+			auto a = p.lastLessOrEqual(k);
+			auto b = c.lastLessOrEqual(k);
+			ASSERT(bool(a) == bool(b) && (!a || a.key() == b.key()));
+			a = p.upper_bound(k);
+			b = c.upper_bound(k);
+			ASSERT(bool(a) == bool(b) && (!a || a.key() == b.key()));
+		}
+		c.validate();
+	};
+
+	for (Version v = 1; v <= 500; v++) {
+		ptree.createNewVersion(v);
+		chains.createNewVersion(v);
+		int ops = deterministicRandom()->randomInt(1, 100);
+		for (int n = 0; n < ops; n++) {
+			int k = deterministicRandom()->randomInt(0, keys);
+			if (deterministicRandom()->coinflip()) {
+				int value = deterministicRandom()->randomInt(0, 1000);
+				Version insertAt = deterministicRandom()->random01() < 0.1 ? v - 1 : v;
+				ptree.insert(k, value, insertAt);
+				chains.insert(k, value, insertAt);
+			} else if (deterministicRandom()->coinflip()) {
+				if (ptree.atLatest().find(k)) {
+					ptree.erase(k);
+					chains.erase(k);
+				}
+			} else {
+				int end = k + deterministicRandom()->randomInt(1, 100);
+				ptree.erase(k, end);
+				chains.erase(k, end);
+			}
+		}
+		if (deterministicRandom()->random01() < 0.2) {
+			Version oldest = deterministicRandom()->randomInt64(ptree.getOldestVersion(), v + 1);
+			ptree.forgetVersionsBefore(oldest);
+			chains.forgetVersionsBefore(oldest);
+		}
+		check(deterministicRandom()->randomInt64(ptree.getOldestVersion(), v + 1));
+	}
+
+	return Void();
+}
+
 void forceLinkVersionedMapTests() {}
@@ -26,6 +26,7 @@
 #include "flow/IndexedSet.h"
 #include "fdbclient/FDBTypes.h"
 #include "flow/IRandom.h"
+#include "fdbclient/VersionChainMap.h"
 #include "fdbclient/VersionedMap.actor.h"
 
 // PTree is a persistent balanced binary tree implementation. It is based on a treap as a way to guarantee O(1) space
@@ -598,6 +599,7 @@ void compact(Reference<PTree<T>>& p, Version newOldestVersion) {
 
 class ValueOrClearToRef {
 public:
+	ValueOrClearToRef() : isClear(false) {}
 	static ValueOrClearToRef value(ValueRef const& v) { return ValueOrClearToRef(v, false); }
 	static ValueOrClearToRef clearTo(KeyRef const& k) { return ValueOrClearToRef(k, true); }
 
@@ -621,7 +623,7 @@ private:
 
 // VersionedMap provides an interface to a partially persistent tree, allowing you to read the values at a particular
 // version, create new versions, modify the current version of the tree, and forget versions prior to a specific
-// version.
+// version. When constructed with useVersionChains it keeps its data in a VersionChainMap instead of a PTree.
 template <class K, class T>
 class VersionedMap : NonCopyable {
 	// private:
@@ -629,8 +631,10 @@ public:
 	typedef PTreeImpl::PTree<MapPair<K, std::pair<T, Version>>> PTreeT;
 	typedef PTreeImpl::PTreeFinger<MapPair<K, std::pair<T, Version>>> PTreeFingerT;
 	typedef Reference<PTreeT> Tree;
+	typedef VersionChainMap<K, T> ChainMap;
 
 	Version oldestVersion, latestVersion;
+	std::unique_ptr<ChainMap> chains;
 
 	// This deque keeps track of PTree root nodes at various versions. Since the
 	// versions increase monotonically, the deque is implicitly sorted and hence
@@ -652,12 +656,18 @@ public:
 	static const int overheadPerItem = nextFastAllocatedSize(sizeof(PTreeT)) * 4;
 	struct iterator;
 
-	VersionedMap() : oldestVersion(0), latestVersion(0) { roots.emplace_back(0, Tree()); }
+	explicit VersionedMap(bool useVersionChains = false) : oldestVersion(0), latestVersion(0) {
+		roots.emplace_back(0, Tree());
+		if (useVersionChains)
+			chains = std::make_unique<ChainMap>();
+	}
 	VersionedMap(VersionedMap&& v) noexcept
-	  : oldestVersion(v.oldestVersion), latestVersion(v.latestVersion), roots(std::move(v.roots)) {}
+	  : oldestVersion(v.oldestVersion), latestVersion(v.latestVersion), chains(std::move(v.chains)),
+	    roots(std::move(v.roots)) {}
 	void operator=(VersionedMap&& v) noexcept {
 		oldestVersion = v.oldestVersion;
 		latestVersion = v.latestVersion;
+		chains = std::move(v.chains);
 		roots = std::move(v.roots);
 	}
 
@@ -669,6 +679,11 @@ public:
 
 	void forgetVersionsBefore(Version newOldestVersion) {
 		ASSERT(newOldestVersion <= latestVersion);
+		if (chains) {
+			chains->forgetVersionsBefore(newOldestVersion);
+			oldestVersion = newOldestVersion;
+			return;
+		}
 		auto r = upper_bound(roots.begin(), roots.end(), newOldestVersion, rootsComparator());
 		auto upper = r;
 		--r;
@@ -685,6 +700,11 @@ public:
 
 	Future<Void> forgetVersionsBeforeAsync(Version newOldestVersion, TaskPriority taskID = TaskPriority::DefaultYield) {
 		ASSERT(newOldestVersion <= latestVersion);
+		if (chains) {
+			// Only the states superseded since the last call are freed, which is no more work than creating them was
+			forgetVersionsBefore(newOldestVersion);
+			return Void();
+		}
 		auto r = upper_bound(roots.begin(), roots.end(), newOldestVersion, rootsComparator());
 		auto upper = r;
 		--r;
@@ -720,7 +740,10 @@ public:
 public:
 	void createNewVersion(Version version) { // following sets and erases are into the given version, which may now be
 		                                     // passed to at().  Must be called in monotonically increasing order.
-		if (version > latestVersion) {
+		if (version > latestVersion && chains) {
+			latestVersion = version;
+			chains->createNewVersion(version);
+		} else if (version > latestVersion) {
 			latestVersion = version;
 			Tree r = getRoot(version);
 			roots.emplace_back(version, r);
@@ -731,6 +754,10 @@ public:
 	// insert() and erase() invalidate atLatest() and all iterators into it
 	void insert(const K& k, const T& t) { insert(k, t, latestVersion); }
 	void insert(const K& k, const T& t, Version insertAt) {
+		if (chains) {
+			chains->insert(k, t, insertAt);
+			return;
+		}
 		if (PTreeImpl::contains(roots.back().second, latestVersion, k))
 			PTreeImpl::remove(roots.back().second,
 			                  latestVersion,
@@ -738,9 +765,17 @@ public:
 		PTreeImpl::insert(
 		    roots.back().second, latestVersion, MapPair<K, std::pair<T, Version>>(k, std::make_pair(t, insertAt)));
 	}
-	void erase(const K& begin, const K& end) { PTreeImpl::remove(roots.back().second, latestVersion, begin, end); }
+	void erase(const K& begin, const K& end) {
+		if (chains)
+			chains->erase(begin, end);
+		else
+			PTreeImpl::remove(roots.back().second, latestVersion, begin, end);
+	}
 	void erase(const K& key) { // key must be present
-		PTreeImpl::remove(roots.back().second, latestVersion, key);
+		if (chains)
+			chains->erase(key);
+		else
+			PTreeImpl::remove(roots.back().second, latestVersion, key);
 	}
 	void erase(iterator const& item) { // iterator must be in latest version!
 		// SOMEDAY: Optimize to use item.finger and avoid repeated search
@@ -754,6 +789,8 @@ public:
 
 	void compact(Version newOldestVersion) {
 		ASSERT(newOldestVersion <= latestVersion);
+		if (chains)
+			return; // forgetVersionsBefore() already freed everything it could
 		// auto newBegin = roots.lower_bound(newOldestVersion);
 		auto newBegin = lower_bound(roots.begin(), roots.end(), newOldestVersion, rootsComparator());
 		for (auto root = roots.begin(); root != newBegin; ++root) {
@@ -767,35 +804,44 @@ public:
 	// for(auto i = vm.at(version).lower_bound(range.begin); i < range.end; ++i)
 	struct iterator {
 		explicit iterator(Tree const& root, Version at) : root(root), at(at) {}
+		explicit iterator(typename ChainMap::Cursor const& cursor) : cursor(cursor), chained(true) {}
 
-		K const& key() const { return finger.back()->data.key; }
+		K const& key() const { return chained ? cursor.key() : finger.back()->data.key; }
 		Version insertVersion() const {
-			return finger.back()->data.value.second;
+			return chained ? cursor.insertVersion() : finger.back()->data.value.second;
 		} // Returns the version at which the current item was inserted
-		operator bool() const { return finger.size() != 0; }
+		operator bool() const { return chained ? cursor.valid() : finger.size() != 0; }
 		bool operator<(const K& key) const { return this->key() < key; }
 
-		T const& operator*() { return finger.back()->data.value.first; }
-		T const* operator->() { return &finger.back()->data.value.first; }
+		T const& operator*() { return chained ? cursor.value() : finger.back()->data.value.first; }
+		T const* operator->() { return chained ? &cursor.value() : &finger.back()->data.value.first; }
 		void operator++() {
-			if (finger.size())
+			if (chained)
+				cursor.next();
+			else if (finger.size())
 				PTreeImpl::next(at, finger);
 			else
 				PTreeImpl::first(root, at, finger);
 		}
 		void operator--() {
-			if (finger.size())
+			if (chained)
+				cursor.previous();
+			else if (finger.size())
 				PTreeImpl::previous(at, finger);
 			else
 				PTreeImpl::last(root, at, finger);
 		}
 		bool operator==(const iterator& r) const {
+			if (chained)
+				return cursor == r.cursor;
 			if (finger.size() && r.finger.size())
 				return finger.back() == r.finger.back();
 			else
 				return finger.size() == r.finger.size();
 		}
 		bool operator!=(const iterator& r) const {
+			if (chained)
+				return !(cursor == r.cursor);
 			if (finger.size() && r.finger.size())
 				return finger.back() != r.finger.back();
 			else
@@ -807,22 +853,31 @@ public:
 		Tree root;
 		Version at;
 		PTreeFingerT finger;
+		typename ChainMap::Cursor cursor;
+		bool chained = false;
 	};
 
 	class ViewAtVersion {
 	public:
 		ViewAtVersion(Tree const& root, Version at) : root(root), at(at) {}
+		ViewAtVersion(ChainMap const* chains, Version at) : at(at), chains(chains) {}
 
 		iterator begin() const {
+			if (chains)
+				return iterator(chains->begin(at));
 			iterator i(root, at);
 			PTreeImpl::first(root, at, i.finger);
 			return i;
 		}
-		iterator end() const { return iterator(root, at); }
+		iterator end() const { return chains ? iterator(chains->end(at)) : iterator(root, at); }
 
 		// Returns x such that key==*x, or end()
 		template <class X>
 		iterator find(const X& key) const {
+			if (chains) {
+				iterator i(chains->lowerBound(at, key));
+				return i && i.key() == key ? i : end();
+			}
 			iterator i(root, at);
 			PTreeImpl::lower_bound(root, at, key, i.finger);
 			if (i && i.key() == key)
@@ -834,6 +889,8 @@ public:
 		// Returns the smallest x such that *x>=key, or end()
 		template <class X>
 		iterator lower_bound(const X& key) const {
+			if (chains)
+				return iterator(chains->lowerBound(at, key));
 			iterator i(root, at);
 			PTreeImpl::lower_bound(root, at, key, i.finger);
 			return i;
@@ -842,6 +899,8 @@ public:
 		// Returns the smallest x such that *x>key, or end()
 		template <class X>
 		iterator upper_bound(const X& key) const {
+			if (chains)
+				return iterator(chains->upperBound(at, key));
 			iterator i(root, at);
 			PTreeImpl::upper_bound(root, at, key, i.finger);
 			return i;
@@ -850,8 +909,7 @@ public:
 		// Returns the largest x such that *x<=key, or end()
 		template <class X>
 		iterator lastLessOrEqual(const X& key) const {
-			iterator i(root, at);
-			PTreeImpl::upper_bound(root, at, key, i.finger);
+			iterator i = upper_bound(key);
 			--i;
 			return i;
 		}
@@ -859,13 +917,16 @@ public:
 		// Returns the largest x such that *x<key, or end()
 		template <class X>
 		iterator lastLess(const X& key) const {
-			iterator i(root, at);
-			PTreeImpl::lower_bound(root, at, key, i.finger);
+			iterator i = lower_bound(key);
 			--i;
 			return i;
 		}
 
 		void validate() {
+			if (chains) {
+				chains->validate();
+				return;
+			}
 			int count = 0, height = 0;
 			PTreeImpl::validate<MapPair<K, std::pair<T, Version>>>(root, at, nullptr, nullptr, count, height);
 			if (height > 100)
@@ -875,10 +936,15 @@ public:
 	private:
 		Tree root;
 		Version at;
+		ChainMap const* chains = nullptr;
 	};
 
-	ViewAtVersion at(Version v) const { return ViewAtVersion(getRoot(v), v); }
-	ViewAtVersion atLatest() const { return ViewAtVersion(roots.back().second, latestVersion); }
+	ViewAtVersion at(Version v) const {
+		return chains ? ViewAtVersion(chains.get(), v) : ViewAtVersion(getRoot(v), v);
+	}
+	ViewAtVersion atLatest() const {
+		return chains ? ViewAtVersion(chains.get(), latestVersion) : ViewAtVersion(roots.back().second, latestVersion);
+	}
 
 	bool isClearContaining(ViewAtVersion const& view, KeyRef key) {
 		auto i = view.lastLessOrEqual(key);
@@ -0,0 +1,680 @@
+/*
+ * AsyncFileIOUring.actor.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2022 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#if defined(__linux__) && defined(WITH_LIBURING)
+
+// When actually compiled (NO_INTELLISENSE), include the generated version of this file.  In intellisense use the source
+// version.
+#if defined(NO_INTELLISENSE) && !defined(FLOW_ASYNCFILEIOURING_ACTOR_G_H)
+#define FLOW_ASYNCFILEIOURING_ACTOR_G_H
+#include "fdbrpc/AsyncFileIOUring.actor.g.h"
+#elif !defined(FLOW_ASYNCFILEIOURING_ACTOR_H)
+#define FLOW_ASYNCFILEIOURING_ACTOR_H
+
+#include "fdbrpc/IAsyncFile.h"
+#include "fdbrpc/AsyncFileEIO.actor.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <liburing.h>
+#include "flow/Knobs.h"
+#include "flow/UnitTest.h"
+#include "flow/genericactors.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// An IAsyncFile backed by a single io_uring shared by all files in the process.  Like AsyncFileKAIO, requests are
+// queued by task priority and submitted in batches from the run loop (INetwork::enRunCycleFunc), and completions are
+// harvested when the network eventfd registered with the ring becomes readable.  Unlike KAIO, fdatasync is issued
+// through the ring instead of an EIO thread, files may be opened without O_DIRECT, and each file's descriptor is
+// registered with the ring (when a slot is available) so the kernel can skip the per-request fd lookup.
+class AsyncFileIOUring final : public IAsyncFile, public ReferenceCounted<AsyncFileIOUring> {
+public:
+	static Future<Reference<IAsyncFile>> open(std::string filename, int flags, int mode, void* ignore) {
+		ASSERT(isEnabled());
+
+		if (flags & OPEN_LOCK)
+			mode |= 02000; // Enable mandatory locking for this file if it is supported by the filesystem
+
+		std::string open_filename = filename;
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			ASSERT((flags & OPEN_CREATE) && (flags & OPEN_READWRITE) && !(flags & OPEN_EXCLUSIVE));
+			open_filename = filename + ".part";
+		}
+
+		int fd = ::open(open_filename.c_str(), openFlags(flags), mode);
+		if (fd < 0) {
+			Error e = errno == ENOENT ? file_not_found() : io_error();
+			TraceEvent("AsyncFileIOUringOpenFailed")
+			    .error(e)
+			    .detail("Filename", filename)
+			    .detailf("Flags", "%x", flags)
+			    .detailf("OSFlags", "%x", openFlags(flags))
+			    .detailf("Mode", "0%o", mode)
+			    .GetLastError();
+			return e;
+		}
+
+		Reference<AsyncFileIOUring> r(new AsyncFileIOUring(fd, flags, filename));
+
+		if (flags & OPEN_LOCK) {
+			// Acquire a "write" lock for the entire file
+			flock lockDesc;
+			lockDesc.l_type = F_WRLCK;
+			lockDesc.l_whence = SEEK_SET;
+			lockDesc.l_start = 0;
+			lockDesc.l_len = 0;
+			lockDesc.l_pid = 0;
+			if (fcntl(fd, F_SETLK, &lockDesc) == -1) {
+				TraceEvent(SevError, "UnableToLockFile").detail("Filename", filename).GetLastError();
+				return io_error();
+			}
+		}
+
+		struct stat buf;
+		if (fstat(fd, &buf)) {
+			TraceEvent("AsyncFileIOUringFStatError").detail("Fd", fd).detail("Filename", filename).GetLastError();
+			return io_error();
+		}
+
+		r->lastFileSize = r->nextFileSize = buf.st_size;
+
+		TraceEvent("AsyncFileIOUringOpen")
+		    .detail("Filename", filename)
+		    .detail("Flags", flags)
+		    .detail("Mode", mode)
+		    .detail("Fd", fd)
+		    .detail("FixedFile", r->fixedIndex);
+		return Reference<IAsyncFile>(std::move(r));
+	}
+
+	// Sets up the ring.  Returns false if the running kernel does not support io_uring, in which case the caller
+	// should fall back to AsyncFileKAIO.
+	static bool init(Reference<IEventFD> ev, double ioTimeout) {
+		ASSERT(!g_network->isSimulated());
+		ctx.countAIOSubmit.init(LiteralStringRef("AsyncFile.CountAIOSubmit"));
+		ctx.countAIOCollect.init(LiteralStringRef("AsyncFile.CountAIOCollect"));
+		ctx.submitMetric.init(LiteralStringRef("AsyncFile.Submit"));
+		ctx.countPreSubmitTruncate.init(LiteralStringRef("AsyncFile.CountPreAIOSubmitTruncate"));
+		ctx.preSubmitTruncateBytes.init(LiteralStringRef("AsyncFile.PreAIOSubmitTruncateBytes"));
+
+		int rc = io_uring_queue_init(FLOW_KNOBS->MAX_OUTSTANDING, &ctx.ring, 0);
+		if (rc < 0) {
+			TraceEvent(SevWarnAlways, "IOUringSetupError").detail("ErrorCode", -rc).detail("Description", strerror(-rc));
+			return false;
+		}
+
+		rc = io_uring_register_eventfd(&ctx.ring, ev->getFD());
+		if (rc < 0) {
+			TraceEvent(SevWarnAlways, "IOUringRegisterEventFDError")
+			    .detail("ErrorCode", -rc)
+			    .detail("Description", strerror(-rc));
+			io_uring_queue_exit(&ctx.ring);
+			return false;
+		}
+
+		// Reserve a sparse table of registered files; slots are filled in as files are opened.
+		if (FLOW_KNOBS->IO_URING_FIXED_FILES > 0) {
+			std::vector<int> fds(FLOW_KNOBS->IO_URING_FIXED_FILES, -1);
+			rc = io_uring_register_files(&ctx.ring, fds.data(), fds.size());
+			if (rc < 0) {
+				TraceEvent(SevWarn, "IOUringRegisterFilesError")
+				    .detail("ErrorCode", -rc)
+				    .detail("Description", strerror(-rc));
+			} else {
+				for (int i = fds.size() - 1; i >= 0; --i)
+					ctx.freeFixedFiles.push_back(i);
+			}
+		}
+
+		ctx.enabled = true;
+		setTimeout(ioTimeout);
+		poll(ev);
+
+		g_network->setGlobal(INetwork::enRunCycleFunc, (flowGlobalType)&AsyncFileIOUring::launch);
+		TraceEvent("IOUringInit")
+		    .detail("QueueDepth", FLOW_KNOBS->MAX_OUTSTANDING)
+		    .detail("FixedFiles", ctx.freeFixedFiles.size());
+		return true;
+	}
+
+	static bool isEnabled() { return ctx.enabled; }
+	static void setTimeout(double ioTimeout) { ctx.setIOTimeout(ioTimeout); }
+
+	void addref() override { ReferenceCounted<AsyncFileIOUring>::addref(); }
+	void delref() override { ReferenceCounted<AsyncFileIOUring>::delref(); }
+	Future<int> read(void* data, int length, int64_t offset) override {
+		++countFileLogicalReads;
+		++countLogicalReads;
+
+		if (failed) {
+			return io_timeout();
+		}
+
+		IOBlock* io = new IOBlock(IOBlock::READ);
+		io->buf = data;
+		io->nbytes = length;
+		io->offset = offset;
+
+		enqueue(io);
+		return io->result.getFuture();
+	}
+	Future<Void> write(void const* data, int length, int64_t offset) override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if (failed) {
+			return io_timeout();
+		}
+
+		IOBlock* io = new IOBlock(IOBlock::WRITE);
+		io->buf = (void*)data;
+		io->nbytes = length;
+		io->offset = offset;
+
+		nextFileSize = std::max(nextFileSize, offset + length);
+
+		enqueue(io);
+		return success(io->result.getFuture());
+	}
+#ifndef FALLOC_FL_ZERO_RANGE
+#define FALLOC_FL_ZERO_RANGE 0x10
+#endif
+	Future<Void> zeroRange(int64_t offset, int64_t length) override {
+		bool success = false;
+		if (ctx.fallocateZeroSupported) {
+			int rc = fallocate(fd, FALLOC_FL_ZERO_RANGE, offset, length);
+			if (rc < 0 && errno == EOPNOTSUPP) {
+				ctx.fallocateZeroSupported = false;
+			}
+			if (rc == 0) {
+				success = true;
+			}
+		}
+		return success ? Void() : IAsyncFile::zeroRange(offset, length);
+	}
+	Future<Void> truncate(int64_t size) override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if (failed) {
+			return io_timeout();
+		}
+
+		int result = -1;
+		bool completed = false;
+		double begin = timer_monotonic();
+
+		if (ctx.fallocateSupported && size >= lastFileSize) {
+			result = fallocate(fd, 0, 0, size);
+			if (result != 0) {
+				int fallocateErrCode = errno;
+				TraceEvent("AsyncFileIOUringAllocateError")
+				    .detail("Fd", fd)
+				    .detail("Filename", filename)
+				    .detail("Size", size)
+				    .GetLastError();
+				if (fallocateErrCode == EOPNOTSUPP) {
+					// Mark fallocate as unsupported. Try again with truncate.
+					ctx.fallocateSupported = false;
+				} else {
+					return io_error();
+				}
+			} else {
+				completed = true;
+			}
+		}
+		if (!completed)
+			result = ftruncate(fd, size);
+
+		double end = timer_monotonic();
+		if (nondeterministicRandom()->random01() < end - begin) {
+			TraceEvent("SlowIOUringTruncate")
+			    .detail("TruncateTime", end - begin)
+			    .detail("TruncateBytes", size - lastFileSize);
+		}
+
+		if (result != 0) {
+			TraceEvent("AsyncFileIOUringTruncateError").detail("Fd", fd).detail("Filename", filename).GetLastError();
+			return io_error();
+		}
+
+		lastFileSize = nextFileSize = size;
+
+		return Void();
+	}
+
+	ACTOR static Future<Void> throwErrorIfFailed(Reference<AsyncFileIOUring> self, Future<Void> sync) {
+		wait(sync);
+		if (self->failed) {
+			throw io_timeout();
+		}
+		return Void();
+	}
+
+	Future<Void> sync() override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if (failed) {
+			return io_timeout();
+		}
+
+		// Unlike KAIO, io_uring implements fdatasync, so it goes through the ring with everything else rather than
+		// tying up an EIO thread.
+		IOBlock* io = new IOBlock(IOBlock::FDATASYNC);
+		enqueue(io);
+		Future<Void> fsync = throwErrorIfFailed(Reference<AsyncFileIOUring>::addRef(this), success(io->result.getFuture()));
+
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			flags &= ~OPEN_ATOMIC_WRITE_AND_CREATE;
+
+			return AsyncFileEIO::waitAndAtomicRename(fsync, filename + ".part", filename);
+		}
+
+		return fsync;
+	}
+	Future<int64_t> size() const override { return nextFileSize; }
+	int64_t debugFD() const override { return fd; }
+	std::string getFilename() const override { return filename; }
+	~AsyncFileIOUring() override {
+		if (fixedIndex >= 0) {
+			int empty = -1;
+			io_uring_register_files_update(&ctx.ring, fixedIndex, &empty, 1);
+			ctx.freeFixedFiles.push_back(fixedIndex);
+		}
+		close(fd);
+	}
+
+	static void launch() {
+		int prepared = 0;
+		if (ctx.queue.size() && ctx.outstanding < FLOW_KNOBS->MAX_OUTSTANDING - FLOW_KNOBS->MIN_SUBMIT) {
+			ctx.submitMetric = true;
+
+			double begin = timer_monotonic();
+			if (!ctx.outstanding)
+				ctx.ioStallBegin = begin;
+
+			int n = std::min<size_t>(FLOW_KNOBS->MAX_OUTSTANDING - ctx.outstanding, ctx.queue.size());
+			for (; prepared < n; prepared++) {
+				io_uring_sqe* sqe = io_uring_get_sqe(&ctx.ring);
+				if (!sqe)
+					break;
+
+				auto io = ctx.queue.top();
+				ctx.queue.pop();
+				io->startTime = now();
+
+				if (ctx.ioTimeout > 0) {
+					ctx.appendToRequestList(io);
+				}
+
+				AsyncFileIOUring* owner = io->owner.getPtr();
+				if (owner->lastFileSize != owner->nextFileSize) {
+					++ctx.countPreSubmitTruncate;
+					int64_t truncateSize = owner->nextFileSize - owner->lastFileSize;
+					ASSERT(truncateSize > 0);
+					ctx.preSubmitTruncateBytes += truncateSize;
+					owner->truncate(owner->nextFileSize);
+				}
+
+				io->prepare(sqe);
+			}
+
+			ctx.outstanding += prepared;
+			ctx.submitMetric = false;
+
+			double elapsed = timer_monotonic() - begin;
+			g_network->networkInfo.metrics.secSquaredSubmit += elapsed * elapsed / 2;
+		}
+
+		// SQEs left in the ring by an earlier interrupted or EAGAIN submit go out with this batch.
+		if (prepared || io_uring_sq_ready(&ctx.ring)) {
+			double begin = timer_monotonic();
+			int rc = io_uring_submit(&ctx.ring);
+			double end = timer_monotonic();
+			++ctx.countAIOSubmit;
+
+			if (rc < 0 && rc != -EAGAIN && rc != -EBUSY && rc != -EINTR) {
+				TraceEvent(SevError, "IOUringSubmitError").detail("ErrorCode", -rc).detail("Description", strerror(-rc));
+				throw io_error();
+			}
+			if (nondeterministicRandom()->random01() < end - begin) {
+				TraceEvent("SlowIOUringLaunch")
+				    .detail("IOSubmitTime", end - begin)
+				    .detail("Submitted", rc)
+				    .detail("Queued", ctx.queue.size());
+			}
+		}
+	}
+
+	bool failed;
+
+private:
+	int fd, flags;
+	int fixedIndex; // Slot in the ring's registered file table, or -1
+	int64_t lastFileSize, nextFileSize;
+	std::string filename;
+	Int64MetricHandle countFileLogicalWrites;
+	Int64MetricHandle countFileLogicalReads;
+
+	Int64MetricHandle countLogicalWrites;
+	Int64MetricHandle countLogicalReads;
+
+	struct IOBlock : FastAllocated<IOBlock> {
+		enum Op { READ, WRITE, FDATASYNC };
+
+		Op op;
+		void* buf;
+		int nbytes;
+		int64_t offset;
+		Promise<int> result;
+		Reference<AsyncFileIOUring> owner;
+		int64_t prio;
+		IOBlock* prev;
+		IOBlock* next;
+		double startTime;
+
+		struct indirect_order_by_priority {
+			bool operator()(IOBlock* a, IOBlock* b) { return a->prio < b->prio; }
+		};
+
+		explicit IOBlock(Op op)
+		  : op(op), buf(nullptr), nbytes(0), offset(0), prev(nullptr), next(nullptr), startTime(0) {}
+
+		TaskPriority getTask() const { return static_cast<TaskPriority>((prio >> 32) + 1); }
+
+		void prepare(io_uring_sqe* sqe) {
+			int target = owner->fixedIndex >= 0 ? owner->fixedIndex : owner->fd;
+			switch (op) {
+			case READ:
+				io_uring_prep_read(sqe, target, buf, nbytes, offset);
+				break;
+			case WRITE:
+				io_uring_prep_write(sqe, target, buf, nbytes, offset);
+				break;
+			case FDATASYNC:
+				io_uring_prep_fsync(sqe, target, IORING_FSYNC_DATASYNC);
+				break;
+			}
+			if (owner->fixedIndex >= 0)
+				sqe->flags |= IOSQE_FIXED_FILE;
+			io_uring_sqe_set_data(sqe, this);
+		}
+
+		ACTOR static void deliver(Promise<int> result, bool failed, int r, TaskPriority task) {
+			wait(delay(0, task));
+			if (failed)
+				result.sendError(io_timeout());
+			else if (r < 0)
+				result.sendError(io_error());
+			else
+				result.send(r);
+		}
+
+		void setResult(int r) {
+			if (r < 0) {
+				struct stat fst;
+				fstat(owner->fd, &fst);
+
+				errno = -r;
+				TraceEvent("AsyncFileIOUringIOError")
+				    .GetLastError()
+				    .detail("Fd", owner->fd)
+				    .detail("Op", (int)op)
+				    .detail("Nbytes", nbytes)
+				    .detail("Offset", offset)
+				    .detail("Ptr", int64_t(buf))
+				    .detail("Size", fst.st_size)
+				    .detail("Filename", owner->filename);
+			}
+			deliver(result, owner->failed, r, getTask());
+			delete this;
+		}
+
+		void timeout(bool warnOnly) {
+			TraceEvent(SevWarnAlways, "AsyncFileIOUringTimeout")
+			    .detail("Fd", owner->fd)
+			    .detail("Op", (int)op)
+			    .detail("Nbytes", nbytes)
+			    .detail("Offset", offset)
+			    .detail("Ptr", int64_t(buf))
+			    .detail("Filename", owner->filename);
+			g_network->setGlobal(INetwork::enASIOTimedOut, (flowGlobalType) true);
+
+			if (!warnOnly)
+				owner->failed = true;
+		}
+	};
+
+	struct Context {
+		io_uring ring;
+		bool enabled;
+		int outstanding;
+		double ioStallBegin;
+		bool fallocateSupported;
+		bool fallocateZeroSupported;
+		std::vector<int> freeFixedFiles;
+		std::priority_queue<IOBlock*, std::vector<IOBlock*>, IOBlock::indirect_order_by_priority> queue;
+		Int64MetricHandle countAIOSubmit;
+		Int64MetricHandle countAIOCollect;
+		Int64MetricHandle submitMetric;
+
+		double ioTimeout;
+		bool timeoutWarnOnly;
+		IOBlock* submittedRequestList;
+
+		Int64MetricHandle countPreSubmitTruncate;
+		Int64MetricHandle preSubmitTruncateBytes;
+
+		uint32_t opsIssued;
+		Context()
+		  : enabled(false), outstanding(0), ioStallBegin(0), fallocateSupported(true), fallocateZeroSupported(true),
+		    submittedRequestList(nullptr), opsIssued(0) {
+			setIOTimeout(0);
+		}
+
+		void setIOTimeout(double timeout) {
+			ioTimeout = fabs(timeout);
+			timeoutWarnOnly = timeout < 0;
+		}
+
+		void appendToRequestList(IOBlock* io) {
+			ASSERT(!io->next && !io->prev);
+
+			if (submittedRequestList) {
+				io->prev = submittedRequestList->prev;
+				io->prev->next = io;
+
+				submittedRequestList->prev = io;
+				io->next = submittedRequestList;
+			} else {
+				submittedRequestList = io;
+				io->next = io->prev = io;
+			}
+		}
+
+		void removeFromRequestList(IOBlock* io) {
+			if (io->next == nullptr) {
+				ASSERT(io->prev == nullptr);
+				return;
+			}
+
+			ASSERT(io->prev != nullptr);
+
+			if (io == io->next) {
+				ASSERT(io == submittedRequestList && io == io->prev);
+				submittedRequestList = nullptr;
+			} else {
+				io->next->prev = io->prev;
+				io->prev->next = io->next;
+
+				if (submittedRequestList == io) {
+					submittedRequestList = io->next;
+				}
+			}
+
+			io->next = io->prev = nullptr;
+		}
+	};
+	static Context ctx;
+
+	explicit AsyncFileIOUring(int fd, int flags, std::string const& filename)
+	  : failed(false), fd(fd), flags(flags), fixedIndex(-1), filename(filename) {
+		countFileLogicalWrites.init(LiteralStringRef("AsyncFile.CountFileLogicalWrites"), filename);
+		countFileLogicalReads.init(LiteralStringRef("AsyncFile.CountFileLogicalReads"), filename);
+		countLogicalWrites.init(LiteralStringRef("AsyncFile.CountLogicalWrites"));
+		countLogicalReads.init(LiteralStringRef("AsyncFile.CountLogicalReads"));
+
+		if (!ctx.freeFixedFiles.empty()) {
+			int slot = ctx.freeFixedFiles.back();
+			if (io_uring_register_files_update(&ctx.ring, slot, &fd, 1) == 1) {
+				ctx.freeFixedFiles.pop_back();
+				fixedIndex = slot;
+			}
+		}
+	}
+
+	void enqueue(IOBlock* io) {
+		// O_DIRECT requires aligned buffers, offsets and lengths; buffered files have no such restriction.
+		if (flags & OPEN_UNBUFFERED) {
+			ASSERT(int64_t(io->buf) % 4096 == 0 && io->offset % 4096 == 0 && io->nbytes % 4096 == 0);
+		}
+
+		io->prio = (int64_t(g_network->getCurrentTask()) << 32) - (++ctx.opsIssued);
+		io->owner = Reference<AsyncFileIOUring>::addRef(this);
+
+		ctx.queue.push(io);
+	}
+
+	static int openFlags(int flags) {
+		int oflags = O_CLOEXEC;
+		ASSERT(bool(flags & OPEN_READONLY) != bool(flags & OPEN_READWRITE)); // readonly xor readwrite
+		if (flags & OPEN_UNBUFFERED)
+			oflags |= O_DIRECT;
+		if (flags & OPEN_EXCLUSIVE)
+			oflags |= O_EXCL;
+		if (flags & OPEN_CREATE)
+			oflags |= O_CREAT;
+		if (flags & OPEN_READONLY)
+			oflags |= O_RDONLY;
+		if (flags & OPEN_READWRITE)
+			oflags |= O_RDWR;
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE)
+			oflags |= O_TRUNC;
+		return oflags;
+	}
+
+	ACTOR static void poll(Reference<IEventFD> ev) {
+		loop {
+			wait(success(ev->read()));
+
+			wait(delay(0, TaskPriority::DiskIOComplete));
+
+			io_uring_cqe* cqes[FLOW_KNOBS->MAX_OUTSTANDING];
+			int n = io_uring_peek_batch_cqe(&ctx.ring, cqes, FLOW_KNOBS->MAX_OUTSTANDING);
+
+			++ctx.countAIOCollect;
+			if (n) {
+				double t = timer_monotonic();
+				double elapsed = t - ctx.ioStallBegin;
+				ctx.ioStallBegin = t;
+				g_network->networkInfo.metrics.secSquaredDiskStall += elapsed * elapsed / 2;
+			}
+
+			ctx.outstanding -= n;
+
+			if (ctx.ioTimeout > 0) {
+				double currentTime = now();
+				while (ctx.submittedRequestList && currentTime - ctx.submittedRequestList->startTime > ctx.ioTimeout) {
+					ctx.submittedRequestList->timeout(ctx.timeoutWarnOnly);
+					ctx.removeFromRequestList(ctx.submittedRequestList);
+				}
+			}
+
+			for (int i = 0; i < n; i++) {
+				IOBlock* iob = static_cast<IOBlock*>(io_uring_cqe_get_data(cqes[i]));
+				int res = cqes[i]->res;
+
+				if (ctx.ioTimeout > 0) {
+					ctx.removeFromRequestList(iob);
+				}
+
+				iob->setResult(res);
+			}
+			io_uring_cq_advance(&ctx.ring, n);
+		}
+	}
+};
+
+TEST_CASE("/fdbrpc/AsyncFileIOUring/ReadWrite") {
+	// This test does nothing in simulation or when the ring could not be set up
+	if (!g_network->isSimulated() && AsyncFileIOUring::isEnabled()) {
+		state Reference<IAsyncFile> f;
+		state uint8_t* buf = (uint8_t*)FastAllocator<4096>::allocate();
+		state uint8_t* readBuf = (uint8_t*)FastAllocator<4096>::allocate();
+		state int pages = 64;
+		state int i;
+		try {
+			Reference<IAsyncFile> f_ = wait(AsyncFileIOUring::open(
+			    "/tmp/__IOURING_TEST_FILE__",
+			    IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_UNCACHED | IAsyncFile::OPEN_READWRITE |
+			        IAsyncFile::OPEN_CREATE,
+			    0666,
+			    nullptr));
+			f = f_;
+
+			// Writes extend the file through the pre-submit truncate path, then a ring fdatasync makes them durable.
+			for (i = 0; i < pages; ++i) {
+				memset(buf, i, 4096);
+				wait(f->write(buf, 4096, int64_t(i) * 4096));
+			}
+			wait(f->sync());
+			int64_t size = wait(f->size());
+			ASSERT(size == int64_t(pages) * 4096);
+
+			for (i = 0; i < pages; ++i) {
+				int read = wait(f->read(readBuf, 4096, int64_t(i) * 4096));
+				ASSERT(read == 4096);
+				ASSERT(readBuf[0] == uint8_t(i) && readBuf[4095] == uint8_t(i));
+			}
+			ASSERT(!((AsyncFileIOUring*)f.getPtr())->failed);
+		} catch (Error& e) {
+			state Error err = e;
+			FastAllocator<4096>::release(buf);
+			FastAllocator<4096>::release(readBuf);
+			if (f) {
+				wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+			}
+			throw err;
+		}
+
+		FastAllocator<4096>::release(buf);
+		FastAllocator<4096>::release(readBuf);
+		wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+	}
+
+	return Void();
+}
+
+AsyncFileIOUring::Context AsyncFileIOUring::ctx;
+
+#include "flow/unactorcompiler.h"
+#endif
+#endif
@@ -38,6 +38,7 @@
 #include "fdbrpc/QueueModel.h"
 #include "fdbrpc/MultiInterface.h"
 #include "fdbrpc/simulator.h" // for checking tss simulation mode
+#include "fdbrpc/TimedRequest.h"
 #include "fdbrpc/TSSComparison.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
 
@@ -459,6 +460,14 @@ Future<REPLY_TYPE(Request)> loadBalance(
 
 	state TriedAllOptions triedAllOptions = TriedAllOptions::False;
 
+	// If the caller gave the request a time budget, every copy we send carries whatever is left of it, and a second
+	// request is not worth sending once less remains than the second server is expected to take to answer.
+	state Optional<double> deadline;
+	state double secondLatency = 0;
+	if (getTimeBudget(&request).present()) {
+		deadline = startTime + getTimeBudget(&request).get();
+	}
+
 	setReplyPriority(request, taskID);
 	if (!alternatives)
 		return Never();
@@ -545,6 +554,7 @@ Future<REPLY_TYPE(Request)> loadBalance(
 		}
 
 		if (nextTime < 1e9) {
+			secondLatency = nextTime;
 			// Decide when to send the request to the second best choice.
 			if (bestTime > FLOW_KNOBS->INSTANT_SECOND_REQUEST_MULTIPLIER *
 			                   (model->secondMultiplier * (nextTime) + FLOW_KNOBS->BASE_SECOND_REQUEST_TIME)) {
@@ -637,6 +647,9 @@ Future<REPLY_TYPE(Request)> loadBalance(
 			firstRequestEndpoint = Optional<uint64_t>();
 		} else if (firstRequestData.isValid()) {
 			// Issue a second request, the first one is taking a long time.
+			if (deadline.present()) {
+				setTimeBudget(&request, std::max(deadline.get() - now(), 0.0));
+			}
 			secondRequestData.startRequest(backoff, triedAllOptions, stream, request, model, alternatives, channel);
 			state bool firstFinished = false;
 
@@ -666,6 +679,9 @@ Future<REPLY_TYPE(Request)> loadBalance(
 			}
 		} else {
 			// Issue a request, if it takes too long to get a reply, go around the loop
+			if (deadline.present()) {
+				setTimeBudget(&request, std::max(deadline.get() - now(), 0.0));
+			}
 			firstRequestData.startRequest(backoff, triedAllOptions, stream, request, model, alternatives, channel);
 			firstRequestEndpoint = stream->getEndpoint().token.first();
 
@@ -689,7 +705,9 @@ Future<REPLY_TYPE(Request)> loadBalance(
 					}
 					when(wait(secondDelay)) {
 						secondDelay = Never();
-						if (model && model->secondBudget >= 1.0) {
+						if (deadline.present() && deadline.get() - now() < secondLatency) {
+							TEST(true); // Not enough time budget left for a second request
+						} else if (model && model->secondBudget >= 1.0) {
 							model->secondMultiplier += FLOW_KNOBS->SECOND_REQUEST_MULTIPLIER_GROWTH;
 							model->secondBudget -= 1.0;
 							break;
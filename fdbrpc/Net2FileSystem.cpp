@@ -35,6 +35,7 @@
 #include "fdbrpc/AsyncFileEncrypted.h"
 #include "fdbrpc/AsyncFileWinASIO.actor.h"
 #include "fdbrpc/AsyncFileKAIO.actor.h"
+#include "fdbrpc/AsyncFileIOUring.actor.h"
 #include "flow/AsioReactor.h"
 #include "flow/Platform.h"
 #include "fdbrpc/AsyncFileWriteChecker.h"
@@ -59,6 +60,13 @@ Future<Reference<class IAsyncFile>> Net2FileSystem::open(const std::string& file
 		return AsyncFileCached::open(filename, flags, mode);
 
 	Future<Reference<IAsyncFile>> f;
+#if defined(__linux__) && defined(WITH_LIBURING)
+	// io_uring handles both buffered and O_DIRECT files, so when the ring is available it replaces KAIO as well as
+	// the EIO thread pool for uncached files.
+	if (AsyncFileIOUring::isEnabled() && !(flags & IAsyncFile::OPEN_NO_AIO))
+		f = AsyncFileIOUring::open(filename, flags, mode, nullptr);
+	else
+#endif
 #ifdef __linux__
 	// In the vast majority of cases, we wish to use Kernel AIO. However, some systems
 	// don’t properly support kernel async I/O without O_DIRECT or AIO at all. In such
@@ -113,7 +121,12 @@ void Net2FileSystem::newFileSystem(double ioTimeout, const std::string& fileSyst
 Net2FileSystem::Net2FileSystem(double ioTimeout, const std::string& fileSystemPath) {
 	Net2AsyncFile::init();
 #ifdef __linux__
-	if (!FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
+	bool ioUring = false;
+#ifdef WITH_LIBURING
+	if (FLOW_KNOBS->ENABLE_IO_URING)
+		ioUring = AsyncFileIOUring::init(Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout);
+#endif
+	if (!ioUring && !FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
 		AsyncFileKAIO::init(Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout);
 
 	if (fileSystemPath.empty()) {
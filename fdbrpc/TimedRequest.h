@@ -28,11 +28,21 @@ class TimedRequest {
 	double _requestTime;
 
 public:
+	// How long the sender was still willing to wait for a reply when it sent the request. This is a duration rather
+	// than an absolute deadline so that it does not depend on the sender's and receiver's clocks agreeing; the receiver
+	// measures it from requestTime(). Only carried over the wire by request types that serialize it.
+	Optional<double> timeBudget;
+
 	double requestTime() const {
 		ASSERT(_requestTime > 0.0);
 		return _requestTime;
 	}
 
+	// True if the request carries a time budget that ran out since it arrived, meaning the sender has already given up
+	bool expired() const {
+		return timeBudget.present() && _requestTime > 0.0 && timer() - _requestTime > timeBudget.get();
+	}
+
 	TimedRequest() {
 		if (!FlowTransport::isClient()) {
 			_requestTime = timer();
@@ -42,4 +52,17 @@ public:
 	}
 };
 
+// Overloads so that generic code such as loadBalance() can read and refresh the time budget of requests which may or
+// may not be TimedRequests
+inline Optional<double> getTimeBudget(const TimedRequest* request) {
+	return request->timeBudget;
+}
+inline Optional<double> getTimeBudget(const void*) {
+	return Optional<double>();
+}
+inline void setTimeBudget(TimedRequest* request, double budget) {
+	request->timeBudget = budget;
+}
+inline void setTimeBudget(void*, double) {}
+
 #endif
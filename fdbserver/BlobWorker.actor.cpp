@@ -27,6 +27,7 @@
 #include "fdbclient/SystemData.h"
 #include "fdbclient/BackupContainerFileSystem.h"
 #include "fdbclient/BlobGranuleCommon.h"
+#include "fdbclient/BlobGranuleFiles.h"
 #include "fdbclient/BlobGranuleReader.actor.h"
 #include "fdbclient/BlobWorkerCommon.h"
 #include "fdbclient/BlobWorkerInterface.h"
@@ -499,7 +500,7 @@ ACTOR Future<BlobFileIndex> writeDeltaFile(Reference<BlobWorkerData> bwData,
 	                          std::to_string((uint64_t)(1000.0 * now())) + "_V" + std::to_string(currentDeltaVersion) +
 	                          ".delta";
 
-	state Value serialized = ObjectWriter::toValue(deltasToWrite, Unversioned());
+	state Value serialized = serializeDeltaFile(deltasToWrite, keyRange, SERVER_KNOBS->BG_FILE_BLOCK_BYTES);
 
 	// FIXME: technically we can free up deltaArena here to reduce memory
 
@@ -642,8 +643,7 @@ ACTOR Future<BlobFileIndex> writeSnapshot(Reference<BlobWorkerData> bwData,
 		ASSERT(snapshot[i].key < snapshot[i + 1].key);
 	}
 
-	// TODO is this easy to read as a flatbuffer from reader? Need to be sure about this data format
-	state Value serialized = ObjectWriter::toValue(snapshot, Unversioned());
+	state Value serialized = serializeSnapshotFile(snapshot, SERVER_KNOBS->BG_FILE_BLOCK_BYTES);
 
 	// write to s3 using multi part upload
 	state Reference<IBackupFile> objectFile = wait(bwData->bstore->writeFile(fname));
@@ -877,8 +877,9 @@ static bool filterOldMutations(const KeyRange& range,
 		MutationsAndVersionRef filteredDelta;
 		filteredDelta.version = delta.version;
 		for (auto& m : delta.mutations) {
-			ASSERT(m.type == MutationRef::SetValue || m.type == MutationRef::ClearRange);
-			if (m.type == MutationRef::SetValue) {
+			// atomic ops are applied when the granule is read, so they are filtered like sets
+			ASSERT(m.type == MutationRef::ClearRange || isSingleKeyMutation((MutationRef::Type)m.type));
+			if (m.type != MutationRef::ClearRange) {
 				if (m.param1 >= range.begin && m.param1 < range.end) {
 					filteredDelta.mutations.push_back(mutations->arena(), m);
 				}
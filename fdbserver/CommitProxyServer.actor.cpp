@@ -412,6 +412,14 @@ ACTOR static Future<ResolveTransactionBatchReply> trackResolutionMetrics(Referen
 
 namespace CommitBatch {
 
+static ArenaProfile contextArenaProfile("CommitBatchContext");
+
+// The shard of a committed mutation, looked up ahead of time by lookupMutationShards()
+struct MutationShards {
+	ServerCacheInfo* shard = nullptr; // Null for a clear range that extends past a shard boundary
+	bool cached = false; // Whether the mutation also goes to the storage caches
+};
+
 struct CommitBatchContext {
 	using StoreCommit_t = std::vector<std::pair<Future<LogSystemDiskQueueAdapter::CommitMessage>, Future<Void>>>;
 
@@ -485,6 +493,10 @@ struct CommitBatchContext {
 	int transactionNum = 0;
 	int yieldBytes = 0;
 
+	// For large batches, the shards of the committed mutations in the order they are assigned to storage servers
+	std::vector<MutationShards> mutationShards;
+	int mutationShardsIndex = 0;
+
 	LogSystemDiskQueueAdapter::CommitMessage msg;
 
 	Future<Version> loggingComplete;
@@ -511,7 +523,7 @@ CommitBatchContext::CommitBatchContext(ProxyCommitData* const pProxyCommitData_,
 
     localBatchNumber(++pProxyCommitData->localCommitBatchesStarted), toCommit(pProxyCommitData->logSystem),
 
-    span("MP:commitBatch"_loc), committed(trs.size()) {
+    span("MP:commitBatch"_loc), arena(contextArenaProfile.newArena()), committed(trs.size()) {
 
 	evaluateBatchSize();
 
@@ -890,12 +902,63 @@ ACTOR Future<Void> applyMetadataToCommittedTransactions(CommitBatchContext* self
 	return Void();
 }
 
+/// Looks up the shards of a large batch's committed mutations across the proxy's tag assignment threads, leaving
+/// assignMutationsToStorageServers() to add the tags and serialize the mutations in order on the proxy's thread. The
+/// threads only read keyInfo and cacheInfo, which the metadata mutations have already updated for this batch, and
+/// the proxy's thread waits for them.
+void lookupMutationShards(CommitBatchContext* self) {
+	ProxyCommitData* const pProxyCommitData = self->pProxyCommitData;
+	if (!pProxyCommitData->tagAssignmentThreads) {
+		return;
+	}
+
+	std::vector<const MutationRef*> mutations;
+	for (int t = 0; t < self->trs.size(); t++) {
+		if (self->committed[t] == ConflictBatch::TransactionCommitted &&
+		    (!self->locked || self->trs[t].isLockAware())) {
+			for (const auto& m : self->trs[t].transaction.mutations) {
+				mutations.push_back(&m);
+			}
+		}
+	}
+	if (mutations.empty() || mutations.size() < (size_t)SERVER_KNOBS->PROXY_TAG_ASSIGNMENT_MIN_MUTATIONS) {
+		return;
+	}
+
+	self->mutationShards.resize(mutations.size());
+	PartThreads& threads = *pProxyCommitData->tagAssignmentThreads;
+	const int parts = std::min<int>(threads.parts(), mutations.size());
+	threads.run(parts, [&](int part) {
+		const size_t begin = mutations.size() * part / parts;
+		const size_t end = mutations.size() * (part + 1) / parts;
+		for (size_t i = begin; i < end; i++) {
+			const MutationRef& m = *mutations[i];
+			MutationShards& shards = self->mutationShards[i];
+			if (isSingleKeyMutation((MutationRef::Type)m.type)) {
+				shards.shard = &pProxyCommitData->keyInfo.rangeContaining(m.param1).value();
+				shards.cached = pProxyCommitData->cacheInfo[m.param1];
+			} else if (m.type == MutationRef::ClearRange) {
+				KeyRangeRef clearRange(m.param1, m.param2);
+				auto ranges = pProxyCommitData->keyInfo.intersectingRanges(clearRange);
+				auto secondRange = ranges.begin();
+				++secondRange;
+				if (secondRange == ranges.end()) {
+					shards.shard = &ranges.begin().value();
+				}
+				shards.cached = pProxyCommitData->needsCacheTag(clearRange);
+			}
+		}
+	});
+}
+
 /// This second pass through committed transactions assigns the actual mutations to the appropriate storage servers'
 /// tags
 ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 	state ProxyCommitData* const pProxyCommitData = self->pProxyCommitData;
 	state std::vector<CommitTransactionRequest>& trs = self->trs;
 
+	lookupMutationShards(self);
+
 	for (; self->transactionNum < trs.size(); self->transactionNum++) {
 		if (!(self->committed[self->transactionNum] == ConflictBatch::TransactionCommitted &&
 		      (!self->locked || trs[self->transactionNum].isLockAware()))) {
@@ -920,6 +983,8 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 			}
 
 			auto& m = (*pMutations)[mutationNum];
+			const MutationShards* shards =
+			    self->mutationShards.empty() ? nullptr : &self->mutationShards[self->mutationShardsIndex++];
 			self->mutationCount++;
 			self->mutationBytes += m.expectedSize();
 			self->yieldBytes += m.expectedSize();
@@ -927,7 +992,10 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 			// if necessary.  Serialize (splits of) the mutation into the message buffer and add the tags.
 
 			if (isSingleKeyMutation((MutationRef::Type)m.type)) {
-				auto& tags = pProxyCommitData->tagsForKey(m.param1);
+				if (shards) {
+					shards->shard->populateTags();
+				}
+				auto& tags = shards ? shards->shard->tags : pProxyCommitData->tagsForKey(m.param1);
 
 				// sample single key mutation based on cost
 				// the expectation of sampling is every COMMIT_SAMPLE_COST sample once
@@ -960,27 +1028,33 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 
 				DEBUG_MUTATION("ProxyCommit", self->commitVersion, m, pProxyCommitData->dbgid).detail("To", tags);
 				self->toCommit.addTags(tags);
-				if (pProxyCommitData->cacheInfo[m.param1]) {
+				if (shards ? shards->cached : pProxyCommitData->cacheInfo[m.param1]) {
 					self->toCommit.addTag(cacheTag);
 				}
 				self->toCommit.writeTypedMessage(m);
 			} else if (m.type == MutationRef::ClearRange) {
 				KeyRangeRef clearRange(KeyRangeRef(m.param1, m.param2));
-				auto ranges = pProxyCommitData->keyInfo.intersectingRanges(clearRange);
-				auto firstRange = ranges.begin();
-				++firstRange;
-				if (firstRange == ranges.end()) {
+				ServerCacheInfo* shard = shards ? shards->shard : nullptr;
+				if (!shards) {
+					auto ranges = pProxyCommitData->keyInfo.intersectingRanges(clearRange);
+					auto firstRange = ranges.begin();
+					++firstRange;
+					if (firstRange == ranges.end()) {
+						shard = &ranges.begin().value();
+					}
+				}
+				if (shard) {
 					// Fast path
 					DEBUG_MUTATION("ProxyCommit", self->commitVersion, m, pProxyCommitData->dbgid)
-					    .detail("To", ranges.begin().value().tags);
+					    .detail("To", shard->tags);
 
-					ranges.begin().value().populateTags();
-					self->toCommit.addTags(ranges.begin().value().tags);
+					shard->populateTags();
+					self->toCommit.addTags(shard->tags);
 
 					// check whether clear is sampled
 					if (checkSample && !trCost->get().clearIdxCosts.empty() &&
 					    trCost->get().clearIdxCosts[0].first == mutationNum) {
-						for (const auto& ssInfo : ranges.begin().value().src_info) {
+						for (const auto& ssInfo : shard->src_info) {
 							auto id = ssInfo->interf.id();
 							pProxyCommitData->updateSSTagCost(
 							    id, trs[self->transactionNum].tagSet.get(), m, trCost->get().clearIdxCosts[0].second);
@@ -989,6 +1063,7 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 					}
 				} else {
 					TEST(true); // A clear range extends past a shard boundary
+					auto ranges = pProxyCommitData->keyInfo.intersectingRanges(clearRange);
 					std::set<Tag> allSources;
 					for (auto r : ranges) {
 						r.value().populateTags();
@@ -1013,7 +1088,7 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 					self->toCommit.addTags(allSources);
 				}
 
-				if (pProxyCommitData->needsCacheTag(clearRange)) {
+				if (shards ? shards->cached : pProxyCommitData->needsCacheTag(clearRange)) {
 					self->toCommit.addTag(cacheTag);
 				}
 				self->toCommit.writeTypedMessage(m);
@@ -1467,6 +1542,7 @@ ACTOR Future<Void> commitBatch(ProxyCommitData* self,
 	/// latency)
 	wait(CommitBatch::reply(&context));
 
+	CommitBatch::contextArenaProfile.record(context.arena);
 	return Void();
 }
 
@@ -0,0 +1,711 @@
+/*
+ * ConflictBTree.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2022 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBSERVER_CONFLICTBTREE_H
+#define FDBSERVER_CONFLICTBTREE_H
+#pragma once
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CONFLICT_BTREE_SIMD 1
+#endif
+
+#include "fdbclient/FDBTypes.h"
+#include "flow/FastAlloc.h"
+
+// A B+tree holding the resolver's write history as a step function: each entry (key, version) records that the most
+// recent write to any key in [key, next entry's key) happened at version. The empty key is always present, so every key
+// has a version.
+//
+// Keys in a node usually share a long common prefix, so each node keeps the 4 bytes of every key that follow it in a
+// separate array as order-preserving integers. A search compares the target against four of them per SIMD instruction
+// and only compares whole keys among the few entries whose 4 bytes equal the target's.
+// Internal nodes also keep the newest version in each child so read checks skip old subtrees without visiting them.
+class ConflictBTree : NonCopyable {
+public:
+	explicit ConflictBTree(Version version = 0) : root(new Leaf) { insertEntry(root, 0, copyKey(StringRef()), version); }
+	~ConflictBTree() { destroy(root); }
+
+	void swap(ConflictBTree& other) { std::swap(root, other.root); }
+
+	// Returns true if any key in [begin, end) was written at a version newer than version
+	bool anyNewerThan(StringRef begin, StringRef end, Version version) const {
+		return anyNewer(root, begin, end, version);
+	}
+
+	// Calls onConflict(r) for each range r in [ranges, ranges + count) with a write newer than r.version. The ranges
+	// must be sorted by begin; each search starts from the deepest node of the previous search path that still covers
+	// the range, so neighbouring lookups share their upper levels.
+	template <class Range, class Fn>
+	void detectConflicts(const Range* ranges, int count, Fn onConflict) const {
+		PathEntry path[MaxHeight];
+		int depth = 0;
+		path[0] = PathEntry{ root, StringRef(), StringRef(), false };
+		for (int r = 0; r < count; r++) {
+			const StringRef begin = ranges[r].begin;
+			const StringRef end = ranges[r].end;
+			while (depth > 0 && !path[depth].covers(begin, end))
+				depth--;
+			const Node* n = path[depth].node;
+			while (!n->isLeaf) {
+				int i = std::max(countLess(n, begin, true) - 1, 0);
+				PathEntry child{ static_cast<const Internal*>(n)->child[i],
+					             n->key[i],
+					             i + 1 < n->count ? n->key[i + 1] : path[depth].upper,
+					             i + 1 < n->count || path[depth].bounded };
+				if (!child.covers(begin, end))
+					break;
+				ASSERT(depth + 1 < MaxHeight);
+				path[++depth] = child;
+				n = child.node;
+			}
+			if (anyNewer(n, begin, end, ranges[r].version))
+				onConflict(ranges[r]);
+		}
+	}
+
+	// Records a write to [begin, end) at version
+	void addConflictRange(StringRef begin, StringRef end, Version version) {
+		if (!(begin < end) || addWithinLeaf(begin, end, version))
+			return;
+		bool endPresent;
+		Version endVersion = find(end, endPresent);
+		erase(root, begin, end);
+		shrinkRoot();
+		insert(begin, version);
+		if (!endPresent)
+			insert(end, endVersion);
+	}
+
+	// Visits at most maxEntries entries starting at from, removing those which, like the entry before them, are older
+	// than oldestVersion. Returns the key to continue from next time, which is empty once the end has been reached.
+	Key removeBefore(Version oldestVersion, StringRef from, int maxEntries) {
+		RemoveState state{ oldestVersion, maxEntries, false, Key() };
+		removeBefore(root, from, state);
+		shrinkRoot();
+		return state.next;
+	}
+
+	int count() const { return count(root); }
+
+	// Splits the history into separate trees for the key ranges delimited by the sorted keys splits[0 .. splitCount),
+	// which must all be greater than the empty key, stored in output[0 .. splitCount]. This tree is left empty until a
+	// call to concatenate() recombines the partitions. In between, writes to each partition must stay within its range
+	// and must not end at the next partition's first key, which would duplicate it.
+	void partition(const StringRef* splits, int splitCount, ConflictBTree* output) {
+		for (int i = splitCount - 1; i >= 0; i--) {
+			// Each partition starts with an entry at its first key, so that every key in it has a version
+			bool present;
+			Version version = find(splits[i], present);
+			if (!present)
+				insert(splits[i], version);
+			output[i + 1].replaceRoot(splitAt(root, splits[i]));
+			shrinkRoot();
+		}
+		output[0].replaceRoot(root);
+		root = new Leaf;
+	}
+
+	// Recombines the partitions input[0 .. count) made by partition() into this tree, leaving them empty
+	void concatenate(ConflictBTree* input, int count) {
+		Node* joined = nullptr;
+		for (int i = 0; i < count; i++) {
+			Node* part = input[i].root;
+			input[i].root = new Leaf;
+			if (part->count == 0) {
+				deleteNode(part);
+				continue;
+			}
+			joined = joined ? join(joined, part) : part;
+		}
+		replaceRoot(joined ? joined : new Leaf);
+	}
+
+private:
+	static constexpr int Capacity = 28; // a multiple of 4, and small enough for an internal node to fit in 1024 bytes
+	static constexpr int MergeLimit = Capacity * 3 / 4;
+	static constexpr int MaxHeight = 16;
+	static constexpr int32_t PaddingPrefix = 0x7fffffff;
+
+	struct Node {
+		int count = 0;
+		int prefixLength = 0; // the length of the prefix shared by all of the keys
+		bool isLeaf;
+		int32_t prefix[Capacity]; // keyPrefix(key[i], prefixLength), and PaddingPrefix past count
+		Version version[Capacity]; // leaves: the version of [key[i], key[i+1]); internal: newest version in child[i]
+		StringRef key[Capacity]; // leaves: owned keys; internal: the first key of child[i], owned by a leaf below
+
+		explicit Node(bool isLeaf) : isLeaf(isLeaf) { std::fill(prefix, prefix + Capacity, PaddingPrefix); }
+	};
+	struct Leaf : Node, FastAllocated<Leaf> {
+		Leaf() : Node(true) {}
+	};
+	struct Internal : Node, FastAllocated<Internal> {
+		Node* child[Capacity];
+		Internal() : Node(false) {}
+	};
+	static_assert(sizeof(Internal) <= 1024, "Internal nodes should fit in a 1024 byte fast allocator block");
+
+	struct PathEntry {
+		const Node* node;
+		StringRef lower, upper; // every key in node's subtree is >= lower and, if bounded, < upper
+		bool bounded;
+
+		bool covers(StringRef begin, StringRef end) const {
+			return lower <= begin && (!bounded || (begin < upper && end <= upper));
+		}
+	};
+
+	struct RemoveState {
+		Version oldestVersion;
+		int budget;
+		bool previousOld; // whether the last visited entry was older than oldestVersion
+		Key next;
+	};
+
+	Node* root;
+
+	// Maps the 4 bytes of key starting at offset (zero padded) to an int32_t which, under signed comparison, is ordered
+	// like the keys are among keys sharing their first offset bytes
+	static int32_t keyPrefix(StringRef key, int offset) {
+		uint32_t p = 0;
+		for (int i = offset; i < offset + 4; i++)
+			p = (p << 8) | (i < key.size() ? key[i] : 0);
+		return (int32_t)(p ^ 0x80000000);
+	}
+
+	static int commonPrefixLength(StringRef a, StringRef b) {
+		const int length = std::min(a.size(), b.size());
+		int i = 0;
+		while (i < length && a[i] == b[i])
+			i++;
+		return i;
+	}
+
+	// Recomputes the shared prefix of n's keys after they have changed, along with the prefixes which depend on it.
+	// force is needed when entries with prefixes computed for another node were moved in.
+	static void updatePrefixes(Node* n, bool force = false) {
+		const int length = n->count ? commonPrefixLength(n->key[0], n->key[n->count - 1]) : 0;
+		if (length == n->prefixLength && !force)
+			return;
+		n->prefixLength = length;
+		for (int i = 0; i < n->count; i++)
+			n->prefix[i] = keyPrefix(n->key[i], length);
+	}
+
+#ifdef CONFLICT_BTREE_SIMD
+	static int horizontalSum(__m128i v) {
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(v);
+	}
+#endif
+
+	// Returns the number of keys in n less than key, or if orEqual, less than or equal to key
+	static int countLess(const Node* n, StringRef key, bool orEqual) {
+		if (n->prefixLength) {
+			const int length = std::min(key.size(), n->prefixLength);
+			const int c = length ? memcmp(key.begin(), n->key[0].begin(), length) : 0;
+			if (c != 0 || key.size() < n->prefixLength)
+				return c > 0 ? n->count : 0;
+		}
+		const int32_t p = keyPrefix(key, n->prefixLength);
+		int less, greater;
+#ifdef CONFLICT_BTREE_SIMD
+		const __m128i target = _mm_set1_epi32(p);
+		__m128i lessCount = _mm_setzero_si128(), greaterCount = _mm_setzero_si128();
+		for (int i = 0; i < Capacity; i += 4) {
+			__m128i prefixes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&n->prefix[i]));
+			// Each comparison yields -1 in the lanes where it holds, so subtracting it counts them
+			lessCount = _mm_sub_epi32(lessCount, _mm_cmpgt_epi32(target, prefixes));
+			greaterCount = _mm_sub_epi32(greaterCount, _mm_cmpgt_epi32(prefixes, target));
+		}
+		less = horizontalSum(lessCount);
+		greater = horizontalSum(greaterCount);
+#else
+		less = greater = 0;
+		for (int i = 0; i < Capacity; i++) {
+			less += n->prefix[i] < p;
+			greater += n->prefix[i] > p;
+		}
+#endif
+		// Padding slots are never less than the target, but may be counted as greater
+		const int samePrefixEnd = std::min(Capacity - greater, n->count);
+		int i = less;
+		while (i < samePrefixEnd && (orEqual ? n->key[i] <= key : n->key[i] < key))
+			i++;
+		return i;
+	}
+
+	static StringRef copyKey(StringRef key) {
+		if (key.size() == 0)
+			return StringRef();
+		uint8_t* data = (uint8_t*)allocateFast(key.size());
+		memcpy(data, key.begin(), key.size());
+		return StringRef(data, key.size());
+	}
+	static void freeKey(StringRef key) {
+		if (key.size())
+			freeFast(key.size(), (void*)key.begin());
+	}
+
+	static Version newestVersion(const Node* n) { return *std::max_element(n->version, n->version + n->count); }
+
+	static void setEntry(Node* n, int i, StringRef key, Version version) {
+		n->key[i] = key;
+		n->prefix[i] = keyPrefix(key, n->prefixLength);
+		n->version[i] = version;
+	}
+
+	// Copies count entries (and children) of from starting at fromIndex over those of to starting at toIndex
+	static void moveEntries(Node* to, int toIndex, const Node* from, int fromIndex, int count) {
+		memmove(&to->prefix[toIndex], &from->prefix[fromIndex], count * sizeof(int32_t));
+		memmove(&to->version[toIndex], &from->version[fromIndex], count * sizeof(Version));
+		memmove(&to->key[toIndex], &from->key[fromIndex], count * sizeof(StringRef));
+		if (!to->isLeaf)
+			memmove(&static_cast<Internal*>(to)->child[toIndex],
+			        &static_cast<const Internal*>(from)->child[fromIndex],
+			        count * sizeof(Node*));
+	}
+
+	static void setCount(Node* n, int count) {
+		if (count < n->count)
+			std::fill(n->prefix + count, n->prefix + n->count, PaddingPrefix);
+		n->count = count;
+	}
+
+	// Makes room at index i of n, which must not be full
+	static void openGap(Node* n, int i) {
+		ASSERT(n->count < Capacity);
+		moveEntries(n, i + 1, n, i, n->count - i);
+		n->count++;
+	}
+
+	static void insertEntry(Node* n, int i, StringRef key, Version version) {
+		openGap(n, i);
+		setEntry(n, i, key, version);
+		updatePrefixes(n);
+	}
+
+	static void insertChild(Internal* n, int i, Node* child) {
+		openGap(n, i);
+		n->child[i] = child;
+		refreshChild(n, i);
+	}
+
+	// Updates the separator and newest version kept for child i of n after the child has changed
+	static void refreshChild(Internal* n, int i, bool update = true) {
+		setEntry(n, i, n->child[i]->key[0], newestVersion(n->child[i]));
+		if (update)
+			updatePrefixes(n);
+	}
+
+	// Moves the upper half of the full node n into a new right sibling, which is returned
+	static Node* split(Node* n) {
+		Node* right = n->isLeaf ? static_cast<Node*>(new Leaf) : static_cast<Node*>(new Internal);
+		const int keep = Capacity / 2;
+		moveEntries(right, 0, n, keep, Capacity - keep);
+		right->count = Capacity - keep;
+		setCount(n, keep);
+		updatePrefixes(n);
+		updatePrefixes(right, true);
+		return right;
+	}
+
+	static void deleteNode(Node* n) {
+		if (n->isLeaf)
+			delete static_cast<Leaf*>(n);
+		else
+			delete static_cast<Internal*>(n);
+	}
+
+	static void destroy(Node* n) {
+		if (n->isLeaf) {
+			for (int i = 0; i < n->count; i++)
+				freeKey(n->key[i]);
+		} else {
+			for (int i = 0; i < n->count; i++)
+				destroy(static_cast<Internal*>(n)->child[i]);
+		}
+		deleteNode(n);
+	}
+
+	static int count(const Node* n) {
+		if (n->isLeaf)
+			return n->count;
+		int total = 0;
+		for (int i = 0; i < n->count; i++)
+			total += count(static_cast<const Internal*>(n)->child[i]);
+		return total;
+	}
+
+	// Returns the version of key, and whether key is itself an entry
+	Version find(StringRef key, bool& present) const {
+		const Node* n = root;
+		while (!n->isLeaf)
+			n = static_cast<const Internal*>(n)->child[std::max(countLess(n, key, true) - 1, 0)];
+		int i = countLess(n, key, true) - 1;
+		ASSERT(i >= 0);
+		present = n->key[i] == key;
+		return n->version[i];
+	}
+
+	// Checks the entries of the subtree n overlapping [begin, end). n must contain the last entry at or before begin.
+	static bool anyNewer(const Node* n, StringRef begin, StringRef end, Version version) {
+		const int first = std::max(countLess(n, begin, true) - 1, 0);
+		for (int i = first; i < n->count && (i == first || n->key[i] < end); i++) {
+			if (n->version[i] > version &&
+			    (n->isLeaf || anyNewer(static_cast<const Internal*>(n)->child[i],
+			                           i == first ? begin : n->key[i],
+			                           end,
+			                           version)))
+				return true;
+		}
+		return false;
+	}
+
+	// Handles the common case of a write that only changes the leaf holding begin, with a single descent and no splits.
+	// Returns false without changing anything if the general path is needed.
+	bool addWithinLeaf(StringRef begin, StringRef end, Version version) {
+		Internal* parents[MaxHeight];
+		int childIndex[MaxHeight];
+		int depth = 0;
+		StringRef upper;
+		bool bounded = false;
+		Node* n = root;
+		while (!n->isLeaf) {
+			Internal* in = static_cast<Internal*>(n);
+			int i = std::max(countLess(n, begin, true) - 1, 0);
+			if (i + 1 < n->count) {
+				upper = n->key[i + 1];
+				bounded = true;
+			}
+			ASSERT(depth < MaxHeight);
+			parents[depth] = in;
+			childIndex[depth++] = i;
+			n = in->child[i];
+		}
+		if (bounded && upper < end)
+			return false;
+
+		const int lo = countLess(n, begin, false), hi = countLess(n, end, false);
+		const bool endPresent = hi < n->count ? n->key[hi] == end : bounded && upper == end;
+		const bool reuseBegin = lo < hi && n->key[lo] == begin;
+		const int inserted = 1 + !endPresent;
+		if (n->count - (hi - lo) + inserted > Capacity)
+			return false;
+
+		const Version endVersion = n->version[hi - 1];
+		const StringRef beginKey = reuseBegin ? n->key[lo] : copyKey(begin);
+		for (int i = lo + reuseBegin; i < hi; i++)
+			freeKey(n->key[i]);
+		const int oldCount = n->count;
+		moveEntries(n, lo + inserted, n, hi, oldCount - hi);
+		n->count = oldCount - (hi - lo) + inserted;
+		if (n->count < oldCount)
+			std::fill(n->prefix + n->count, n->prefix + oldCount, PaddingPrefix);
+		setEntry(n, lo, beginKey, version);
+		if (!endPresent)
+			setEntry(n, lo + 1, copyKey(end), endVersion);
+		updatePrefixes(n);
+
+		// The leaf's first key is unchanged, since it is at or before begin, and version is the newest anywhere
+		while (depth > 0) {
+			depth--;
+			Version& newest = parents[depth]->version[childIndex[depth]];
+			newest = std::max(newest, version);
+		}
+		return true;
+	}
+
+	void insert(StringRef key, Version version) {
+		Node* right = insert(root, key, version);
+		if (right)
+			root = newRoot(root, right);
+	}
+
+	static Node* newRoot(Node* left, Node* right) {
+		Internal* n = new Internal;
+		n->child[0] = left;
+		n->child[1] = right;
+		n->count = 2;
+		refreshChild(n, 0, false);
+		refreshChild(n, 1);
+		return n;
+	}
+
+	// Inserts child at index i of n, splitting n if it is full. Returns n's new right sibling if n was split.
+	static Node* insertChildOrSplit(Internal* n, int i, Node* child) {
+		Internal* target = n;
+		Internal* right = nullptr;
+		if (n->count == Capacity) {
+			right = static_cast<Internal*>(split(n));
+			if (i > n->count) {
+				target = right;
+				i -= n->count;
+			}
+		}
+		insertChild(target, i, child);
+		return right;
+	}
+
+	// Inserts key, which must not already be present, into the subtree n. Returns n's new right sibling if n was split.
+	static Node* insert(Node* n, StringRef key, Version version) {
+		int i = countLess(n, key, true);
+		if (!n->isLeaf) {
+			Internal* in = static_cast<Internal*>(n);
+			int c = std::max(i - 1, 0);
+			Node* inserted = insert(in->child[c], key, version);
+			refreshChild(in, c);
+			return inserted ? insertChildOrSplit(in, c + 1, inserted) : nullptr;
+		}
+		Node* target = n;
+		Node* right = nullptr;
+		if (n->count == Capacity) {
+			right = split(n);
+			if (i > n->count) {
+				target = right;
+				i -= n->count;
+			}
+		}
+		insertEntry(target, i, copyKey(key), version);
+		return right;
+	}
+
+	static int height(const Node* n) {
+		int h = 0;
+		for (; !n->isLeaf; h++)
+			n = static_cast<const Internal*>(n)->child[0];
+		return h;
+	}
+
+	// Moves the entries of subtree n at or after key into a new subtree of the same height, which is returned. key must
+	// be an entry of n other than its first.
+	static Node* splitAt(Node* n, StringRef key) {
+		Node* right;
+		if (n->isLeaf) {
+			right = new Leaf;
+			const int i = countLess(n, key, false);
+			moveEntries(right, 0, n, i, n->count - i);
+			right->count = n->count - i;
+			setCount(n, i);
+		} else {
+			Internal* in = static_cast<Internal*>(n);
+			Internal* r = new Internal;
+			const int i = countLess(n, key, true) - 1;
+			if (n->key[i] == key) {
+				moveEntries(r, 0, n, i, n->count - i);
+				r->count = n->count - i;
+				setCount(n, i);
+			} else {
+				r->child[0] = splitAt(in->child[i], key);
+				moveEntries(r, 1, n, i + 1, n->count - i - 1);
+				r->count = n->count - i;
+				refreshChild(r, 0, false);
+				setCount(n, i + 1);
+				refreshChild(in, i, false);
+			}
+			right = r;
+		}
+		updatePrefixes(n);
+		updatePrefixes(right, true);
+		return right;
+	}
+
+	// Adds the subtree r, of height rHeight, after the last entry of subtree n. Returns n's new right sibling if n (or
+	// r itself, when they are the same height and do not fit in one node) has to be placed after n.
+	static Node* appendRight(Node* n, int nHeight, Node* r, int rHeight) {
+		if (nHeight == rHeight) {
+			if (n->count + r->count > Capacity)
+				return r;
+			moveEntries(n, n->count, r, 0, r->count);
+			n->count += r->count;
+			deleteNode(r);
+			updatePrefixes(n, true);
+			return nullptr;
+		}
+		Internal* in = static_cast<Internal*>(n);
+		const int last = n->count - 1;
+		Node* sibling = appendRight(in->child[last], nHeight - 1, r, rHeight);
+		refreshChild(in, last);
+		return sibling ? insertChildOrSplit(in, n->count, sibling) : nullptr;
+	}
+
+	// Adds the subtree l, of height lHeight, before the first entry of subtree n. Returns n's new left sibling if one
+	// is needed.
+	static Node* prependLeft(Node* n, int nHeight, Node* l, int lHeight) {
+		if (nHeight == lHeight) {
+			if (n->count + l->count > Capacity)
+				return l;
+			moveEntries(n, l->count, n, 0, n->count);
+			moveEntries(n, 0, l, 0, l->count);
+			n->count += l->count;
+			deleteNode(l);
+			updatePrefixes(n, true);
+			return nullptr;
+		}
+		Internal* in = static_cast<Internal*>(n);
+		Node* sibling = prependLeft(in->child[0], nHeight - 1, l, lHeight);
+		refreshChild(in, 0);
+		if (!sibling)
+			return nullptr;
+		if (n->count < Capacity) {
+			insertChild(in, 0, sibling);
+			return nullptr;
+		}
+		// n is full, so its lower half moves to a new left sibling along with the new child
+		Internal* left = new Internal;
+		const int moved = Capacity / 2;
+		moveEntries(left, 0, n, 0, moved);
+		left->count = moved;
+		moveEntries(n, 0, n, moved, Capacity - moved);
+		setCount(n, Capacity - moved);
+		updatePrefixes(n, true);
+		updatePrefixes(left, true);
+		insertChild(left, 0, sibling);
+		return left;
+	}
+
+	// Joins two subtrees, all of whose keys in a are less than those in b, returning the new root
+	static Node* join(Node* a, Node* b) {
+		const int aHeight = height(a), bHeight = height(b);
+		if (aHeight >= bHeight) {
+			Node* sibling = appendRight(a, aHeight, b, bHeight);
+			return sibling ? newRoot(a, sibling) : a;
+		}
+		Node* sibling = prependLeft(b, bHeight, a, aHeight);
+		return sibling ? newRoot(sibling, b) : b;
+	}
+
+	// Drops the children of n in [begin, end) which have become empty, refreshes the others and merges neighbours in
+	// that region which would fit comfortably in one node
+	static void repairChildren(Internal* n, int begin, int end, const bool* destroyed) {
+		int out = begin;
+		for (int i = begin; i < end; i++) {
+			if (destroyed[i - begin] || n->child[i]->count == 0) {
+				if (!destroyed[i - begin])
+					deleteNode(n->child[i]);
+				continue;
+			}
+			n->child[out] = n->child[i];
+			// The separators of destroyed children are dangling until they are compacted away
+			refreshChild(n, out, false);
+			out++;
+		}
+		moveEntries(n, out, n, end, n->count - end);
+		setCount(n, n->count - (end - out));
+
+		for (int i = std::max(begin - 1, 0); i < std::min(out + 1, n->count - 1);) {
+			Node* left = n->child[i];
+			Node* right = n->child[i + 1];
+			if (left->count + right->count > MergeLimit) {
+				i++;
+				continue;
+			}
+			moveEntries(left, left->count, right, 0, right->count);
+			left->count += right->count;
+			updatePrefixes(left, true);
+			right->count = 0;
+			deleteNode(right);
+			moveEntries(n, i + 1, n, i + 2, n->count - i - 2);
+			setCount(n, n->count - 1);
+			refreshChild(n, i, false);
+			out--;
+		}
+		updatePrefixes(n);
+	}
+
+	// Removes the entries of subtree n with keys in [begin, end)
+	static void erase(Node* n, StringRef begin, StringRef end) {
+		if (n->isLeaf) {
+			const int lo = countLess(n, begin, false), hi = countLess(n, end, false);
+			for (int i = lo; i < hi; i++)
+				freeKey(n->key[i]);
+			moveEntries(n, lo, n, hi, n->count - hi);
+			setCount(n, n->count - (hi - lo));
+			updatePrefixes(n);
+			return;
+		}
+		Internal* in = static_cast<Internal*>(n);
+		const int lo = std::max(countLess(n, begin, true) - 1, 0), hi = countLess(n, end, false);
+		bool destroyed[Capacity] = {};
+		for (int i = lo; i < hi; i++) {
+			// Separators are compared before the children owning their keys are changed
+			if (begin <= n->key[i] && i + 1 < n->count && n->key[i + 1] <= end) {
+				destroy(in->child[i]);
+				destroyed[i - lo] = true;
+			} else {
+				erase(in->child[i], begin, end);
+			}
+		}
+		repairChildren(in, lo, hi, destroyed);
+	}
+
+	static void removeBefore(Node* n, StringRef from, RemoveState& state) {
+		int i = countLess(n, from, !n->isLeaf);
+		if (n->isLeaf) {
+			int out = i;
+			for (; i < n->count && state.budget > 0; i++) {
+				state.budget--;
+				bool old = n->version[i] < state.oldestVersion;
+				if (old && state.previousOld) {
+					freeKey(n->key[i]);
+				} else {
+					if (out != i)
+						moveEntries(n, out, n, i, 1);
+					out++;
+				}
+				state.previousOld = old;
+			}
+			if (i < n->count && state.next.empty())
+				state.next = n->key[i];
+			moveEntries(n, out, n, i, n->count - i);
+			setCount(n, n->count - (i - out));
+			updatePrefixes(n);
+			return;
+		}
+		Internal* in = static_cast<Internal*>(n);
+		const int lo = std::max(i - 1, 0);
+		int hi = lo;
+		for (; hi < n->count && state.next.empty(); hi++)
+			removeBefore(in->child[hi], from, state);
+		bool destroyed[Capacity] = {};
+		repairChildren(in, lo, hi, destroyed);
+	}
+
+	void replaceRoot(Node* n) {
+		destroy(root);
+		root = n;
+		shrinkRoot();
+	}
+
+	// Replaces an internal root with fewer than two children by its only child (or an empty leaf)
+	void shrinkRoot() {
+		while (!root->isLeaf && root->count < 2) {
+			Internal* old = static_cast<Internal*>(root);
+			root = old->count ? old->child[0] : new Leaf;
+			deleteNode(old);
+		}
+	}
+};
+
+#endif
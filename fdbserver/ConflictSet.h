@@ -66,7 +66,9 @@ private:
 	void checkIntraBatchConflicts();
 	void combineWriteConflictRanges();
 	void checkReadConflictRanges();
+	void checkReadConflictRangesInParallel();
 	void mergeWriteConflictRanges(Version now);
+	void mergeWriteConflictRangesInParallel(Version now);
 	void addConflictRanges(Version now,
 	                       std::vector<std::pair<StringRef, StringRef>>::iterator begin,
 	                       std::vector<std::pair<StringRef, StringRef>>::iterator end,
@@ -37,6 +37,7 @@ struct GrvProxyStats {
 	Counter txnBatchPriorityStartIn, txnBatchPriorityStartOut;
 	Counter txnDefaultPriorityStartIn, txnDefaultPriorityStartOut;
 	Counter txnThrottled;
+	Counter txnRequestsExpired; // Requests whose client had given up on them by the time they were dequeued
 	Counter updatesFromRatekeeper, leaseTimeouts;
 	int systemGRVQueueSize, defaultGRVQueueSize, batchGRVQueueSize;
 	double transactionRateAllowed, batchTransactionRateAllowed;
@@ -94,6 +95,7 @@ struct GrvProxyStats {
 	    txnBatchPriorityStartOut("TxnBatchPriorityStartOut", cc),
 	    txnDefaultPriorityStartIn("TxnDefaultPriorityStartIn", cc),
 	    txnDefaultPriorityStartOut("TxnDefaultPriorityStartOut", cc), txnThrottled("TxnThrottled", cc),
+	    txnRequestsExpired("TxnRequestsExpired", cc),
 	    updatesFromRatekeeper("UpdatesFromRatekeeper", cc), leaseTimeouts("LeaseTimeouts", cc), systemGRVQueueSize(0),
 	    defaultGRVQueueSize(0), batchGRVQueueSize(0), transactionRateAllowed(0), batchTransactionRateAllowed(0),
 	    transactionLimit(0), batchTransactionLimit(0), percentageOfDefaultGRVQueueProcessed(0),
@@ -810,6 +812,21 @@ ACTOR static Future<Void> transactionStarter(GrvProxyInterface proxy,
 			auto& req = transactionQueue->front();
 			int tc = req.transactionCount;
 
+			if (req.expired()) {
+				// Every transaction in the batch has timed out on the client, so a read version would go unused
+				if (req.priority >= TransactionPriority::IMMEDIATE) {
+					--grvProxyData->stats.systemGRVQueueSize;
+				} else if (req.priority >= TransactionPriority::DEFAULT) {
+					--grvProxyData->stats.defaultGRVQueueSize;
+				} else {
+					--grvProxyData->stats.batchGRVQueueSize;
+				}
+				++grvProxyData->stats.txnRequestsExpired;
+				req.reply.sendError(transaction_timed_out());
+				transactionQueue->pop_front();
+				continue;
+			}
+
 			if (req.priority < TransactionPriority::DEFAULT &&
 			    !batchRateInfo.canStart(transactionsStarted[0] + transactionsStarted[1], tc)) {
 				break;
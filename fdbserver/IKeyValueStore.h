@@ -24,6 +24,7 @@
 
 #include "fdbclient/FDBTypes.h"
 #include "fdbserver/Knobs.h"
+#include "flow/genericactors.actor.h"
 
 class IClosable {
 public:
@@ -49,6 +50,22 @@ public:
 	virtual Future<Void> commit(
 	    bool sequential = false) = 0; // returns when prior sets and clears are (atomically) durable
 
+	// Writes sorted key value pairs into a range that holds no data, like a set() of each. Engines that can load them
+	// more cheaply than through their write path, for example by building a table file and adding it to the store,
+	// may make them durable without waiting for the next commit. So the range must not have uncommitted sets or
+	// clears, and the caller must be able to tolerate the pairs surviving a restart before the next commit. Sets and
+	// clears made after calling ingest() take effect after it.
+	virtual Future<Void> ingest(Standalone<VectorRef<KeyValueRef>> data) {
+		for (auto const& kv : data) {
+			set(kv);
+		}
+		return Void();
+	}
+
+	// True if ingest() loads a block more cheaply than a set() of each pair. Callers that yield between set()s should
+	// only hand whole blocks to ingest() when this is true.
+	virtual bool canIngest() const { return false; }
+
 	enum class ReadType {
 		EAGER,
 		FETCH,
@@ -67,6 +84,20 @@ public:
 	                                                ReadType type = ReadType::NORMAL,
 	                                                Optional<UID> debugID = Optional<UID>()) = 0;
 
+	// Reads several keys in one request, like a readValuePrefix() of each key with the maxLength paired with it, and
+	// returns the values in the same order. The keys must be sorted and unique. Engines that can look up a batch of
+	// keys more cheaply than one key at a time override this.
+	virtual Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys,
+	                                                               ReadType type = ReadType::NORMAL,
+	                                                               Optional<UID> debugID = Optional<UID>()) {
+		std::vector<Future<Optional<Value>>> values;
+		values.reserve(keys.size());
+		for (auto const& [key, maxLength] : keys) {
+			values.push_back(readValuePrefix(key, maxLength, type, debugID));
+		}
+		return getAll(values);
+	}
+
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
 	virtual Future<RangeResult> readRange(KeyRangeRef keys,
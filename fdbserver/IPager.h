@@ -176,6 +176,13 @@ public:
 	                                                                int priority,
 	                                                                bool cacheable,
 	                                                                bool nohit) = 0;
+	// Returns the decoded form of page, such as a compressed page uncompressed, where page was read from this
+	// snapshot as pageID (the first ID of a multi-page).  decode() makes it unless the pager already holds it for the
+	// same page.  The pager may keep it with its cached copy of page, charging the cache for it.
+	virtual Reference<const ArenaPage> getDecodedPage(LogicalPageID pageID,
+	                                                  Reference<const ArenaPage> const& page,
+	                                                  std::function<Reference<const ArenaPage>()> const& decode) = 0;
+
 	virtual Version getVersion() const = 0;
 
 	virtual Key getMetaKey() const = 0;
@@ -264,6 +271,7 @@ public:
 	virtual void pushExtentUsedList(QueueID queueID, LogicalPageID extID) = 0;
 	virtual void extentCacheClear() = 0;
 	virtual int64_t getPageCacheCount() = 0;
+	virtual void setPageCacheSize(int64_t bytes) = 0;
 	virtual int64_t getExtentCacheCount() = 0;
 
 	// Get a snapshot of the metakey and all pages as of the version v which must be >= getOldestVersion()
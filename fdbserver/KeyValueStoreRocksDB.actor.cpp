@@ -6,6 +6,7 @@
 #include <rocksdb/listener.h>
 #include <rocksdb/options.h>
 #include <rocksdb/slice_transform.h>
+#include <rocksdb/sst_file_writer.h>
 #include <rocksdb/statistics.h>
 #include <rocksdb/table.h>
 #include <rocksdb/version.h>
@@ -140,6 +141,81 @@ StringRef toStringRef(rocksdb::Slice s) {
 	return StringRef(reinterpret_cast<const uint8_t*>(s.data()), s.size());
 }
 
+// A prefix extractor for keys made of tuple-encoded elements.  The prefix of a key is its first `elements` complete
+// tuple elements, so unlike a fixed length prefix it follows the structure of keys whose leading elements vary in
+// encoded size.  Keys that do not begin with that many well formed elements, which includes all system keys, are
+// outside of the extractor's domain and are never excluded by prefix filters.
+class TuplePrefixTransform : public rocksdb::SliceTransform {
+public:
+	explicit TuplePrefixTransform(int elements) : elements(elements), name(format("fdb.TuplePrefix.%d", elements)) {}
+
+	// The name is persisted in SST properties; filters are only used for files written with the same extractor.
+	const char* Name() const override { return name.c_str(); }
+
+	rocksdb::Slice Transform(const rocksdb::Slice& key) const override {
+		return rocksdb::Slice(key.data(), prefixLength(key));
+	}
+
+	bool InDomain(const rocksdb::Slice& key) const override { return prefixLength(key) > 0; }
+
+	bool SameResultWhenAppended(const rocksdb::Slice& prefix) const override {
+		int len = prefixLength(prefix);
+		return len > 0 && (size_t)len == prefix.size();
+	}
+
+	// Returns the length of the first `elements` tuple elements of key, or 0 if key does not start with that many
+	// complete elements.
+	int prefixLength(const rocksdb::Slice& key) const {
+		const uint8_t* data = (const uint8_t*)key.data();
+		int size = key.size();
+		int i = 0;
+		for (int e = 0; e < elements; ++e) {
+			if (i >= size) {
+				return 0;
+			}
+			uint8_t code = data[i++];
+			if (code == 0x01 || code == 0x02) {
+				// Byte or unicode string, terminated by a 0x00 that is not followed by the 0xff null escape
+				while (true) {
+					if (i >= size) {
+						return 0;
+					}
+					if (data[i] == 0x00) {
+						if (i + 1 < size && data[i + 1] == 0xff) {
+							i += 2;
+							continue;
+						}
+						++i;
+						break;
+					}
+					++i;
+				}
+			} else if (code >= 0x0c && code <= 0x1c) {
+				// Integer with its byte length encoded in the type code
+				i += std::abs(code - 0x14);
+			} else if (code == 0x20) {
+				i += sizeof(float);
+			} else if (code == 0x21) {
+				i += sizeof(double);
+			} else if (code == 0x30) {
+				// UUID
+				i += 16;
+			} else if (code == 0x33) {
+				// Versionstamp
+				i += 12;
+			} else if (code != 0x00 && code != 0x26 && code != 0x27) {
+				// Not a type with a known encoded size
+				return 0;
+			}
+		}
+		return i <= size ? i : 0;
+	}
+
+private:
+	int elements;
+	std::string name;
+};
+
 rocksdb::ColumnFamilyOptions getCFOptions() {
 	rocksdb::ColumnFamilyOptions options;
 	options.level_compaction_dynamic_level_bytes = true;
@@ -152,9 +228,14 @@ rocksdb::ColumnFamilyOptions getCFOptions() {
 
 	rocksdb::BlockBasedTableOptions bbOpts;
 	// TODO: Add a knob for the block cache size. (Default is 8 MB)
-	if (SERVER_KNOBS->ROCKSDB_PREFIX_LEN > 0) {
+	if (SERVER_KNOBS->ROCKSDB_PREFIX_TUPLE_ELEMENTS > 0 || SERVER_KNOBS->ROCKSDB_PREFIX_LEN > 0) {
 		// Prefix blooms are used during Seek.
-		options.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(SERVER_KNOBS->ROCKSDB_PREFIX_LEN));
+		if (SERVER_KNOBS->ROCKSDB_PREFIX_TUPLE_ELEMENTS > 0) {
+			options.prefix_extractor =
+			    std::make_shared<TuplePrefixTransform>(SERVER_KNOBS->ROCKSDB_PREFIX_TUPLE_ELEMENTS);
+		} else {
+			options.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(SERVER_KNOBS->ROCKSDB_PREFIX_LEN));
+		}
 
 		// Also turn on bloom filters in the memtable.
 		// TODO: Make a knob for this as well.
@@ -166,16 +247,36 @@ rocksdb::ColumnFamilyOptions getCFOptions() {
 		// https://github.com/facebook/rocksdb/blob/b77569f18bfc77fb1d8a0b3218f6ecf571bc4988/include/rocksdb/table.h#L391
 		bbOpts.format_version = 5;
 
-		// Create and apply a bloom filter using the 10 bits
-		// which should yield a ~1% false positive rate:
+		// Create and apply a bloom filter, where the default of 10 bits per key
+		// should yield a ~1% false positive rate:
 		// https://github.com/facebook/rocksdb/wiki/RocksDB-Bloom-Filter#full-filters-new-format
-		bbOpts.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10));
+		// A ribbon filter reaches the same false positive rate in ~30% less space, for more CPU while building it.
+		// https://github.com/facebook/rocksdb/wiki/RocksDB-Bloom-Filter#ribbon-filter
+		if (SERVER_KNOBS->ROCKSDB_RIBBON_FILTER) {
+			bbOpts.filter_policy.reset(rocksdb::NewRibbonFilterPolicy(SERVER_KNOBS->ROCKSDB_FILTER_BITS_PER_KEY));
+		} else {
+			bbOpts.filter_policy.reset(rocksdb::NewBloomFilterPolicy(SERVER_KNOBS->ROCKSDB_FILTER_BITS_PER_KEY));
+		}
 
 		// The whole key blooms are only used for point lookups.
 		// https://github.com/facebook/rocksdb/wiki/RocksDB-Bloom-Filter#prefix-vs-whole-key
 		bbOpts.whole_key_filtering = false;
 	}
 
+	if (SERVER_KNOBS->ROCKSDB_PARTITIONED_INDEX_FILTERS) {
+		// Split index and filter blocks into small partitions which are loaded through the block cache as needed,
+		// so a large database does not need all of its index and filter blocks in memory.  The top level index of
+		// each file and the L0 index and filter blocks stay pinned in the cache since every read goes through them.
+		// https://github.com/facebook/rocksdb/wiki/Partitioned-Index-Filters
+		bbOpts.index_type = rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
+		bbOpts.partition_filters = bbOpts.filter_policy != nullptr;
+		bbOpts.metadata_block_size = 4096;
+		bbOpts.cache_index_and_filter_blocks = true;
+		bbOpts.cache_index_and_filter_blocks_with_high_priority = true;
+		bbOpts.pin_top_level_index_and_filter = true;
+		bbOpts.pin_l0_filter_and_index_blocks_in_cache = true;
+	}
+
 	if (SERVER_KNOBS->ROCKSDB_BLOCK_CACHE_SIZE > 0) {
 		bbOpts.block_cache = rocksdb::NewLRUCache(SERVER_KNOBS->ROCKSDB_BLOCK_CACHE_SIZE);
 	}
@@ -210,10 +311,28 @@ rocksdb::ReadOptions getReadOptions() {
 struct ReadIterator {
 	uint64_t index; // incrementing counter to uniquely identify read iterator.
 	bool inUse;
+	// The iterator's upper bound, which RocksDB reads through a pointer on each Seek so it can change between reads.
+	std::shared_ptr<std::string> upperBoundKey;
+	std::shared_ptr<rocksdb::Slice> upperBound;
 	std::shared_ptr<rocksdb::Iterator> iter;
 	double creationTime;
-	ReadIterator(uint64_t index, DB& db, rocksdb::ReadOptions& options)
-	  : index(index), inUse(true), creationTime(now()), iter(db->NewIterator(options)) {}
+	ReadIterator(uint64_t index, DB& db, rocksdb::ReadOptions options)
+	  : index(index), inUse(true), upperBoundKey(std::make_shared<std::string>()),
+	    upperBound(std::make_shared<rocksdb::Slice>()), iter(newIterator(db, options, upperBound.get())),
+	    creationTime(now()) {}
+
+	// Limits the iterator to keys less than end until the next call.  With a prefix extractor configured this also
+	// lets RocksDB use prefix filters to skip files for ranges that lie within a single prefix.
+	void setUpperBound(KeyRef end) {
+		upperBoundKey->assign((const char*)end.begin(), end.size());
+		*upperBound = rocksdb::Slice(*upperBoundKey);
+	}
+
+private:
+	static rocksdb::Iterator* newIterator(DB& db, rocksdb::ReadOptions& options, rocksdb::Slice* upperBound) {
+		options.iterate_upper_bound = upperBound;
+		return db->NewIterator(options);
+	}
 };
 
 /*
@@ -233,11 +352,13 @@ public:
 	ReadIteratorPool(DB& db, const std::string& path)
 	  : db(db), index(0), iteratorsReuseCount(0), readRangeOptions(getReadOptions()) {
 		readRangeOptions.background_purge_on_iterator_cleanup = true;
-		readRangeOptions.auto_prefix_mode = (SERVER_KNOBS->ROCKSDB_PREFIX_LEN > 0);
+		readRangeOptions.auto_prefix_mode =
+		    (SERVER_KNOBS->ROCKSDB_PREFIX_LEN > 0 || SERVER_KNOBS->ROCKSDB_PREFIX_TUPLE_ELEMENTS > 0);
 		TraceEvent("ReadIteratorPool")
 		    .detail("Path", path)
 		    .detail("KnobRocksDBReadRangeReuseIterators", SERVER_KNOBS->ROCKSDB_READ_RANGE_REUSE_ITERATORS)
-		    .detail("KnobRocksDBPrefixLen", SERVER_KNOBS->ROCKSDB_PREFIX_LEN);
+		    .detail("KnobRocksDBPrefixLen", SERVER_KNOBS->ROCKSDB_PREFIX_LEN)
+		    .detail("KnobRocksDBPrefixTupleElements", SERVER_KNOBS->ROCKSDB_PREFIX_TUPLE_ELEMENTS);
 	}
 
 	// Called on every db commit.
@@ -634,6 +755,44 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			}
 		}
 
+		struct IngestAction : TypedAction<Writer, IngestAction> {
+			std::string path;
+			Standalone<VectorRef<KeyValueRef>> data;
+			ThreadReturnPromise<Void> done;
+			IngestAction(std::string path, Standalone<VectorRef<KeyValueRef>> data)
+			  : path(std::move(path)), data(std::move(data)) {}
+			double getTimeEstimate() const override { return SERVER_KNOBS->COMMIT_TIME_ESTIMATE; }
+		};
+		void action(IngestAction& a) {
+			// Writing the pairs to a table file and adding it to the store skips the WAL and memtable, and since the
+			// range holds no data the file can usually go straight to the bottom level without being compacted.
+			// The file is moved into the store, so there is only ever one left behind if the process dies here.
+			std::string file = a.path + "/fdb-ingest.sst";
+			rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), getOptions());
+			auto s = writer.Open(file);
+			for (int i = 0; s.ok() && i < a.data.size(); i++) {
+				s = writer.Put(toSlice(a.data[i].key), toSlice(a.data[i].value));
+			}
+			if (s.ok()) {
+				s = writer.Finish();
+			}
+			if (s.ok()) {
+				if (rateLimiter) {
+					rateLimiter->Request(writer.FileSize(), rocksdb::Env::IO_HIGH);
+				}
+				rocksdb::IngestExternalFileOptions options;
+				options.move_files = true;
+				s = db->IngestExternalFile({ file }, options);
+			}
+			if (!s.ok()) {
+				logRocksDBError(s, "Ingest");
+				a.done.sendError(statusToError(s));
+				return;
+			}
+			readIterPool->update();
+			a.done.send(Void());
+		}
+
 		struct CloseAction : TypedAction<Writer, CloseAction> {
 			ThreadReturnPromise<Void> done;
 			std::string path;
@@ -873,6 +1032,80 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			}
 		}
 
+		struct ReadValuePrefixesAction : TypedAction<Reader, ReadValuePrefixesAction> {
+			Standalone<VectorRef<KeyRef>> keys;
+			std::vector<int> maxLengths;
+			Optional<UID> debugID;
+			double startTime;
+			ThreadReturnPromise<std::vector<Optional<Value>>> result;
+			ReadValuePrefixesAction(std::vector<std::pair<KeyRef, int>> const& batch,
+			                        int begin,
+			                        int end,
+			                        Optional<UID> debugID)
+			  : debugID(debugID), startTime(timer_monotonic()) {
+				keys.reserve(keys.arena(), end - begin);
+				maxLengths.reserve(end - begin);
+				for (int i = begin; i < end; i++) {
+					keys.push_back_deep(keys.arena(), batch[i].first);
+					maxLengths.push_back(batch[i].second);
+				}
+			}
+			double getTimeEstimate() const override { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE * keys.size(); }
+		};
+		void action(ReadValuePrefixesAction& a) {
+			double readBeginTime = timer_monotonic();
+			Optional<TraceBatch> traceBatch;
+			if (a.debugID.present()) {
+				traceBatch = { TraceBatch{} };
+				traceBatch.get().addEvent("GetValuePrefixesDebug", a.debugID.get().first(), "Reader.Before");
+			}
+			if (readBeginTime - a.startTime > readValuePrefixTimeout) {
+				TraceEvent(SevWarn, "RocksDBError")
+				    .detail("Error", "Read value prefixes request timedout")
+				    .detail("Method", "ReadValuePrefixesAction")
+				    .detail("Timeout value", readValuePrefixTimeout);
+				a.result.sendError(transaction_too_old());
+				return;
+			}
+
+			auto options = getReadOptions();
+			uint64_t deadlineMircos =
+			    db->GetEnv()->NowMicros() + (readValuePrefixTimeout - (readBeginTime - a.startTime)) * 1000000;
+			std::chrono::seconds deadlineSeconds(deadlineMircos / 1000000);
+			options.deadline = std::chrono::duration_cast<std::chrono::microseconds>(deadlineSeconds);
+
+			// The keys are sorted, which lets MultiGet skip sorting them before looking them up together
+			std::vector<rocksdb::Slice> keys;
+			keys.reserve(a.keys.size());
+			for (auto const& key : a.keys) {
+				keys.push_back(toSlice(key));
+			}
+			std::vector<rocksdb::PinnableSlice> values(keys.size());
+			std::vector<rocksdb::Status> statuses(keys.size());
+			db->MultiGet(
+			    options, db->DefaultColumnFamily(), keys.size(), keys.data(), values.data(), statuses.data(), true);
+
+			if (a.debugID.present()) {
+				traceBatch.get().addEvent("GetValuePrefixesDebug", a.debugID.get().first(), "Reader.After");
+				traceBatch.get().dump();
+			}
+			std::vector<Optional<Value>> result;
+			result.reserve(keys.size());
+			for (int i = 0; i < keys.size(); i++) {
+				if (statuses[i].ok()) {
+					result.push_back(Value(StringRef(reinterpret_cast<const uint8_t*>(values[i].data()),
+					                                 std::min(values[i].size(), size_t(a.maxLengths[i])))));
+				} else if (statuses[i].IsNotFound()) {
+					result.push_back(Optional<Value>());
+				} else {
+					logRocksDBError(statuses[i], "ReadValuePrefixes");
+					a.result.sendError(statusToError(statuses[i]));
+					return;
+				}
+			}
+			a.result.send(result);
+		}
+
 		struct ReadRangeAction : TypedAction<Reader, ReadRangeAction>, FastAllocated<ReadRangeAction> {
 			KeyRange keys;
 			int rowLimit, byteLimit;
@@ -912,6 +1145,7 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 				if (a.getHistograms) {
 					readRangeNewIteratorHistogram->sampleSeconds(timer_monotonic() - iterCreationBeginTime);
 				}
+				readIter.setUpperBound(a.keys.end);
 				auto cursor = readIter.iter;
 				cursor->Seek(toSlice(a.keys.begin));
 				while (cursor->Valid() && toStringRef(cursor->key()) < a.keys.end) {
@@ -940,6 +1174,7 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 				if (a.getHistograms) {
 					readRangeNewIteratorHistogram->sampleSeconds(timer_monotonic() - iterCreationBeginTime);
 				}
+				readIter.setUpperBound(a.keys.end);
 				auto cursor = readIter.iter;
 				cursor->SeekForPrev(toSlice(a.keys.end));
 				if (cursor->Valid() && toStringRef(cursor->key()) == a.keys.end) {
@@ -1100,6 +1335,18 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 		}
 	}
 
+	bool canIngest() const override { return true; }
+
+	Future<Void> ingest(Standalone<VectorRef<KeyValueRef>> data) override {
+		if (data.empty()) {
+			return Void();
+		}
+		auto a = new Writer::IngestAction(path, data);
+		auto res = a->done.getFuture();
+		writeThread->post(a);
+		return res;
+	}
+
 	Future<Void> commit(bool) override {
 		// If there is nothing to write, don't write.
 		if (writeBatch == nullptr) {
@@ -1178,6 +1425,31 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 		return read(a.release(), &semaphore, readThreads.getPtr(), &counters.failedToAcquire);
 	}
 
+	// Eager reads are looked up with MultiGet, split across the read threads. Other reads go through readValuePrefix()
+	// so that they are throttled the same way.
+	Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys,
+	                                                       IKeyValueStore::ReadType type,
+	                                                       Optional<UID> debugID) override {
+		if (type != IKeyValueStore::ReadType::EAGER) {
+			return IKeyValueStore::readValuePrefixes(keys, type, debugID);
+		}
+
+		std::vector<Future<std::vector<Optional<Value>>>> batches;
+		for (int begin = 0; begin < keys.size(); begin += SERVER_KNOBS->ROCKSDB_MULTIGET_KEYS) {
+			int end = std::min<int>(begin + SERVER_KNOBS->ROCKSDB_MULTIGET_KEYS, keys.size());
+			auto a = new Reader::ReadValuePrefixesAction(keys, begin, end, debugID);
+			batches.push_back(a->result.getFuture());
+			readThreads->post(a);
+		}
+		return map(getAll(batches), [](std::vector<std::vector<Optional<Value>>> const& results) {
+			std::vector<Optional<Value>> values;
+			for (auto const& result : results) {
+				values.insert(values.end(), result.begin(), result.end());
+			}
+			return values;
+		});
+	}
+
 	ACTOR static Future<Standalone<RangeResultRef>> read(Reader::ReadRangeAction* action,
 	                                                     FlowLock* semaphore,
 	                                                     IThreadPool* pool,
@@ -1248,10 +1520,37 @@ IKeyValueStore* keyValueStoreRocksDB(std::string const& path,
 }
 
 #ifdef SSD_ROCKSDB_EXPERIMENTAL
+#include "fdbclient/Tuple.h"
 #include "flow/UnitTest.h"
 
 namespace {
 
+TEST_CASE("noSim/fdbserver/KeyValueStoreRocksDB/TuplePrefixTransform") {
+	TuplePrefixTransform transform(2);
+	auto slice = [](const Tuple& t) { return toSlice(t.pack()); };
+
+	Tuple t1 = Tuple().append("idx"_sr).append(LiteralStringRef("a\x00b")).append(42).append("x"_sr);
+	Tuple t1Prefix = Tuple().append("idx"_sr).append(LiteralStringRef("a\x00b"));
+	ASSERT(transform.InDomain(slice(t1)));
+	ASSERT(toStringRef(transform.Transform(slice(t1))) == t1Prefix.pack());
+	ASSERT(toStringRef(transform.Transform(slice(t1Prefix))) == t1Prefix.pack());
+	ASSERT(transform.SameResultWhenAppended(slice(t1Prefix)));
+	ASSERT(!transform.SameResultWhenAppended(slice(t1)));
+
+	Tuple t2 = Tuple().append(-1000000).appendNull().appendDouble(1.5);
+	ASSERT(toStringRef(transform.Transform(slice(t2))) == Tuple().append(-1000000).appendNull().pack());
+
+	// Too few elements, an unterminated string, a truncated integer, and system keys are all outside the domain
+	ASSERT(!transform.InDomain(slice(Tuple().append("idx"_sr))));
+	ASSERT(!transform.InDomain(toSlice("\x01idx\x00\x01"
+	                                       "abc"_sr)));
+	ASSERT(!transform.InDomain(toSlice("\x01idx\x00\x16\x01"_sr)));
+	ASSERT(!transform.InDomain(toSlice("\xff/keyServers/a"_sr)));
+	ASSERT(!transform.InDomain(toSlice(""_sr)));
+
+	return Void();
+}
+
 TEST_CASE("noSim/fdbserver/KeyValueStoreRocksDB/RocksDBBasic") {
 	state const std::string rocksDBTestDir = "rocksdb-kvstore-basic-test-db";
 	platform::eraseDirectoryRecursive(rocksDBTestDir);
@@ -1308,6 +1607,58 @@ TEST_CASE("noSim/fdbserver/KeyValueStoreRocksDB/RocksDBBasic") {
 	return Void();
 }
 
+TEST_CASE("noSim/fdbserver/KeyValueStoreRocksDB/RocksDBIngest") {
+	state const std::string rocksDBTestDir = "rocksdb-kvstore-ingest-test-db";
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+
+	state IKeyValueStore* kvStore = new RocksDBKeyValueStore(rocksDBTestDir, deterministicRandom()->randomUniqueID());
+	wait(kvStore->init());
+	ASSERT(kvStore->canIngest());
+
+	kvStore->set({ "a"_sr, "a"_sr });
+	wait(kvStore->commit(false));
+
+	state Standalone<VectorRef<KeyValueRef>> block;
+	for (int i = 0; i < 100; i++) {
+		Key key = "b"_sr.withSuffix(format("%04d", i));
+		block.push_back_deep(block.arena(), KeyValueRef(key, key));
+	}
+	wait(kvStore->ingest(block));
+
+	{
+		RangeResult result = wait(kvStore->readRange(KeyRangeRef("b"_sr, "c"_sr)));
+		ASSERT(result.size() == block.size());
+		for (int i = 0; i < result.size(); i++) {
+			ASSERT(result[i] == block[i]);
+		}
+	}
+
+	// A clear issued after the ingest removes ingested keys, and sets issued after it are not hidden by it
+	kvStore->clear(KeyRangeRef(block[10].key, block[90].key));
+	kvStore->set({ block[50].key, "new"_sr });
+	wait(kvStore->commit(false));
+
+	{
+		RangeResult result = wait(kvStore->readRange(KeyRangeRef("b"_sr, "c"_sr)));
+		ASSERT(result.size() == 21);
+		ASSERT(result[9] == block[9]);
+		ASSERT(result[10] == KeyValueRef(block[50].key, "new"_sr));
+		ASSERT(result[11] == block[90]);
+	}
+
+	{
+		Optional<Value> val = wait(kvStore->readValue("a"_sr));
+		ASSERT(Optional<Value>("a"_sr) == val);
+	}
+
+	Future<Void> closed = kvStore->onClosed();
+	kvStore->close();
+	wait(closed);
+
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+	return Void();
+}
+
 TEST_CASE("noSim/fdbserver/KeyValueStoreRocksDB/RocksDBReopen") {
 	state const std::string rocksDBTestDir = "rocksdb-kvstore-reopen-test-db";
 	platform::eraseDirectoryRecursive(rocksDBTestDir);
@@ -1585,6 +1585,9 @@ public:
 	                                        int maxLength,
 	                                        IKeyValueStore::ReadType,
 	                                        Optional<UID> debugID) override;
+	Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys,
+	                                                       IKeyValueStore::ReadType,
+	                                                       Optional<UID> debugID) override;
 	Future<RangeResult> readRange(KeyRangeRef keys, int rowLimit, int byteLimit, IKeyValueStore::ReadType) override;
 
 	KeyValueStoreSQLite(std::string const& filename,
@@ -1698,6 +1701,45 @@ private:
 			// if (t >= 1.0) TraceEvent("ReadValuePrefixActionSlow",dbgid).detail("Elapsed", t);
 		}
 
+		// Reads the keys in [begin, end) of the batch on one reader thread, reusing its cursor, instead of queueing an
+		// action for each
+		struct ReadValuePrefixesAction final : TypedAction<Reader, ReadValuePrefixesAction>,
+		                                       FastAllocated<ReadValuePrefixesAction> {
+			Standalone<VectorRef<KeyRef>> keys;
+			std::vector<int> maxLengths;
+			Optional<UID> debugID;
+			ThreadReturnPromise<std::vector<Optional<Value>>> result;
+			ReadValuePrefixesAction(std::vector<std::pair<KeyRef, int>> const& batch,
+			                        int begin,
+			                        int end,
+			                        Optional<UID> debugID)
+			  : debugID(debugID) {
+				keys.reserve(keys.arena(), end - begin);
+				maxLengths.reserve(end - begin);
+				for (int i = begin; i < end; i++) {
+					keys.push_back_deep(keys.arena(), batch[i].first);
+					maxLengths.push_back(batch[i].second);
+				}
+			}
+			double getTimeEstimate() const override { return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE * keys.size(); }
+		};
+		void action(ReadValuePrefixesAction& rv) {
+			if (rv.debugID.present())
+				g_traceBatch.addEvent("GetValuePrefixesDebug", rv.debugID.get().first(), "Reader.Before");
+
+			auto cursor = getCursor();
+			std::vector<Optional<Value>> values;
+			values.reserve(rv.keys.size());
+			for (int i = 0; i < rv.keys.size(); i++) {
+				values.push_back(cursor->get().getPrefix(rv.keys[i], rv.maxLengths[i]));
+			}
+			rv.result.send(values);
+			++counter;
+
+			if (rv.debugID.present())
+				g_traceBatch.addEvent("GetValuePrefixesDebug", rv.debugID.get().first(), "Reader.After");
+		}
+
 		struct ReadRangeAction final : TypedAction<Reader, ReadRangeAction>, FastAllocated<ReadRangeAction> {
 			KeyRange keys;
 			int rowLimit, byteLimit;
@@ -2224,6 +2266,27 @@ Future<Optional<Value>> KeyValueStoreSQLite::readValuePrefix(KeyRef key,
 	readThreads->post(p);
 	return f;
 }
+Future<std::vector<Optional<Value>>> KeyValueStoreSQLite::readValuePrefixes(
+    std::vector<std::pair<KeyRef, int>> const& keys,
+    IKeyValueStore::ReadType,
+    Optional<UID> debugID) {
+	// Chunks of the batch are read concurrently by the reader threads
+	std::vector<Future<std::vector<Optional<Value>>>> chunks;
+	for (int begin = 0; begin < keys.size(); begin += SERVER_KNOBS->SQLITE_BATCH_READ_KEYS) {
+		int end = std::min<int>(begin + SERVER_KNOBS->SQLITE_BATCH_READ_KEYS, keys.size());
+		++readsRequested;
+		auto p = new Reader::ReadValuePrefixesAction(keys, begin, end, debugID);
+		chunks.push_back(p->result.getFuture());
+		readThreads->post(p);
+	}
+	return map(getAll(chunks), [](std::vector<std::vector<Optional<Value>>> const& results) {
+		std::vector<Optional<Value>> values;
+		for (auto const& result : results) {
+			values.insert(values.end(), result.begin(), result.end());
+		}
+		return values;
+	});
+}
 Future<RangeResult> KeyValueStoreSQLite::readRange(KeyRangeRef keys,
                                                    int rowLimit,
                                                    int byteLimit,
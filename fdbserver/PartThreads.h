@@ -0,0 +1,116 @@
+/*
+ * PartThreads.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2022 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBSERVER_PARTTHREADS_H
+#define FDBSERVER_PARTTHREADS_H
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "flow/Arena.h"
+#include "flow/Platform.h"
+#include "flow/ThreadPrimitives.h"
+
+// Runs the parts of a CPU bound piece of work on a fixed set of threads, one part per thread. The calling thread does
+// the first part itself, and run() returns once every part is done, so the work may use anything the caller owns.
+// Without threads (as in simulation) the parts simply run one after another.
+class PartThreads : NonCopyable {
+public:
+	PartThreads(int parts, bool useThreads, const char* threadName) : partCount(parts) {
+		if (!useThreads)
+			return;
+		for (int i = 1; i < parts; i++) {
+			workers.push_back(std::make_unique<Worker>());
+			workers.back()->pool = this;
+			workers.back()->part = i;
+			workers.back()->thread = startThread(&workerMain, workers.back().get(), 0, threadName);
+		}
+	}
+	~PartThreads() {
+		stopping = true;
+		for (auto& w : workers)
+			w->start.set();
+		for (auto& w : workers)
+			waitThread(w->thread);
+	}
+
+	int parts() const { return partCount; }
+
+	// Calls work(i) for each i in [0, count), where count <= parts()
+	void run(int count, const std::function<void(int)>& work) {
+		ASSERT(count <= partCount);
+		if (workers.empty()) {
+			for (int i = 0; i < count; i++)
+				work(i);
+			return;
+		}
+		this->work = &work;
+		for (int i = 1; i < count; i++)
+			workers[i - 1]->start.set();
+		Optional<Error> error;
+		try {
+			work(0);
+		} catch (Error& e) {
+			error = e;
+		}
+		for (int i = 1; i < count; i++) {
+			workers[i - 1]->done.block();
+			if (!error.present())
+				error = workers[i - 1]->error;
+			workers[i - 1]->error.reset();
+		}
+		if (error.present())
+			throw error.get();
+	}
+
+private:
+	struct Worker {
+		PartThreads* pool;
+		int part;
+		Event start, done;
+		Optional<Error> error;
+		THREAD_HANDLE thread;
+	};
+
+	int partCount;
+	std::vector<std::unique_ptr<Worker>> workers;
+	const std::function<void(int)>* work = nullptr;
+	bool stopping = false;
+
+	static THREAD_FUNC_RETURN workerMain(void* arg) {
+		Worker* w = static_cast<Worker*>(arg);
+		while (true) {
+			w->start.block();
+			if (w->pool->stopping)
+				break;
+			try {
+				(*w->pool->work)(w->part);
+			} catch (Error& e) {
+				w->error = e;
+			}
+			w->done.set();
+		}
+		THREAD_RETURN;
+	}
+};
+
+#endif
@@ -29,6 +29,7 @@
 #include "fdbrpc/Stats.h"
 #include "fdbserver/Knobs.h"
 #include "fdbserver/LogSystemDiskQueueAdapter.h"
+#include "fdbserver/PartThreads.h"
 #include "flow/IRandom.h"
 
 #include "flow/actorcompiler.h" // This must be the last #include.
@@ -178,6 +179,7 @@ struct ProxyCommitData {
 	KeyRangeMap<Deque<std::pair<Version, int>>> keyResolvers;
 	KeyRangeMap<ServerCacheInfo> keyInfo; // keyrange -> all storage servers in all DCs for the keyrange
 	KeyRangeMap<bool> cacheInfo;
+	std::unique_ptr<PartThreads> tagAssignmentThreads; // Look up the shards of large batches' mutations, if set
 	std::map<Key, ApplyMutationsData> uid_applyMutationsData;
 	bool firstProxy;
 	double lastCoalesceTime;
@@ -283,6 +285,11 @@ struct ProxyCommitData {
 	    lastStartCommit(0), lastCommitLatency(SERVER_KNOBS->REQUIRED_MIN_RECOVERY_DURATION), lastCommitTime(0),
 	    lastMasterReset(now()), lastResolverReset(now()) {
 		commitComputePerOperation.resize(SERVER_KNOBS->PROXY_COMPUTE_BUCKETS, 0.0);
+		if (SERVER_KNOBS->PROXY_TAG_ASSIGNMENT_THREADS > 1) {
+			// Simulation must stay deterministic, so the lookups are still split up but run on the proxy's thread
+			tagAssignmentThreads = std::make_unique<PartThreads>(
+			    SERVER_KNOBS->PROXY_TAG_ASSIGNMENT_THREADS, !g_network->isSimulated(), "fdb-proxy-tags");
+		}
 	}
 };
 
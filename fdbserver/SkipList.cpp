@@ -22,7 +22,9 @@
 #include <memory.h>
 #include <stdio.h>
 #include <algorithm>
+#include <functional>
 #include <numeric>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -32,7 +34,11 @@
 #include "fdbclient/FDBTypes.h"
 #include "fdbclient/KeyRangeMap.h"
 #include "fdbclient/SystemData.h"
+#include "fdbserver/ConflictBTree.h"
 #include "fdbserver/ConflictSet.h"
+#include "fdbserver/Knobs.h"
+#include "fdbserver/PartThreads.h"
+#include "flow/UnitTest.h"
 
 static std::vector<PerfDoubleCounter*> skc;
 
@@ -490,7 +496,6 @@ public:
 	//   partitions.  In between, operations on each partition must not touch any keys outside
 	//   the partition.  Specifically, the partition to the left of 'key' must not have a range
 	//	 [...,key) inserted, since that would insert an entry at 'key'.
-	// Note this function is not used.
 	void partition(StringRef* begin, int splitCount, SkipList* output) {
 		for (int i = splitCount - 1; i >= 0; i--) {
 			Finger f(header, begin[i]);
@@ -502,7 +507,6 @@ public:
 	}
 
 	// Concatenates multiple SkipList objects into one and stores in input[0].
-	// Note this function is not used.
 	void concatenate(SkipList* input, int count) {
 		std::vector<Finger> ends(count - 1);
 		for (int i = 0; i < ends.size(); i++)
@@ -783,19 +787,46 @@ private:
 };
 
 struct ConflictSet {
-	ConflictSet() : removalKey(makeString(0)), oldestVersion(0) {}
+	ConflictSet(bool useBTree, int threadCount, bool useThreads)
+	  : btreeHistory(useBTree ? new ConflictBTree : nullptr), removalKey(makeString(0)), oldestVersion(0) {
+		if (threadCount > 1) {
+			threads = std::make_unique<PartThreads>(threadCount, useThreads, "fdb-resolver-cs");
+			if (useBTree)
+				btreePartitions.reset(new ConflictBTree[threadCount]);
+			else
+				partitions.reset(new SkipList[threadCount]);
+		}
+	}
 	~ConflictSet() {}
 
+	// The write history is kept in btreeHistory if it is set, and in versionHistory otherwise
 	SkipList versionHistory;
+	std::unique_ptr<ConflictBTree> btreeHistory;
 	Key removalKey;
 	Version oldestVersion;
+
+	// With more than one thread, each batch's reads and writes are split by key range across the threads. The history
+	// is partitioned into the matching one of these while the writes are added.
+	std::unique_ptr<PartThreads> threads;
+	std::unique_ptr<SkipList[]> partitions;
+	std::unique_ptr<ConflictBTree[]> btreePartitions;
+
+	int historyCount() const { return btreeHistory ? btreeHistory->count() : versionHistory.count(); }
 };
 
+static ConflictSet* newConflictSet(bool useBTree, int threadCount) {
+	// Simulation must stay deterministic, so the work is still split up but runs on the calling thread
+	return new ConflictSet(useBTree, threadCount, !g_network || !g_network->isSimulated());
+}
 ConflictSet* newConflictSet() {
-	return new ConflictSet;
+	return newConflictSet(SERVER_KNOBS->RESOLVER_USE_BTREE_CONFLICT_SET, SERVER_KNOBS->RESOLVER_CONFLICT_SET_THREADS);
 }
 void clearConflictSet(ConflictSet* cs, Version v) {
-	SkipList(v).swap(cs->versionHistory);
+	if (cs->btreeHistory) {
+		ConflictBTree(v).swap(*cs->btreeHistory);
+	} else {
+		SkipList(v).swap(cs->versionHistory);
+	}
 }
 void destroyConflictSet(ConflictSet* cs) {
 	delete cs;
@@ -946,11 +977,16 @@ void ConflictBatch::detectConflicts(Version now,
 	t = timer();
 	if (newOldestVersion > cs->oldestVersion) {
 		cs->oldestVersion = newOldestVersion;
-		SkipList::Finger finger;
-		int temp;
-		cs->versionHistory.find(&cs->removalKey, &finger, &temp, 1);
-		cs->versionHistory.removeBefore(cs->oldestVersion, finger, combinedWriteConflictRanges.size() * 3 + 10);
-		cs->removalKey = finger.getValue();
+		const int removalBudget = combinedWriteConflictRanges.size() * 3 + 10;
+		if (cs->btreeHistory) {
+			cs->removalKey = cs->btreeHistory->removeBefore(cs->oldestVersion, cs->removalKey, removalBudget);
+		} else {
+			SkipList::Finger finger;
+			int temp;
+			cs->versionHistory.find(&cs->removalKey, &finger, &temp, 1);
+			cs->versionHistory.removeBefore(cs->oldestVersion, finger, removalBudget);
+			cs->removalKey = finger.getValue();
+		}
 	}
 	g_removeBefore += timer() - t;
 }
@@ -959,10 +995,117 @@ void ConflictBatch::checkReadConflictRanges() {
 	if (combinedReadConflictRanges.empty())
 		return;
 
+	if (cs->threads) {
+		checkReadConflictRangesInParallel();
+		return;
+	}
+
+	if (cs->btreeHistory) {
+		// Checking the ranges in key order lets each search reuse the upper levels of the previous one
+		std::sort(combinedReadConflictRanges.begin(), combinedReadConflictRanges.end());
+		cs->btreeHistory->detectConflicts(combinedReadConflictRanges.data(),
+		                                  combinedReadConflictRanges.size(),
+		                                  [this](const ReadConflictRange& range) {
+			                                  transactionConflictStatus[range.transaction] = true;
+			                                  if (range.conflictingKeyRange != nullptr) {
+				                                  range.conflictingKeyRange->push_back(*range.cKRArena, range.indexInTx);
+			                                  }
+		                                  });
+		return;
+	}
+
 	cs->versionHistory.detectConflicts(
 	    &combinedReadConflictRanges[0], combinedReadConflictRanges.size(), transactionConflictStatus);
 }
 
+// The read ranges, sorted by begin, are split into a contiguous key range for each thread, which checks them against the
+// history without modifying it. Conflicts are recorded per range and reported afterwards, since neither the conflict
+// status of a transaction nor its conflicting key ranges can be written from several threads.
+void ConflictBatch::checkReadConflictRangesInParallel() {
+	std::sort(combinedReadConflictRanges.begin(), combinedReadConflictRanges.end());
+	const int count = combinedReadConflictRanges.size();
+	const int parts = std::min(cs->threads->parts(), count);
+	std::unique_ptr<bool[]> conflicts(new bool[count]());
+
+	// The skip list reports conflicts by transaction, so each range stands in as its own transaction
+	std::vector<ReadConflictRange> ranges;
+	if (!cs->btreeHistory) {
+		ranges.reserve(count);
+		for (int i = 0; i < count; i++) {
+			const ReadConflictRange& r = combinedReadConflictRanges[i];
+			ranges.emplace_back(r.begin, r.end, r.version, i, r.indexInTx);
+		}
+	}
+
+	cs->threads->run(parts, [&](int part) {
+		const int begin = count * part / parts, end = count * (part + 1) / parts;
+		if (cs->btreeHistory) {
+			const ReadConflictRange* first = combinedReadConflictRanges.data();
+			cs->btreeHistory->detectConflicts(
+			    first + begin, end - begin, [&](const ReadConflictRange& r) { conflicts[&r - first] = true; });
+		} else {
+			cs->versionHistory.detectConflicts(&ranges[begin], end - begin, conflicts.get());
+		}
+	});
+
+	for (int i = 0; i < count; i++) {
+		if (!conflicts[i])
+			continue;
+		const ReadConflictRange& r = combinedReadConflictRanges[i];
+		transactionConflictStatus[r.transaction] = true;
+		if (r.conflictingKeyRange != nullptr)
+			r.conflictingKeyRange->push_back(*r.cKRArena, r.indexInTx);
+	}
+}
+
+// The combined write ranges, which are sorted and disjoint, are split into a contiguous group for each thread. The
+// history is partitioned at the first key of each group, each thread adds its group to its own partition, and the
+// partitions are then joined back together.
+void ConflictBatch::mergeWriteConflictRangesInParallel(Version now) {
+	const int count = combinedWriteConflictRanges.size();
+	const int parts = std::min(cs->threads->parts(), count);
+
+	// A partition must not receive a write ending at the next partition's first key, so a group cannot start with a
+	// write that begins where the previous one ends
+	std::vector<int> groupBegin{ 0 };
+	std::vector<StringRef> splits;
+	for (int p = 1; p < parts; p++) {
+		int w = std::max(count * p / parts, groupBegin.back() + 1);
+		while (w < count && combinedWriteConflictRanges[w].first == combinedWriteConflictRanges[w - 1].second)
+			w++;
+		if (w >= count)
+			break;
+		groupBegin.push_back(w);
+		splits.push_back(combinedWriteConflictRanges[w].first);
+	}
+	groupBegin.push_back(count);
+	const int groups = splits.size() + 1;
+
+	if (cs->btreeHistory) {
+		cs->btreeHistory->partition(splits.data(), splits.size(), cs->btreePartitions.get());
+	} else {
+		cs->versionHistory.partition(splits.data(), splits.size(), cs->partitions.get());
+	}
+
+	cs->threads->run(groups, [&](int g) {
+		auto begin = combinedWriteConflictRanges.begin() + groupBegin[g];
+		auto end = combinedWriteConflictRanges.begin() + groupBegin[g + 1];
+		if (cs->btreeHistory) {
+			for (auto range = begin; range != end; ++range) {
+				cs->btreePartitions[g].addConflictRange(range->first, range->second, now);
+			}
+		} else {
+			addConflictRanges(now, begin, end, &cs->partitions[g]);
+		}
+	});
+
+	if (cs->btreeHistory) {
+		cs->btreeHistory->concatenate(cs->btreePartitions.get(), groups);
+	} else {
+		cs->versionHistory.concatenate(cs->partitions.get(), groups);
+	}
+}
+
 void ConflictBatch::addConflictRanges(Version now,
                                       std::vector<std::pair<StringRef, StringRef>>::iterator begin,
                                       std::vector<std::pair<StringRef, StringRef>>::iterator end,
@@ -990,6 +1133,18 @@ void ConflictBatch::mergeWriteConflictRanges(Version now) {
 	if (combinedWriteConflictRanges.empty())
 		return;
 
+	if (cs->threads) {
+		mergeWriteConflictRangesInParallel(now);
+		return;
+	}
+
+	if (cs->btreeHistory) {
+		for (const auto& range : combinedWriteConflictRanges) {
+			cs->btreeHistory->addConflictRange(range.first, range.second, now);
+		}
+		return;
+	}
+
 	addConflictRanges(now, combinedWriteConflictRanges.begin(), combinedWriteConflictRanges.end(), &cs->versionHistory);
 }
 
@@ -1079,45 +1234,22 @@ void operatorLessThanTest() {
 }
 } // namespace
 
-void skipListTest() {
-	printf("Skip list test\n");
-
-	miniConflictSetTest();
-
-	operatorLessThanTest();
-
-	setAffinity(0);
-
-	double start;
-
-	ConflictSet* cs = newConflictSet();
-
-	Arena testDataArena;
-	VectorRef<VectorRef<KeyRangeRef>> testData;
-	const int batches = 500; // deterministicRandom()->randomInt(500, 5000);
-	const int data_per_batch = 5000;
-	testData.resize(testDataArena, batches);
-	std::vector<std::vector<uint8_t>> success(batches);
-	std::vector<std::vector<uint8_t>> success2(batches);
-	for (int i = 0; i < batches; i++) {
-		testData[i].resize(testDataArena, data_per_batch);
-		success[i].assign(data_per_batch, false);
-		success2[i].assign(data_per_batch, false);
-		for (int j = 0; j < data_per_batch; j++) {
-			int key = deterministicRandom()->randomInt(0, 20000000);
-			int key2 = key + 1 + deterministicRandom()->randomInt(0, 10);
-			testData[i][j] = KeyRangeRef(setK(testDataArena, key), setK(testDataArena, key2));
-		}
+// Runs the batches of testData through a conflict set, returning the non-conflicting transactions of each batch
+static std::vector<std::vector<int>> runConflictSetTest(const char* name,
+                                                        bool useBTree,
+                                                        int threadCount,
+                                                        const VectorRef<VectorRef<KeyRangeRef>>& testData) {
+	for (auto counter : skc) {
+		counter->clear();
 	}
-	printf("Test data generated: %d batches, %d/batch\n", batches, data_per_batch);
 
-	printf("Running\n");
+	ConflictSet* cs = newConflictSet(useBTree, threadCount);
 
 	int readCount = 1, writeCount = 1;
 	int cranges = 0, tcount = 0;
 
-	start = timer();
-	std::vector<std::vector<int>> nonConflict(batches);
+	double start = timer();
+	std::vector<std::vector<int>> nonConflict(testData.size());
 	Version version = 0;
 	for (const auto& data : testData) {
 		Arena buf;
@@ -1154,6 +1286,7 @@ void skipListTest() {
 		version++;
 	}
 	double elapsed = timer() - start;
+	printf("%s:\n", name);
 	printf("New conflict set: %0.3f sec\n", elapsed);
 	printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
 	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
@@ -1164,7 +1297,7 @@ void skipListTest() {
 	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
 
 	elapsed = g_checkRead.getValue() + g_merge.getValue();
-	printf("Skiplist only:    %0.3f sec\n", elapsed);
+	printf("History only:     %0.3f sec\n", elapsed);
 	printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
 	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
 
@@ -1173,5 +1306,126 @@ void skipListTest() {
 		printf("%20s: %s\n", counter->getMetric().name().c_str(), counter->getMetric().formatted().c_str());
 	}
 
-	printf("%d entries in version history\n", cs->versionHistory.count());
+	printf("%d entries in version history\n", cs->historyCount());
+	destroyConflictSet(cs);
+	return nonConflict;
+}
+
+void skipListTest() {
+	printf("Skip list test\n");
+
+	miniConflictSetTest();
+
+	operatorLessThanTest();
+
+	setAffinity(0);
+
+	Arena testDataArena;
+	VectorRef<VectorRef<KeyRangeRef>> testData;
+	const int batches = 500; // deterministicRandom()->randomInt(500, 5000);
+	const int data_per_batch = 5000;
+	testData.resize(testDataArena, batches);
+	for (int i = 0; i < batches; i++) {
+		testData[i].resize(testDataArena, data_per_batch);
+		for (int j = 0; j < data_per_batch; j++) {
+			int key = deterministicRandom()->randomInt(0, 20000000);
+			int key2 = key + 1 + deterministicRandom()->randomInt(0, 10);
+			testData[i][j] = KeyRangeRef(setK(testDataArena, key), setK(testDataArena, key2));
+		}
+	}
+	printf("Test data generated: %d batches, %d/batch\n", batches, data_per_batch);
+
+	printf("Running\n");
+
+	std::vector<std::vector<int>> skipListResults = runConflictSetTest("Skip list", false, 1, testData);
+	std::vector<std::vector<int>> btreeResults = runConflictSetTest("B+tree", true, 1, testData);
+	printf("Results %s\n", skipListResults == btreeResults ? "match" : "DO NOT MATCH");
+
+	const int threadCount = 4;
+	std::vector<std::vector<int>> parallelSkipListResults =
+	    runConflictSetTest("Skip list, 4 threads", false, threadCount, testData);
+	std::vector<std::vector<int>> parallelBTreeResults =
+	    runConflictSetTest("B+tree, 4 threads", true, threadCount, testData);
+	printf("Results %s\n",
+	       skipListResults == parallelSkipListResults && skipListResults == parallelBTreeResults ? "match"
+	                                                                                            : "DO NOT MATCH");
+}
+
+namespace {
+// Short keys from a small alphabet, sometimes behind a long shared prefix, so that ranges overlap often
+StringRef randomConflictKey(Arena& arena, StringRef prefix) {
+	std::string key = prefix.toString();
+	for (int i = deterministicRandom()->randomInt(0, 5); i > 0; i--)
+		key += (char)deterministicRandom()->randomInt('a', 'g');
+	return StringRef(arena, key);
+}
+
+KeyRangeRef randomConflictRange(Arena& arena, StringRef prefix) {
+	StringRef a = randomConflictKey(arena, prefix), b = randomConflictKey(arena, prefix);
+	if (b < a)
+		std::swap(a, b);
+	if (a == b)
+		b = keyAfter(a, arena);
+	return KeyRangeRef(a, b);
+}
+
+// Checks that actual resolves random batches exactly as expected does, including the conflicting key ranges reported
+void compareConflictSets(ConflictSet* expected, ConflictSet* actual) {
+	Arena prefixArena;
+	StringRef prefix = deterministicRandom()->coinflip()
+	                       ? StringRef()
+	                       : StringRef(prefixArena, std::string(deterministicRandom()->randomInt(1, 20), '/'));
+
+	Version version = 100;
+	for (int b = 0; b < 500; b++) {
+		Arena arena;
+		std::vector<CommitTransactionRef> trs(deterministicRandom()->randomInt(1, 50));
+		for (auto& tr : trs) {
+			tr.read_snapshot = version - deterministicRandom()->randomInt(0, 30);
+			tr.report_conflicting_keys = deterministicRandom()->coinflip();
+			for (int r = deterministicRandom()->randomInt(0, 4); r > 0; r--)
+				tr.read_conflict_ranges.push_back(arena, randomConflictRange(arena, prefix));
+			for (int w = deterministicRandom()->randomInt(0, 4); w > 0; w--)
+				tr.write_conflict_ranges.push_back(arena, randomConflictRange(arena, prefix));
+		}
+
+		std::vector<int> expectedCommits, actualCommits, expectedTooOld, actualTooOld;
+		std::map<int, VectorRef<int>> expectedConflictingRanges, actualConflictingRanges;
+		Arena replyArena;
+		ConflictBatch expectedBatch(expected, &expectedConflictingRanges, &replyArena);
+		ConflictBatch actualBatch(actual, &actualConflictingRanges, &replyArena);
+		for (const auto& tr : trs) {
+			expectedBatch.addTransaction(tr);
+			actualBatch.addTransaction(tr);
+		}
+		expectedBatch.detectConflicts(version, version - 20, expectedCommits, &expectedTooOld);
+		actualBatch.detectConflicts(version, version - 20, actualCommits, &actualTooOld);
+		ASSERT(expectedCommits == actualCommits);
+		ASSERT(expectedTooOld == actualTooOld);
+
+		// The order in which a transaction's conflicting ranges are found is not significant
+		ASSERT(expectedConflictingRanges.size() == actualConflictingRanges.size());
+		for (const auto& [t, ranges] : expectedConflictingRanges) {
+			ASSERT(actualConflictingRanges.count(t));
+			const VectorRef<int>& other = actualConflictingRanges[t];
+			ASSERT(std::set<int>(ranges.begin(), ranges.end()) == std::set<int>(other.begin(), other.end()));
+		}
+
+		version += deterministicRandom()->randomInt(1, 5);
+	}
+
+	destroyConflictSet(expected);
+	destroyConflictSet(actual);
+}
+} // namespace
+
+TEST_CASE("/fdbserver/ConflictSet/BTreeMatchesSkipList") {
+	compareConflictSets(newConflictSet(false, 1), newConflictSet(true, 1));
+	return Void();
+}
+
+TEST_CASE("/fdbserver/ConflictSet/PartitionedMatchesSingle") {
+	compareConflictSets(newConflictSet(false, 1),
+	                    newConflictSet(deterministicRandom()->coinflip(), deterministicRandom()->randomInt(2, 9)));
+	return Void();
 }
@@ -45,7 +45,9 @@
 #include "fdbserver/WaitFailure.h"
 #include "fdbserver/RecoveryState.h"
 #include "fdbserver/FDBExecHelper.actor.h"
+#include "fdbserver/CoroFlow.h"
 #include "flow/Histogram.h"
+#include "flow/IThreadPool.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
 
 struct TLogQueueEntryRef {
@@ -293,6 +295,89 @@ struct SpilledData {
 	uint32_t mutationBytes = 0;
 };
 
+// Returns the messages in commitBlob that are for tag. See the comment in LogSystem.cpp for the binary format of
+// commitBlob.
+static std::vector<StringRef> parseMessagesForTag(StringRef commitBlob,
+                                                  Tag tag,
+                                                  int logRouters,
+                                                  ProtocolVersion protocolVersion) {
+	std::vector<StringRef> relevantMessages;
+	BinaryReader rd(commitBlob, AssumeVersion(protocolVersion));
+	while (!rd.empty()) {
+		TagsAndMessage tagsAndMessage;
+		tagsAndMessage.loadFromArena(&rd, nullptr);
+		for (Tag t : tagsAndMessage.tags) {
+			if (t == tag || (tag.locality == tagLocalityLogRouter && t.locality == tagLocalityLogRouter &&
+			                 t.id % logRouters == tag.id)) {
+				// Mutations that are in the partially durable span between known comitted version and
+				// recovery version get copied to the new log generation.  These commits might have had more
+				// log router tags than what now exist, so we mod them down to what we have.
+				relevantMessages.push_back(tagsAndMessage.getRawMessage());
+				break;
+			}
+		}
+	}
+	return relevantMessages;
+}
+
+// The messages for one tag from a run of spilled commits, in peek reply format
+struct SpilledPeekMessages {
+	Standalone<StringRef> messages;
+	Version lastVersion = 0;
+	// The version, offset and length in messages of each message, for mutation tracking. TraceEvents can only be
+	// logged from the network thread, so these are logged once the result is back there.
+	std::vector<std::tuple<Version, int, int>> trackedMessages;
+};
+
+// Turns the disk queue entries read back for a peek of spilled data into the peek reply's messages. Catching up a
+// lagging storage server or log router can mean parsing a lot of spilled commits, so this runs on its own threads
+// rather than on the network thread that serves commits.
+struct SpilledPeekReader : IThreadPoolReceiver {
+	void init() override {}
+
+	struct ParseMessagesAction : TypedAction<SpilledPeekReader, ParseMessagesAction> {
+		std::vector<Standalone<StringRef>> queueEntries;
+		Tag tag;
+		int logRouters;
+		ProtocolVersion protocolVersion;
+		ThreadReturnPromise<SpilledPeekMessages> result;
+
+		ParseMessagesAction(Tag tag, int logRouters, ProtocolVersion protocolVersion)
+		  : tag(tag), logRouters(logRouters), protocolVersion(protocolVersion) {}
+		double getTimeEstimate() const override { return 0; }
+	};
+	void action(ParseMessagesAction& a) {
+		try {
+			BinaryWriter messages(Unversioned());
+			SpilledPeekMessages result;
+			for (const Standalone<StringRef>& queueEntry : a.queueEntries) {
+				uint8_t valid;
+				const uint32_t length = *(uint32_t*)queueEntry.begin();
+				StringRef queueEntryData = queueEntry.substr(4, queueEntry.size() - 4);
+				BinaryReader rd(queueEntryData, IncludeVersion());
+				TLogQueueEntry entry;
+				rd >> entry >> valid;
+				ASSERT(valid == 0x01);
+				ASSERT(length + sizeof(valid) == queueEntryData.size());
+
+				messages << VERSION_HEADER << entry.version;
+
+				for (const StringRef& msg : parseMessagesForTag(entry.messages, a.tag, a.logRouters, a.protocolVersion)) {
+					if (MUTATION_TRACKING_ENABLED) {
+						result.trackedMessages.emplace_back(entry.version, messages.getLength(), msg.size());
+					}
+					messages.serializeBytes(msg);
+				}
+				result.lastVersion = entry.version;
+			}
+			result.messages = messages.toValue();
+			a.result.send(result);
+		} catch (Error& e) {
+			a.result.sendError(e);
+		}
+	}
+};
+
 struct TLogData : NonCopyable {
 	AsyncTrigger newLogData;
 	// A process has only 1 SharedTLog, which holds data for multiple logs, so that it obeys its assigned memory limit.
@@ -350,6 +435,8 @@ struct TLogData : NonCopyable {
 
 	WorkerCache<TLogInterface> tlogCache;
 	FlowLock peekMemoryLimiter;
+	FlowLock spilledPeekReads; // bounds the peeks reading spilled data from disk at once, to protect commits
+	Reference<IThreadPool> spilledPeekThreads;
 
 	PromiseStream<Future<Void>> sharedActors;
 	Promise<Void> terminated;
@@ -387,12 +474,19 @@ struct TLogData : NonCopyable {
 	    instanceID(deterministicRandom()->randomUniqueID().first()), bytesInput(0), bytesDurable(0),
 	    targetVolatileBytes(SERVER_KNOBS->TLOG_SPILL_THRESHOLD), overheadBytesInput(0), overheadBytesDurable(0),
 	    peekMemoryLimiter(SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES),
+	    spilledPeekReads(SERVER_KNOBS->TLOG_SPILLED_PEEK_MAX_CONCURRENT_READS),
 	    concurrentLogRouterReads(SERVER_KNOBS->CONCURRENT_LOG_ROUTER_READS), ignorePopRequest(false),
 	    dataFolder(folder), degraded(degraded),
 	    commitLatencyDist(Histogram::getHistogram(LiteralStringRef("tLog"),
 	                                              LiteralStringRef("commit"),
 	                                              Histogram::Unit::microseconds)) {
 		cx = openDBOnServer(dbInfo, TaskPriority::DefaultEndpoint, LockAware::True);
+		// In simulation the readers run as coroutines on the network thread, so that runs stay deterministic
+		spilledPeekThreads =
+		    g_network->isSimulated() ? CoroThreadPool::createThreadPool() : createGenericThreadPool();
+		for (int i = 0; i < SERVER_KNOBS->TLOG_SPILLED_PEEK_THREADS; i++) {
+			spilledPeekThreads->addThread(new SpilledPeekReader(), "fdb-tlog-peek");
+		}
 	}
 };
 
@@ -672,6 +766,8 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		specialCounter(cc, "SharedOverheadBytesDurable", [tLogData]() { return tLogData->overheadBytesDurable; });
 		specialCounter(cc, "PeekMemoryReserved", [tLogData]() { return tLogData->peekMemoryLimiter.activePermits(); });
 		specialCounter(cc, "PeekMemoryRequestsStalled", [tLogData]() { return tLogData->peekMemoryLimiter.waiters(); });
+		specialCounter(
+		    cc, "SpilledPeekReadsStalled", [tLogData]() { return tLogData->spilledPeekReads.waiters(); });
 		specialCounter(cc, "Generation", [this]() { return this->recoveryCount; });
 		specialCounter(cc, "ActivePeekStreams", [tLogData]() { return tLogData->activePeekStreams; });
 	}
@@ -1573,28 +1669,6 @@ void peekMessagesFromMemory(Reference<LogData> self,
 	}
 }
 
-ACTOR Future<std::vector<StringRef>> parseMessagesForTag(StringRef commitBlob, Tag tag, int logRouters) {
-	// See the comment in LogSystem.cpp for the binary format of commitBlob.
-	state std::vector<StringRef> relevantMessages;
-	state BinaryReader rd(commitBlob, AssumeVersion(g_network->protocolVersion()));
-	while (!rd.empty()) {
-		TagsAndMessage tagsAndMessage;
-		tagsAndMessage.loadFromArena(&rd, nullptr);
-		for (Tag t : tagsAndMessage.tags) {
-			if (t == tag || (tag.locality == tagLocalityLogRouter && t.locality == tagLocalityLogRouter &&
-			                 t.id % logRouters == tag.id)) {
-				// Mutations that are in the partially durable span between known comitted version and
-				// recovery version get copied to the new log generation.  These commits might have had more
-				// log router tags than what now exist, so we mod them down to what we have.
-				relevantMessages.push_back(tagsAndMessage.getRawMessage());
-				break;
-			}
-		}
-		wait(yield());
-	}
-	return relevantMessages;
-}
-
 // Common logics to peek TLog and create TLogPeekReply that serves both streaming peek or normal peek request
 ACTOR template <typename PromiseType>
 Future<Void> tLogPeekMessages(PromiseType replyPromise,
@@ -1759,11 +1833,14 @@ Future<Void> tLogPeekMessages(PromiseType replyPromise,
 		}
 
 		if (logData->shouldSpillByValue(reqTag)) {
+			wait(self->spilledPeekReads.take(TaskPriority::TLogSpilledPeekReply));
+			state FlowLock::Releaser valueReadReservation(self->spilledPeekReads);
 			RangeResult kvs = wait(self->persistentData->readRange(
 			    KeyRangeRef(persistTagMessagesKey(logData->logId, reqTag, reqBegin),
 			                persistTagMessagesKey(logData->logId, reqTag, logData->persistentDataDurableVersion + 1)),
 			    SERVER_KNOBS->DESIRED_TOTAL_BYTES,
 			    SERVER_KNOBS->DESIRED_TOTAL_BYTES));
+			valueReadReservation.release();
 
 			for (auto& kv : kvs) {
 				auto ver = decodeTagMessagesKey(kv.key);
@@ -1818,6 +1895,8 @@ Future<Void> tLogPeekMessages(PromiseType replyPromise,
 			earlyEnd = earlyEnd || (kvrefs.size() >= SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK + 1);
 			wait(self->peekMemoryLimiter.take(TaskPriority::TLogSpilledPeekReply, commitBytes));
 			state FlowLock::Releaser memoryReservation(self->peekMemoryLimiter, commitBytes);
+			wait(self->spilledPeekReads.take(TaskPriority::TLogSpilledPeekReply));
+			state FlowLock::Releaser readReservation(self->spilledPeekReads);
 			state std::vector<Future<Standalone<StringRef>>> messageReads;
 			messageReads.reserve(commitLocations.size());
 			for (const auto& pair : commitLocations) {
@@ -1825,38 +1904,26 @@ Future<Void> tLogPeekMessages(PromiseType replyPromise,
 			}
 			commitLocations.clear();
 			wait(waitForAll(messageReads));
+			readReservation.release();
 
-			state Version lastRefMessageVersion = 0;
-			state int index = 0;
-			loop {
-				if (index >= messageReads.size())
-					break;
-				Standalone<StringRef> queueEntryData = messageReads[index].get();
-				uint8_t valid;
-				const uint32_t length = *(uint32_t*)queueEntryData.begin();
-				queueEntryData = queueEntryData.substr(4, queueEntryData.size() - 4);
-				BinaryReader rd(queueEntryData, IncludeVersion());
-				state TLogQueueEntry entry;
-				rd >> entry >> valid;
-				ASSERT(valid == 0x01);
-				ASSERT(length + sizeof(valid) == queueEntryData.size());
-
-				messages << VERSION_HEADER << entry.version;
-
-				std::vector<StringRef> rawMessages =
-				    wait(parseMessagesForTag(entry.messages, reqTag, logData->logRouterTags));
-				for (const StringRef& msg : rawMessages) {
-					messages.serializeBytes(msg);
-					DEBUG_TAGS_AND_MESSAGE("TLogPeekFromDisk", entry.version, msg, logData->logId)
-					    .detail("DebugID", self->dbgid)
-					    .detail("PeekTag", reqTag);
-				}
-
-				lastRefMessageVersion = entry.version;
-				index++;
+			auto* parse =
+			    new SpilledPeekReader::ParseMessagesAction(reqTag, logData->logRouterTags, g_network->protocolVersion());
+			parse->queueEntries.reserve(messageReads.size());
+			for (const auto& read : messageReads) {
+				parse->queueEntries.push_back(read.get());
 			}
-
 			messageReads.clear();
+			state Future<SpilledPeekMessages> parsed = parse->result.getFuture();
+			self->spilledPeekThreads->post(parse);
+			SpilledPeekMessages spilledMessages = wait(parsed);
+			for (auto const& [version, offset, length] : spilledMessages.trackedMessages) {
+				DEBUG_TAGS_AND_MESSAGE(
+				    "TLogPeekFromDisk", version, spilledMessages.messages.substr(offset, length), logData->logId)
+				    .detail("DebugID", self->dbgid)
+				    .detail("PeekTag", reqTag);
+			}
+			messages.serializeBytes(spilledMessages.messages);
+			Version lastRefMessageVersion = spilledMessages.lastVersion;
 			memoryReservation.release();
 
 			if (earlyEnd) {
@@ -46,7 +46,12 @@
 #include <string.h>
 #include "flow/actorcompiler.h"
 #include <cinttypes>
+#include <array>
 #include <boost/intrusive/list.hpp>
+#ifdef REDWOOD_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
 
 #define REDWOOD_DEBUG 0
 
@@ -1612,8 +1617,18 @@ struct RedwoodMetrics {
 		unsigned int pagerProbeMiss;
 		unsigned int pagerEvictUnhit;
 		unsigned int pagerEvictFail;
+		unsigned int pagerEvictProtected;
+		unsigned int pagerCachePromote;
+		unsigned int pagerCacheDemote;
 		unsigned int btreeLeafPreload;
 		unsigned int btreeLeafPreloadExt;
+		unsigned int btreeLeafCompress;
+		unsigned int btreeLeafCompressSkip;
+		unsigned int btreeLeafCompressBytesIn;
+		unsigned int btreeLeafCompressBytesOut;
+		unsigned int btreeLeafCompressMicros;
+		unsigned int btreeLeafDecompress;
+		unsigned int btreeLeafDecompressMicros;
 	};
 
 	RedwoodMetrics() {
@@ -1723,6 +1738,14 @@ struct RedwoodMetrics {
 		std::pair<const char*, unsigned int> metrics[] = { { "BTreePreload", metric.btreeLeafPreload },
 			                                               { "BTreePreloadExt", metric.btreeLeafPreloadExt },
 			                                               { "", 0 },
+			                                               { "BTreeCompress", metric.btreeLeafCompress },
+			                                               { "BTreeCompressSkip", metric.btreeLeafCompressSkip },
+			                                               { "BTreeCompressIn", metric.btreeLeafCompressBytesIn },
+			                                               { "BTreeCompressOut", metric.btreeLeafCompressBytesOut },
+			                                               { "BTreeCompressUs", metric.btreeLeafCompressMicros },
+			                                               { "BTreeDecompress", metric.btreeLeafDecompress },
+			                                               { "BTreeDecompressUs", metric.btreeLeafDecompressMicros },
+			                                               { "", 0 },
 			                                               { "OpSet", metric.opSet },
 			                                               { "OpSetKeyBytes", metric.opSetKeyBytes },
 			                                               { "OpSetValueBytes", metric.opSetValueBytes },
@@ -1742,6 +1765,9 @@ struct RedwoodMetrics {
 			                                               { "PagerProbeMiss", metric.pagerProbeMiss },
 			                                               { "PagerEvictUnhit", metric.pagerEvictUnhit },
 			                                               { "PagerEvictFail", metric.pagerEvictFail },
+			                                               { "PagerEvictProtected", metric.pagerEvictProtected },
+			                                               { "PagerCachePromote", metric.pagerCachePromote },
+			                                               { "PagerCacheDemote", metric.pagerCacheDemote },
 			                                               { "", 0 },
 			                                               { "PagerRemapFree", metric.pagerRemapFree },
 			                                               { "PagerRemapCopy", metric.pagerRemapCopy },
@@ -1871,8 +1897,22 @@ ACTOR Future<Void> redwoodMetricsLogger() {
 // ObjectType must have the methods
 //   bool evictable() const;            // return true if the entry can be evicted
 //   Future<Void> onEvictable() const;  // ready when entry can be evicted
+//
+// Replacement is a segmented LRU.  New entries start in a probation segment and are promoted to a protected segment
+// when they are accessed again, unless the access is marked as part of a scan, so a large range read cycles through
+// probation without displacing the protected working set.  The protected segment is capped at a fraction of its
+// budget; entries pushed out of it are demoted back to probation rather than evicted.
+//
+// Each entry is also charged to one of budgetCount budgets, each reserving a fraction of the cache.  When the cache
+// is full the budget furthest over its reservation gives up an entry, so one budget can use space another is not
+// using but can never push it below its reservation.
 template <class IndexType, class ObjectType>
 class ObjectCache : NonCopyable {
+public:
+	static constexpr int budgetCount = 2;
+
+private:
+	enum class Segment : uint8_t { Probation, Protected, Prioritized };
 
 	struct Entry : public boost::intrusive::list_base_hook<> {
 		Entry() : hits(0), size(0) {}
@@ -1881,18 +1921,52 @@ class ObjectCache : NonCopyable {
 		int hits;
 		int size;
 		bool evictionPrioritized;
+		Segment segment;
+		uint8_t budget;
 	};
 
 	typedef std::unordered_map<IndexType, Entry> CacheT;
 	typedef boost::intrusive::list<Entry> EvictionOrderT;
 
+	struct Budget {
+		Budget() : fraction(0), size(0), protectedSize(0), limit(0), protectedLimit(0) {}
+		double fraction;
+		int64_t size;
+		int64_t protectedSize;
+		int64_t limit;
+		int64_t protectedLimit;
+		EvictionOrderT probation;
+		EvictionOrderT protect;
+	};
+
 public:
-	ObjectCache(int sizeLimit = 1) : sizeLimit(sizeLimit), currentSize(0) {}
+	ObjectCache(int sizeLimit = 1) : sizeLimit(sizeLimit), currentSize(0), protectedFraction(1.0) {
+		budgets[0].fraction = 1.0;
+		updateLimits();
+	}
 
-	void setSizeLimit(int n) {
+	// Split the cache between the budgets, fractions[0] taking whatever the others do not, and cap each budget's
+	// protected segment at protectedFraction of it.
+	void setBudgets(std::array<double, budgetCount> const& fractions, double protectedFraction) {
+		double rest = 1.0;
+		for (int b = 1; b < budgetCount; ++b) {
+			ASSERT(fractions[b] >= 0 && fractions[b] <= rest);
+			budgets[b].fraction = fractions[b];
+			rest -= fractions[b];
+		}
+		budgets[0].fraction = rest;
+		this->protectedFraction = protectedFraction;
+		updateLimits();
+	}
+
+	// May be called at any time.  If the cache shrinks, evictable entries are evicted immediately and any remaining
+	// excess is given up on later accesses.
+	void setSizeLimit(int64_t n) {
 		ASSERT(n > 0);
 		sizeLimit = n;
 		cache.reserve(n);
+		updateLimits();
+		evict(nullptr);
 	}
 
 	// Get the object for i if it exists, else return nullptr.
@@ -1906,30 +1980,48 @@ public:
 		return nullptr;
 	}
 
+	// Get the object for i if it exists, else return nullptr, without counting this as an access to it.
+	ObjectType* peek(const IndexType& index) {
+		auto i = cache.find(index);
+		return i != cache.end() ? &i->second.item : nullptr;
+	}
+
 	// If index is in cache and not on the prioritized eviction order list, move it there.
 	void prioritizeEviction(const IndexType& index) {
 		auto i = cache.find(index);
 		if (i != cache.end() && !i->second.evictionPrioritized) {
-			prioritizedEvictions.splice(
-			    prioritizedEvictions.end(), evictionOrder, EvictionOrderT::s_iterator_to(i->second));
-			i->second.evictionPrioritized = true;
+			Entry& entry = i->second;
+			unlink(entry);
+			prioritizedEvictions.push_back(entry);
+			entry.segment = Segment::Prioritized;
+			entry.evictionPrioritized = true;
 		}
 	}
 
-	// Get the object for i or create a new one.
-	// After a get(), the object for i is the last in evictionOrder.
+	// Get the object for i or create a new one, charging it to the given budget.
+	// After a get(), the object for i is the last in its segment's eviction order.
 	// If noHit is set, do not consider this access to be cache hit if the object is present
-	// If noMiss is set, do not consider this access to be a cache miss if the object is not present
-	ObjectType& get(const IndexType& index, int size, bool noHit = false) {
+	// If scan is set, a hit refreshes the object's position but does not promote it out of probation
+	ObjectType& get(const IndexType& index, int size, bool noHit = false, bool scan = false, int budget = 0) {
+		ASSERT(budget >= 0 && budget < budgetCount);
 		Entry& entry = cache[index];
 
-		// If entry is linked into evictionOrder then move it to the back of the order
+		// If entry is linked into an eviction order then update its position
 		if (entry.is_linked()) {
+			// The object may now be charged to a different budget, such as a page ID reused at another level
+			if (entry.budget != budget && !entry.evictionPrioritized) {
+				unlink(entry);
+				budgets[entry.budget].size -= entry.size;
+				entry.budget = budget;
+				budgets[budget].size += entry.size;
+				budgets[budget].probation.push_back(entry);
+				entry.segment = Segment::Probation;
+			}
 			if (!noHit) {
 				++entry.hits;
 				// If item eviction is not prioritized, move to back of eviction order
 				if (!entry.evictionPrioritized) {
-					evictionOrder.splice(evictionOrder.end(), evictionOrder, EvictionOrderT::s_iterator_to(entry));
+					touch(entry, scan);
 				}
 			}
 		} else {
@@ -1938,51 +2030,35 @@ public:
 			entry.index = index;
 			entry.hits = 0;
 			entry.size = size;
+			entry.budget = budget;
 			currentSize += size;
-			// Insert the newly created Entry at the back of the eviction order
-			evictionOrder.push_back(entry);
+			budgets[budget].size += size;
+			// Insert the newly created Entry at the back of the probation order
+			budgets[budget].probation.push_back(entry);
+			entry.segment = Segment::Probation;
 			entry.evictionPrioritized = false;
 
-			// While the cache is too big, evict the oldest entry until the oldest entry can't be evicted.
-			while (currentSize > sizeLimit) {
-				Entry& toEvict = evictionOrder.front();
-
-				// It's critical that we do not evict the item we just added because it would cause the reference
-				// returned to be invalid.  An eviction could happen with a no-hit access to a cache resident page
-				// that is currently evictable and exists in the oversized portion of the cache eviction order due
-				// to previously failed evictions.
-				if (&entry == &toEvict) {
-					debug_printf("Cannot evict target index %s\n", toString(index).c_str());
-					break;
-				}
-
-				debug_printf("currentSize is %u and input size is %u. Trying to evict %s to make room for %s\n",
-				             currentSize,
-				             size,
-				             toString(toEvict.index).c_str(),
-				             toString(index).c_str());
-
-				if (!toEvict.item.evictable()) {
-					// shift the front to the back
-					evictionOrder.shift_forward(1);
-					++g_redwoodMetrics.metric.pagerEvictFail;
-					break;
-				} else {
-					if (toEvict.hits == 0) {
-						++g_redwoodMetrics.metric.pagerEvictUnhit;
-					}
-					currentSize -= toEvict.size;
-					debug_printf(
-					    "Evicting %s to make room for %s\n", toString(toEvict.index).c_str(), toString(index).c_str());
-					evictionOrder.pop_front();
-					cache.erase(toEvict.index);
-				}
-			}
+			evict(&entry);
 		}
 
 		return entry.item;
 	}
 
+	// Add delta to the size charged for the object for index, which must exist.  If the cache is now too big, other
+	// entries are evicted.
+	void charge(const IndexType& index, int delta) {
+		auto i = cache.find(index);
+		ASSERT(i != cache.end());
+		Entry& entry = i->second;
+		entry.size += delta;
+		currentSize += delta;
+		budgets[entry.budget].size += delta;
+		if (entry.segment == Segment::Protected) {
+			budgets[entry.budget].protectedSize += delta;
+		}
+		evict(&entry);
+	}
+
 	// Clears the cache, saving the entries to second cache, then waits for each item to be evictable and evicts it.
 	ACTOR static Future<Void> clear_impl(ObjectCache* self) {
 		state ObjectCache::CacheT cache;
@@ -1991,7 +2067,6 @@ public:
 
 		// Flush all prioritized evictions to the main eviction order
 		self->flushPrioritizedEvictions();
-		ASSERT(cache.size() == evictionOrder.size());
 
 		// Swap cache contents to local state vars
 		// After this, no more entries will be added to or read from these
@@ -1999,7 +2074,12 @@ public:
 		// after it is either evictable or onEvictable() is ready.
 		cache.swap(self->cache);
 		currentSize = self->currentSize;
-		evictionOrder.swap(self->evictionOrder);
+		for (auto& b : self->budgets) {
+			evictionOrder.splice(evictionOrder.end(), b.protect);
+			evictionOrder.splice(evictionOrder.end(), b.probation);
+			b.size = b.protectedSize = 0;
+		}
+		ASSERT(cache.size() == evictionOrder.size());
 
 		state typename EvictionOrderT::iterator i = evictionOrder.begin();
 		state typename EvictionOrderT::iterator iEnd = evictionOrder.end();
@@ -2019,20 +2099,137 @@ public:
 	}
 
 	Future<Void> clear() {
-		ASSERT(evictionOrder.size() + prioritizedEvictions.size() == cache.size());
+		ASSERT(linkedCount() == cache.size());
 		return clear_impl(this);
 	}
 
 	int count() const { return currentSize; }
 
-	// Move the prioritized evictions queued to the front of the eviction order
-	void flushPrioritizedEvictions() { evictionOrder.splice(evictionOrder.begin(), prioritizedEvictions); }
+	// Move the prioritized evictions queued to the front of their budgets' probation orders
+	void flushPrioritizedEvictions() {
+		while (!prioritizedEvictions.empty()) {
+			Entry& entry = prioritizedEvictions.back();
+			prioritizedEvictions.pop_back();
+			budgets[entry.budget].probation.push_front(entry);
+			entry.segment = Segment::Probation;
+		}
+	}
 
 private:
+	void updateLimits() {
+		for (auto& b : budgets) {
+			b.limit = sizeLimit * b.fraction;
+			b.protectedLimit = b.limit * protectedFraction;
+		}
+	}
+
+	size_t linkedCount() const {
+		size_t n = prioritizedEvictions.size();
+		for (auto& b : budgets) {
+			n += b.probation.size() + b.protect.size();
+		}
+		return n;
+	}
+
+	// Remove entry from whichever eviction order it is in.  The entry stays charged to its budget.
+	void unlink(Entry& entry) {
+		Budget& b = budgets[entry.budget];
+		switch (entry.segment) {
+		case Segment::Probation:
+			b.probation.erase(EvictionOrderT::s_iterator_to(entry));
+			break;
+		case Segment::Protected:
+			b.protect.erase(EvictionOrderT::s_iterator_to(entry));
+			b.protectedSize -= entry.size;
+			break;
+		case Segment::Prioritized:
+			prioritizedEvictions.erase(EvictionOrderT::s_iterator_to(entry));
+			break;
+		}
+	}
+
+	void touch(Entry& entry, bool scan) {
+		Budget& b = budgets[entry.budget];
+		if (entry.segment == Segment::Protected) {
+			b.protect.splice(b.protect.end(), b.protect, EvictionOrderT::s_iterator_to(entry));
+		} else if (scan) {
+			b.probation.splice(b.probation.end(), b.probation, EvictionOrderT::s_iterator_to(entry));
+		} else {
+			b.protect.splice(b.protect.end(), b.probation, EvictionOrderT::s_iterator_to(entry));
+			entry.segment = Segment::Protected;
+			b.protectedSize += entry.size;
+			++g_redwoodMetrics.metric.pagerCachePromote;
+
+			// Demote the least recently used protected entries back to probation until the segment fits
+			while (b.protectedSize > b.protectedLimit && &b.protect.front() != &entry) {
+				Entry& demoted = b.protect.front();
+				b.probation.splice(b.probation.end(), b.protect, b.protect.begin());
+				demoted.segment = Segment::Probation;
+				b.protectedSize -= demoted.size;
+				++g_redwoodMetrics.metric.pagerCacheDemote;
+			}
+		}
+	}
+
+	// While the cache is too big, evict from the budget furthest over its limit until an entry can't be evicted.
+	// keep, if not null, is an entry that must not be evicted.
+	void evict(Entry* keep) {
+		while (currentSize > sizeLimit) {
+			Budget* victim = nullptr;
+			for (auto& b : budgets) {
+				if ((!b.probation.empty() || !b.protect.empty()) &&
+				    (victim == nullptr || b.size - b.limit > victim->size - victim->limit)) {
+					victim = &b;
+				}
+			}
+			// Everything left is waiting on the prioritized eviction list
+			if (victim == nullptr) {
+				break;
+			}
+
+			// Evict from probation first.  It's critical that we do not evict the item we just added because it
+			// would cause the reference returned to be invalid.  An eviction could happen with a no-hit access to a
+			// cache resident page that is currently evictable and exists in the oversized portion of the cache
+			// eviction order due to previously failed evictions.
+			EvictionOrderT* order = &victim->probation;
+			if (order->empty() || &order->front() == keep) {
+				order = &victim->protect;
+			}
+			if (order->empty() || &order->front() == keep) {
+				debug_printf("Cannot evict from budget %d without evicting the target index\n",
+				             int(victim - budgets));
+				break;
+			}
+
+			Entry& toEvict = order->front();
+			debug_printf("currentSize is %u. Trying to evict %s\n", currentSize, toString(toEvict.index).c_str());
+
+			if (!toEvict.item.evictable()) {
+				// shift the front to the back
+				order->shift_forward(1);
+				++g_redwoodMetrics.metric.pagerEvictFail;
+				break;
+			} else {
+				if (toEvict.hits == 0) {
+					++g_redwoodMetrics.metric.pagerEvictUnhit;
+				}
+				if (toEvict.segment == Segment::Protected) {
+					++g_redwoodMetrics.metric.pagerEvictProtected;
+				}
+				debug_printf("Evicting %s\n", toString(toEvict.index).c_str());
+				unlink(toEvict);
+				victim->size -= toEvict.size;
+				currentSize -= toEvict.size;
+				cache.erase(toEvict.index);
+			}
+		}
+	}
+
 	int64_t sizeLimit;
 	int64_t currentSize;
+	double protectedFraction;
 	CacheT cache;
-	EvictionOrderT evictionOrder;
+	Budget budgets[budgetCount];
 	EvictionOrderT prioritizedEvictions;
 };
 
@@ -2143,7 +2340,7 @@ public:
 	          int concurrentExtentReads,
 	          bool memoryOnly = false,
 	          Promise<Void> errorPromise = {})
-	  : ioLock(FLOW_KNOBS->MAX_OUTSTANDING, ioMaxPriority, FLOW_KNOBS->MAX_OUTSTANDING / 2),
+	  : physicalPageSize(0), ioLock(FLOW_KNOBS->MAX_OUTSTANDING, ioMaxPriority, FLOW_KNOBS->MAX_OUTSTANDING / 2),
 	    pageCacheBytes(pageCacheSizeBytes), pHeader(nullptr), desiredPageSize(desiredPageSize),
 	    desiredExtentSize(desiredExtentSize), filename(filename), memoryOnly(memoryOnly), errorPromise(errorPromise),
 	    remapCleanupWindow(remapCleanupWindow), concurrentExtentReads(new FlowLock(concurrentExtentReads)) {
@@ -2152,6 +2349,10 @@ public:
 			g_redwoodMetricsActor = redwoodMetricsLogger();
 		}
 
+		pageCache.setBudgets({ 1.0 - SERVER_KNOBS->REDWOOD_PAGE_CACHE_INTERNAL_FRACTION,
+		                       SERVER_KNOBS->REDWOOD_PAGE_CACHE_INTERNAL_FRACTION },
+		                     SERVER_KNOBS->REDWOOD_PAGE_CACHE_PROTECTED_FRACTION);
+
 		commitFuture = Void();
 		recoverFuture = forwardError(recover(this), errorPromise);
 	}
@@ -2170,6 +2371,36 @@ public:
 		pageCache.setSizeLimit(1 + ((pageCacheBytes - 1) / physicalPageSize));
 	}
 
+	// Resize the page cache in place.  Shrinking evicts whatever can be evicted now and the rest as pages become
+	// evictable.  A memory-only pager has nowhere to evict to, so its size is fixed.
+	void setPageCacheSize(int64_t bytes) override {
+		if (memoryOnly || bytes == pageCacheBytes) {
+			return;
+		}
+		TraceEvent("RedwoodPageCacheResize")
+		    .detail("Filename", filename)
+		    .detail("OldBytes", pageCacheBytes)
+		    .detail("NewBytes", bytes);
+		pageCacheBytes = bytes;
+		// Before recovery the page size is unknown; setPageSize() will apply the new size.
+		if (physicalPageSize > 0) {
+			pageCache.setSizeLimit(1 + ((pageCacheBytes - 1) / physicalPageSize));
+		}
+	}
+
+	// Page cache budgets.  BTree levels above 1 are internal pages; leaves, prefetched leaves and non-BTree pages
+	// share the leaf budget.
+	static constexpr int leafPageBudget = 0;
+	static constexpr int internalPageBudget = 1;
+	static int pageCacheBudget(unsigned int level) { return level > 1 ? internalPageBudget : leafPageBudget; }
+
+	// Leaf reads made on behalf of a range read, prefetch or lazy clear should not promote pages into the protected
+	// part of the cache.  Internal pages on the scan path are re-read constantly and are treated normally.
+	static bool isScanRead(PagerEventReasons reason, unsigned int level) {
+		return level <= 1 && (reason == PagerEventReasons::RangeRead || reason == PagerEventReasons::RangePrefetch ||
+		                      reason == PagerEventReasons::LazyClear);
+	}
+
 	void setExtentSize(int size) {
 		// if the specified extent size is smaller than the physical page size, round it off to one physical page size
 		// physical extent size has to be a multiple of physical page size
@@ -2684,7 +2915,7 @@ public:
 		// or as a cache miss because there is no benefit to the page already being in cache
 		// Similarly, this does not count as a point lookup for reason.
 		ASSERT(pageIDs.front() != invalidLogicalPageID);
-		PageCacheEntry& cacheEntry = pageCache.get(pageIDs.front(), pageIDs.size(), true);
+		PageCacheEntry& cacheEntry = pageCache.get(pageIDs.front(), pageIDs.size(), true, false, pageCacheBudget(level));
 		debug_printf("DWALPager(%s) op=write %s cached=%d reading=%d writing=%d\n",
 		             filename.c_str(),
 		             toString(pageIDs).c_str(),
@@ -2721,6 +2952,11 @@ public:
 
 		// Always update the page contents immediately regardless of what happened above.
 		cacheEntry.readFuture = data;
+		if (cacheEntry.decoded.isValid()) {
+			cacheEntry.decoded.clear();
+			pageCache.charge(pageIDs.front(), -cacheEntry.decodedBlocks);
+			cacheEntry.decodedBlocks = 0;
+		}
 	}
 
 	Future<LogicalPageID> atomicUpdatePage(PagerEventReasons reason,
@@ -2998,7 +3234,8 @@ public:
 			debug_printf("DWALPager(%s) op=readUncachedMiss %s\n", filename.c_str(), toString(pageID).c_str());
 			return forwardError(readPhysicalPage(this, pageID, priority, false), errorPromise);
 		}
-		PageCacheEntry& cacheEntry = pageCache.get(pageID, 1, noHit);
+		PageCacheEntry& cacheEntry =
+		    pageCache.get(pageID, 1, noHit, isScanRead(reason, level), pageCacheBudget(level));
 		debug_printf("DWALPager(%s) op=read %s cached=%d reading=%d writing=%d noHit=%d\n",
 		             filename.c_str(),
 		             toString(pageID).c_str(),
@@ -3044,7 +3281,8 @@ public:
 			return forwardError(readPhysicalMultiPage(this, pageIDs, priority), errorPromise);
 		}
 
-		PageCacheEntry& cacheEntry = pageCache.get(pageIDs.front(), pageIDs.size(), noHit);
+		PageCacheEntry& cacheEntry =
+		    pageCache.get(pageIDs.front(), pageIDs.size(), noHit, isScanRead(reason, level), pageCacheBudget(level));
 		debug_printf("DWALPager(%s) op=read %s cached=%d reading=%d writing=%d noHit=%d\n",
 		             filename.c_str(),
 		             toString(pageIDs).c_str(),
@@ -3124,6 +3362,31 @@ public:
 		return readMultiPage(reason, level, ids, priority, cacheable, noHit);
 	}
 
+	// Returns the decoded form of page, read at version v as the page at logicalID, making it with decode() unless the
+	// page cache already has it.  If page is the cached page for logicalID its decoded form is kept with it, and the
+	// cache entry is charged for the blocks of both until the page is evicted or replaced.
+	Reference<const ArenaPage> getDecodedPage(LogicalPageID logicalID,
+	                                          Version v,
+	                                          Reference<const ArenaPage> const& page,
+	                                          std::function<Reference<const ArenaPage>()> const& decode) {
+		PhysicalPageID physicalID = getPhysicalPageID(logicalID, v);
+		// A memory-only pager can't evict to make room for it
+		PageCacheEntry* pCacheEntry = memoryOnly ? nullptr : pageCache.peek(physicalID);
+		bool cached = pCacheEntry != nullptr && pCacheEntry->holds(page.getPtr());
+		if (cached && pCacheEntry->decoded.isValid()) {
+			return pCacheEntry->decoded;
+		}
+
+		Reference<const ArenaPage> decoded = decode();
+		if (cached) {
+			int blocks = (decoded->size() + sizeof(ArenaPage::Checksum) + logicalPageSize - 1) / logicalPageSize;
+			pCacheEntry->decoded = decoded;
+			pCacheEntry->decodedBlocks = blocks;
+			pageCache.charge(physicalID, blocks);
+		}
+		return decoded;
+	}
+
 	void releaseExtentReadLock() override { concurrentExtentReads->release(); }
 
 	// Read the physical extent at given pageID
@@ -3779,9 +4042,16 @@ private:
 	struct PageCacheEntry {
 		Future<Reference<ArenaPage>> readFuture;
 		Future<Void> writeFuture;
+		// The decoded form of the page in readFuture, if one has been made for it, which the entry is also charged for
+		Reference<const ArenaPage> decoded;
+		int decodedBlocks = 0;
 
 		bool initialized() const { return readFuture.isValid(); }
 
+		bool holds(const ArenaPage* page) const {
+			return readFuture.isReady() && !readFuture.isError() && readFuture.get().getPtr() == page;
+		}
+
 		bool reading() const { return !readFuture.isReady(); }
 
 		bool writing() const { return !writeFuture.isReady(); }
@@ -3933,6 +4203,12 @@ public:
 		           [=](Reference<ArenaPage> p) { return Reference<const ArenaPage>(std::move(p)); });
 	}
 
+	Reference<const ArenaPage> getDecodedPage(LogicalPageID pageID,
+	                                          Reference<const ArenaPage> const& page,
+	                                          std::function<Reference<const ArenaPage>()> const& decode) override {
+		return pager->getDecodedPage(pageID, version, page, decode);
+	}
+
 	Key getMetaKey() const override { return metaKey; }
 
 	Version getVersion() const override { return version; }
@@ -4549,6 +4825,26 @@ struct BTreePage {
 	};
 #pragma pack(pop)
 
+	// A BTreePage can be stored on disk in a compressed form which begins with a Compressed header.
+	// The header's first byte overlaps height and has compressedFlag set so the two forms can be told apart.
+	static constexpr uint8_t compressedFlag = 0x80;
+
+	enum class Codec : uint8_t { None = 0, LZ4 = 1, LZ4HC = 2, MAX };
+
+#pragma pack(push, 1)
+	struct Compressed {
+		uint8_t height;
+		Codec codec;
+		// Number of pager blocks and bytes needed to hold the decoded BTreePage
+		uint32_t decodedBlocks;
+		uint32_t decodedSize;
+		uint32_t compressedSize;
+
+		uint8_t* data() { return (uint8_t*)(this + 1); }
+		const uint8_t* data() const { return (const uint8_t*)(this + 1); }
+	};
+#pragma pack(pop)
+
 	int size() const {
 		const BinaryTree* t = tree();
 		return (uint8_t*)t - (uint8_t*)this + t->size();
@@ -4556,6 +4852,8 @@ struct BTreePage {
 
 	bool isLeaf() const { return height == 1; }
 
+	bool isCompressed() const { return (height & compressedFlag) != 0; }
+
 	BinaryTree* tree() { return (BinaryTree*)(this + 1); }
 
 	BinaryTree* tree() const { return (BinaryTree*)(this + 1); }
@@ -4630,6 +4928,62 @@ static void makeEmptyRoot(Reference<ArenaPage> page) {
 	btpage->tree()->build(page->size(), nullptr, nullptr, nullptr, nullptr);
 }
 
+// Returns true if pages can be compressed with codec in this build
+static bool compressionCodecAvailable(BTreePage::Codec codec) {
+	switch (codec) {
+#ifdef REDWOOD_LZ4
+	case BTreePage::Codec::LZ4:
+	case BTreePage::Codec::LZ4HC:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+static const char* compressionCodecName(BTreePage::Codec codec) {
+	switch (codec) {
+	case BTreePage::Codec::None:
+		return "None";
+	case BTreePage::Codec::LZ4:
+		return "LZ4";
+	case BTreePage::Codec::LZ4HC:
+		return "LZ4HC";
+	default:
+		return "Unknown";
+	}
+}
+
+// Compresses srcSize bytes at src into dst with codec, which must be available.
+// Returns the compressed size, or 0 if the output would not fit in dstCapacity bytes.
+static int compressBytes(BTreePage::Codec codec, const uint8_t* src, int srcSize, uint8_t* dst, int dstCapacity) {
+	switch (codec) {
+#ifdef REDWOOD_LZ4
+	case BTreePage::Codec::LZ4:
+		return LZ4_compress_default((const char*)src, (char*)dst, srcSize, dstCapacity);
+	case BTreePage::Codec::LZ4HC:
+		return LZ4_compress_HC((const char*)src, (char*)dst, srcSize, dstCapacity, LZ4HC_CLEVEL_DEFAULT);
+#endif
+	default:
+		UNREACHABLE();
+	}
+}
+
+// Decompresses srcSize bytes at src into dst with codec.
+// Returns the decompressed size, or a negative number if the codec is not available in this build, the input is
+// malformed, or the output would not fit in dstCapacity bytes.
+static int decompressBytes(BTreePage::Codec codec, const uint8_t* src, int srcSize, uint8_t* dst, int dstCapacity) {
+	switch (codec) {
+#ifdef REDWOOD_LZ4
+	case BTreePage::Codec::LZ4:
+	case BTreePage::Codec::LZ4HC:
+		return LZ4_decompress_safe((const char*)src, (char*)dst, srcSize, dstCapacity);
+#endif
+	default:
+		return -1;
+	}
+}
+
 struct BoundaryRefAndPage {
 	Standalone<RedwoodRecordRef> lowerBound;
 	Reference<ArenaPage> firstPage;
@@ -4739,7 +5093,11 @@ public:
 
 #pragma pack(push, 1)
 	struct MetaKey {
-		static constexpr int FORMAT_VERSION = 15;
+		// Trees that may contain compressed leaf pages.  A tree is only moved to this version when a compressed
+		// page is first written, so that a tree which never had compression enabled can still be opened by binaries
+		// that only know UNCOMPRESSED_FORMAT_VERSION.
+		static constexpr int FORMAT_VERSION = 16;
+		static constexpr int UNCOMPRESSED_FORMAT_VERSION = 15;
 		// This serves as the format version for the entire tree, individual pages will not be versioned
 		uint16_t formatVersion;
 		uint8_t height;
@@ -4750,7 +5108,7 @@ public:
 
 		void fromKeyRef(KeyRef k) {
 			memcpy(this, k.begin(), k.size());
-			ASSERT(formatVersion == FORMAT_VERSION);
+			ASSERT(formatVersion == FORMAT_VERSION || formatVersion == UNCOMPRESSED_FORMAT_VERSION);
 		}
 
 		std::string toString() {
@@ -4821,7 +5179,20 @@ public:
 	Version getLastCommittedVersion() const { return m_pager->getLastCommittedVersion(); }
 
 	VersionedBTree(IPager2* pager, std::string name)
-	  : m_pager(pager), m_pBuffer(nullptr), m_mutationCount(0), m_name(name), m_pHeader(nullptr), m_headerSpace(0) {
+	  : m_pager(pager), m_pBuffer(nullptr), m_mutationCount(0), m_name(name),
+	    m_compressionCodec((BTreePage::Codec)SERVER_KNOBS->REDWOOD_PAGE_COMPRESSION),
+	    m_compressedLeafBlocks(std::max(1, SERVER_KNOBS->REDWOOD_COMPRESSED_LEAF_BLOCKS)), m_pHeader(nullptr),
+	    m_headerSpace(0) {
+
+		if (m_compressionCodec != BTreePage::Codec::None && !compressionCodecAvailable(m_compressionCodec)) {
+			TraceEvent(SevWarnAlways, "RedwoodCompressionCodecUnavailable")
+			    .detail("FileName", name)
+			    .detail("Codec", SERVER_KNOBS->REDWOOD_PAGE_COMPRESSION);
+			m_compressionCodec = BTreePage::Codec::None;
+		}
+		if (m_compressionCodec == BTreePage::Codec::None) {
+			m_compressedLeafBlocks = 1;
+		}
 
 		m_lazyClearActor = 0;
 		m_init = init_impl(this);
@@ -4857,7 +5228,8 @@ public:
 
 				// Start reading the page, without caching
 				entries.emplace_back(q.get(),
-				                     self->readPage(PagerEventReasons::LazyClear,
+				                     self->readPage(self,
+				                                    PagerEventReasons::LazyClear,
 				                                    q.get().height,
 				                                    snapshot,
 				                                    q.get().pageID,
@@ -4951,7 +5323,7 @@ public:
 		state Key meta = self->m_pager->getMetaKey();
 		if (meta.size() == 0) {
 			// Create new BTree
-			self->m_pHeader->formatVersion = MetaKey::FORMAT_VERSION;
+			self->m_pHeader->formatVersion = MetaKey::UNCOMPRESSED_FORMAT_VERSION;
 			LogicalPageID id = wait(self->m_pager->newPageID());
 			BTreePageIDRef newRoot((LogicalPageID*)&id, 1);
 			debug_printf("new root %s\n", toString(newRoot).c_str());
@@ -4979,6 +5351,7 @@ public:
 		TraceEvent e(SevInfo, "RedwoodRecoveredBTree");
 		e.detail("FileName", self->m_name);
 		e.detail("OpenedExisting", meta.size() != 0);
+		e.detail("Compression", compressionCodecName(self->m_compressionCodec));
 		e.detail("LatestVersion", self->m_pager->getLastCommittedVersion());
 		self->m_lazyClearQueue.toTraceEvent(e, "LazyClearQueue");
 		e.log();
@@ -5280,6 +5653,10 @@ private:
 	Future<Void> m_init;
 	std::string m_name;
 	int m_blockSize;
+	// Codec used to compress leaf pages as they are written, and the number of blocks of uncompressed data that
+	// leaf pages are built to hold when compression is enabled.
+	BTreePage::Codec m_compressionCodec;
+	int m_compressedLeafBlocks;
 	ParentInfoMapT childUpdateTracker;
 
 	// MetaKey has a variable size, it can be as large as m_headerSpace
@@ -5491,8 +5868,11 @@ private:
 		// All records share the prefix shared by the lower and upper boundaries
 		state int prefixLen = lowerBound->getCommonPrefixLen(*upperBound);
 
+		// When leaf compression is enabled, leaves are built to hold several blocks of data so that compressing them
+		// can save whole blocks.
+		int buildBlockSize = self->m_blockSize * (height == 1 ? self->m_compressedLeafBlocks : 1);
 		state std::vector<PageToBuild> pagesToBuild =
-		    splitPages(lowerBound, upperBound, prefixLen, entries, height, self->m_blockSize);
+		    splitPages(lowerBound, upperBound, prefixLen, entries, height, buildBlockSize);
 		debug_printf("splitPages returning %s\n", toString(pagesToBuild).c_str());
 
 		// Lower bound of the page being added to
@@ -5545,14 +5925,16 @@ private:
 			}
 
 			state Reference<ArenaPage> pages;
+			// Number of pager blocks the page will be written to
+			state int blockCount = p.pageSize / self->m_blockSize;
 			BTreePage* btPage;
 
-			if (p.blockCount == 1) {
+			if (blockCount == 1) {
 				Reference<ArenaPage> page = self->m_pager->newPageBuffer();
 				btPage = (BTreePage*)page->mutate();
 				pages = std::move(page);
 			} else {
-				ASSERT(p.blockCount > 1);
+				ASSERT(blockCount > 1);
 				btPage = (BTreePage*)new uint8_t[p.pageSize];
 			}
 
@@ -5579,35 +5961,37 @@ private:
 				    .detail("BytesWritten", written);
 				ASSERT(false);
 			}
-			auto& metrics = g_redwoodMetrics.level(height);
-			metrics.metrics.pageBuild += 1;
-			metrics.metrics.pageBuildExt += p.blockCount - 1;
-
-			metrics.buildFillPctSketch->samplePercentage(p.usedFraction());
-			metrics.buildStoredPctSketch->samplePercentage(p.kvFraction());
-			metrics.buildItemCountSketch->sampleRecordCounter(p.count);
-
 			// Create chunked pages
 			// TODO: Avoid copying page bytes, but this is not trivial due to how pager checksums are currently handled.
-			if (p.blockCount != 1) {
+			if (blockCount != 1) {
 				// Mark the slack in the page buffer as defined
-				VALGRIND_MAKE_MEM_DEFINED(((uint8_t*)btPage) + written, (p.blockCount * p.blockSize) - written);
-				Reference<ArenaPage> page = self->m_pager->newPageBuffer(p.blockCount);
+				VALGRIND_MAKE_MEM_DEFINED(((uint8_t*)btPage) + written, p.pageSize - written);
+				Reference<ArenaPage> page = self->m_pager->newPageBuffer(blockCount);
 				const uint8_t* rptr = (const uint8_t*)btPage;
-				for (int b = 0; b < p.blockCount; ++b) {
-					memcpy(page->mutate() + b * p.blockSize, rptr, p.blockSize);
-					rptr += p.blockSize;
+				for (int b = 0; b < blockCount; ++b) {
+					memcpy(page->mutate() + b * self->m_blockSize, rptr, self->m_blockSize);
+					rptr += self->m_blockSize;
 				}
 				pages = std::move(page);
 				delete[](uint8_t*) btPage;
 			}
 
+			self->compressPage(pages, blockCount);
+
+			auto& metrics = g_redwoodMetrics.level(height);
+			metrics.metrics.pageBuild += 1;
+			metrics.metrics.pageBuildExt += blockCount - 1;
+
+			metrics.buildFillPctSketch->samplePercentage(p.usedFraction());
+			metrics.buildStoredPctSketch->samplePercentage(p.kvFraction());
+			metrics.buildItemCountSketch->sampleRecordCounter(p.count);
+
 			// Write this btree page, which is made of 1 or more pager pages.
 			state BTreePageIDRef childPageID;
 
 			// If we are only writing 1 BTree node and its block count is 1 and the original node also had 1 block
 			// then try to update the page atomically so its logical page ID does not change
-			if (pagesToBuild.size() == 1 && p.blockCount == 1 && previousID.size() == 1) {
+			if (pagesToBuild.size() == 1 && blockCount == 1 && previousID.size() == 1) {
 				LogicalPageID id = wait(
 				    self->m_pager->atomicUpdatePage(PagerEventReasons::Commit, height, previousID.front(), pages, v));
 				childPageID.push_back(records.arena(), id);
@@ -5625,7 +6009,7 @@ private:
 				}
 
 				state Standalone<VectorRef<LogicalPageID>> emptyPages;
-				emptyPages.resize(emptyPages.arena(), p.blockCount);
+				emptyPages.resize(emptyPages.arena(), blockCount);
 				state int i = 0;
 				for (i = 0; i < emptyPages.size(); ++i) {
 					LogicalPageID id = wait(self->m_pager->newPageID());
@@ -5694,7 +6078,8 @@ private:
 		return records;
 	}
 
-	ACTOR static Future<Reference<const ArenaPage>> readPage(PagerEventReasons reason,
+	ACTOR static Future<Reference<const ArenaPage>> readPage(VersionedBTree* self,
+	                                                         PagerEventReasons reason,
 	                                                         unsigned int level,
 	                                                         Reference<IPagerSnapshot> snapshot,
 	                                                         BTreePageIDRef id,
@@ -5719,6 +6104,7 @@ private:
 			page = std::move(p);
 		}
 		debug_printf("readPage() op=readComplete %s @%" PRId64 " \n", toString(id).c_str(), snapshot->getVersion());
+		page = self->decompressPage(snapshot, page, id);
 		const BTreePage* btPage = (const BTreePage*)page->begin();
 		auto& metrics = g_redwoodMetrics.level(btPage->height).metrics;
 		metrics.pageRead += 1;
@@ -5769,6 +6155,103 @@ private:
 		}
 	}
 
+	// If compression is enabled and page is a leaf of blockCount blocks, try to encode it in fewer blocks.
+	// On success page is replaced with its compressed form and blockCount is updated.
+	void compressPage(Reference<ArenaPage>& page, int& blockCount) {
+		const BTreePage* btPage = (const BTreePage*)page->begin();
+		if (m_compressionCodec == BTreePage::Codec::None || !btPage->isLeaf() || blockCount < 2) {
+			return;
+		}
+
+		double startTime = timer_monotonic();
+		int decodedSize = btPage->size();
+		int logicalPageSize = m_pager->getLogicalPageSize();
+
+		// The compressed page must fit in at most blockCount - 1 blocks to be worth writing
+		int capacity = (blockCount - 1) * logicalPageSize - sizeof(ArenaPage::Checksum) - sizeof(BTreePage::Compressed);
+		Arena arena;
+		uint8_t* buffer = new (arena) uint8_t[capacity];
+		int compressedSize = compressBytes(m_compressionCodec, page->begin(), decodedSize, buffer, capacity);
+
+		auto& metric = g_redwoodMetrics.metric;
+		if (compressedSize <= 0) {
+			++metric.btreeLeafCompressSkip;
+			metric.btreeLeafCompressMicros += (timer_monotonic() - startTime) * 1e6;
+			return;
+		}
+
+		int encodedSize = sizeof(BTreePage::Compressed) + compressedSize + sizeof(ArenaPage::Checksum);
+		int encodedBlocks = (encodedSize + logicalPageSize - 1) / logicalPageSize;
+		Reference<ArenaPage> encoded = m_pager->newPageBuffer(encodedBlocks);
+		BTreePage::Compressed* header = (BTreePage::Compressed*)encoded->mutate();
+		header->height = btPage->height | BTreePage::compressedFlag;
+		header->codec = m_compressionCodec;
+		header->decodedBlocks = blockCount;
+		header->decodedSize = decodedSize;
+		header->compressedSize = compressedSize;
+		memcpy(header->data(), buffer, compressedSize);
+		VALGRIND_MAKE_MEM_DEFINED(header->data() + compressedSize,
+		                          encoded->size() - sizeof(BTreePage::Compressed) - compressedSize);
+
+		++metric.btreeLeafCompress;
+		metric.btreeLeafCompressBytesIn += decodedSize;
+		metric.btreeLeafCompressBytesOut += compressedSize;
+		metric.btreeLeafCompressMicros += (timer_monotonic() - startTime) * 1e6;
+
+		page = encoded;
+		blockCount = encodedBlocks;
+
+		// The header is written with the next commit, which includes this page
+		m_pHeader->formatVersion = MetaKey::FORMAT_VERSION;
+	}
+
+	// Returns the uncompressed form of page, read from snapshot as id, which is page itself unless it is a compressed
+	// BTreePage.  The pager keeps the uncompressed form of a cached page with it, charged to the page cache, so later
+	// reads of the same cached page share it.
+	Reference<const ArenaPage> decompressPage(Reference<IPagerSnapshot> const& snapshot,
+	                                          Reference<const ArenaPage> const& page,
+	                                          BTreePageIDRef id) const {
+		if (!((const BTreePage*)page->begin())->isCompressed()) {
+			return page;
+		}
+		return snapshot->getDecodedPage(id.front(), page, [&]() { return decodePage(*page, id); });
+	}
+
+	Reference<const ArenaPage> decodePage(const ArenaPage& page, BTreePageIDRef id) const {
+		const BTreePage::Compressed* header = (const BTreePage::Compressed*)page.begin();
+		double startTime = timer_monotonic();
+		Reference<ArenaPage> decoded = m_pager->newPageBuffer(header->decodedBlocks);
+		int compressedSize = header->compressedSize;
+		int expectedSize = header->decodedSize;
+		int decodedSize = -1;
+		if (compressedSize <= page.size() - (int)sizeof(BTreePage::Compressed) && expectedSize <= decoded->size()) {
+			decodedSize =
+			    decompressBytes(header->codec, header->data(), compressedSize, decoded->mutate(), expectedSize);
+		}
+
+		if (decodedSize != expectedSize) {
+			TraceEvent(SevError, "RedwoodPageDecompressFailed")
+			    .detail("Filename", m_name)
+			    .detail("PageID", ::toString(id))
+			    .detail("Codec", compressionCodecName(header->codec))
+			    .detail("CompressedSize", header->compressedSize)
+			    .detail("DecodedSize", header->decodedSize)
+			    .detail("Result", decodedSize);
+			throw checksum_failed();
+		}
+
+		auto& metric = g_redwoodMetrics.metric;
+		++metric.btreeLeafDecompress;
+		metric.btreeLeafDecompressMicros += (timer_monotonic() - startTime) * 1e6;
+
+		return decoded;
+	}
+
+	// Returns the capacity in bytes of the uncompressed BTreePage in page
+	int pageCapacity(const ArenaPage& page) const {
+		return (page.size() + sizeof(ArenaPage::Checksum)) / m_pager->getLogicalPageSize() * m_blockSize;
+	}
+
 	void freeBTreePage(BTreePageIDRef btPageID, Version v) {
 		// Free individual pages at v
 		for (LogicalPageID id : btPageID) {
@@ -5785,7 +6268,6 @@ private:
 	                                                    Reference<ArenaPage> page,
 	                                                    Version writeVersion) {
 		state BTreePageIDRef newID;
-		newID.resize(*arena, oldID.size());
 
 		if (REDWOOD_DEBUG) {
 			BTreePage* btPage = (BTreePage*)page->begin();
@@ -5800,7 +6282,13 @@ private:
 		}
 
 		state unsigned int height = (unsigned int)((BTreePage*)page->begin())->height;
-		if (oldID.size() == 1) {
+
+		// The page is uncompressed here, so if it was stored compressed its block count can differ from oldID's
+		state int blockCount = self->pageCapacity(*page) / self->m_blockSize;
+		self->compressPage(page, blockCount);
+		newID.resize(*arena, blockCount);
+
+		if (oldID.size() == 1 && blockCount == 1) {
 			LogicalPageID id = wait(
 			    self->m_pager->atomicUpdatePage(PagerEventReasons::Commit, height, oldID.front(), page, writeVersion));
 			newID.front() = id;
@@ -5808,8 +6296,8 @@ private:
 		}
 		state Standalone<VectorRef<LogicalPageID>> emptyPages;
 		state int i = 0;
-		emptyPages.resize(emptyPages.arena(), oldID.size());
-		for (i = 0; i < oldID.size(); ++i) {
+		emptyPages.resize(emptyPages.arena(), blockCount);
+		for (i = 0; i < blockCount; ++i) {
 			LogicalPageID id = wait(self->m_pager->newPageID());
 			emptyPages[i] = id;
 		}
@@ -6169,7 +6657,7 @@ private:
 		}
 
 		state Reference<const ArenaPage> page =
-		    wait(readPage(PagerEventReasons::Commit, height, batch->snapshot, rootID, height, false, true));
+		    wait(readPage(self, PagerEventReasons::Commit, height, batch->snapshot, rootID, height, false, true));
 
 		// If the page exists in the cache, it must be copied before modification.
 		// That copy will be referenced by pageCopy, as page must stay in scope in case anything references its
@@ -6475,7 +6963,7 @@ private:
 					BTreePageIDRef newID = wait(self->updateBTreePage(
 					    self, rootID, &update->newLinks.arena(), pageCopy.castTo<ArenaPage>(), batch->writeVersion));
 
-					update->updatedInPlace(newID, btPage, newID.size() * self->m_blockSize);
+					update->updatedInPlace(newID, btPage, self->pageCapacity(*pageCopy));
 					debug_printf(
 					    "%s Page updated in-place, returning %s\n", context.c_str(), toString(*update).c_str());
 				}
@@ -7044,7 +7532,8 @@ public:
 
 		Future<Void> pushPage(const BTreePage::BinaryTree::Cursor& link) {
 			debug_printf("pushPage(link=%s)\n", link.get().toString(false).c_str());
-			return map(readPage(reason,
+			return map(readPage(btree,
+			                    reason,
 			                    path.back().btPage()->height - 1,
 			                    pager,
 			                    link.get().getChildPage(),
@@ -7063,7 +7552,7 @@ public:
 
 		Future<Void> pushPage(BTreePageIDRef id) {
 			debug_printf("pushPage(root=%s)\n", ::toString(id).c_str());
-			return map(readPage(reason, btree->m_pHeader->height, pager, id, ioMaxPriority, false, true),
+			return map(readPage(btree, reason, btree->m_pHeader->height, pager, id, ioMaxPriority, false, true),
 			           [=](Reference<const ArenaPage> p) {
 #if REDWOOD_DEBUG
 				           path.push_back({ p, getCursor(p, dbBegin, dbEnd), id });
@@ -7097,9 +7586,11 @@ public:
 		//     If there is a record in the tree > query then moveNext() will move to it.
 		// If non-zero is returned then the cursor is valid and the return value is logically equivalent
 		// to query.compare(cursor.get())
-		ACTOR Future<int> seek_impl(BTreeCursor* self, RedwoodRecordRef query) {
+		// If reusePath is true, the seek starts from the deepest page already in the path that query would
+		// descend through, rather than from the root.
+		ACTOR Future<int> seek_impl(BTreeCursor* self, RedwoodRecordRef query, bool reusePath) {
 			state RedwoodRecordRef internalPageQuery = query.withMaxPageID();
-			self->path.resize(1);
+			self->path.resize(reusePath ? self->reusablePathLength(internalPageQuery) : 1);
 			debug_printf("seek(%s) start cursor = %s\n", query.toString().c_str(), self->toString().c_str());
 
 			loop {
@@ -7132,18 +7623,40 @@ public:
 			}
 		}
 
-		Future<int> seek(RedwoodRecordRef query) { return path.empty() ? 0 : seek_impl(this, query); }
+		// Returns how many entries at the front of the path a seek to internalPageQuery would push again.  An
+		// internal page's child can be kept if the page's cursor is on the link that seekLessThan() would choose.
+		int reusablePathLength(const RedwoodRecordRef& internalPageQuery) const {
+			int length = 1;
+			for (int i = 0; i + 1 < path.size(); ++i) {
+				auto const& c = path[i].cursor;
+				if (!c.valid() || c.isErased() || !c.get().value.present() || !(c.get() < internalPageQuery)) {
+					break;
+				}
+				auto next = c.next();
+				if (next.valid() && next.get() < internalPageQuery) {
+					break;
+				}
+				length = i + 2;
+			}
+			return length;
+		}
+
+		Future<int> seek(RedwoodRecordRef query, bool reusePath = false) {
+			return path.empty() ? 0 : seek_impl(this, query, reusePath);
+		}
 
-		ACTOR Future<Void> seekGTE_impl(BTreeCursor* self, RedwoodRecordRef query) {
+		ACTOR Future<Void> seekGTE_impl(BTreeCursor* self, RedwoodRecordRef query, bool reusePath) {
 			debug_printf("seekGTE(%s) start\n", query.toString().c_str());
-			int cmp = wait(self->seek(query));
+			int cmp = wait(self->seek(query, reusePath));
 			if (cmp > 0 || (cmp == 0 && !self->isValid())) {
 				wait(self->moveNext());
 			}
 			return Void();
 		}
 
-		Future<Void> seekGTE(RedwoodRecordRef query) { return seekGTE_impl(this, query); }
+		Future<Void> seekGTE(RedwoodRecordRef query, bool reusePath = false) {
+			return seekGTE_impl(this, query, reusePath);
+		}
 
 		// Start fetching sibling nodes in the forward or backward direction, stopping after recordLimit or byteLimit
 		void prefetch(KeyRef rangeEnd, bool directionForward, int recordLimit, int byteLimit) {
@@ -7316,6 +7829,7 @@ public:
 		                               SERVER_KNOBS->REDWOOD_EXTENT_CONCURRENT_READS,
 		                               false,
 		                               m_error);
+		m_pager = pager;
 		m_tree = new VersionedBTree(pager, filePrefix);
 		m_init = catchError(init_impl(this));
 	}
@@ -7356,6 +7870,14 @@ public:
 	Future<Void> onClosed() const override { return m_closed.getFuture(); }
 
 	Future<Void> commit(bool sequential = false) override {
+		// Pick up page cache size changes made at runtime
+		if (!g_network->isSimulated()) {
+			m_pager->setPageCacheSize(FLOW_KNOBS->PAGE_CACHE_4K);
+		} else if (BUGGIFY_WITH_PROB(0.001)) {
+			m_pager->setPageCacheSize(
+			    deterministicRandom()->randomInt(m_pager->getPhysicalPageSize(), FLOW_KNOBS->BUGGIFY_SIM_PAGE_CACHE_4K));
+		}
+
 		Future<Void> c = m_tree->commit(m_nextCommitVersion);
 		// Currently not keeping history
 		m_tree->setOldestReadableVersion(m_nextCommitVersion);
@@ -7562,11 +8084,71 @@ public:
 		}));
 	}
 
+	// Reads a chunk of the keys in order with one cursor, so that each seek only reads the pages below where the path to
+	// the previous key diverges.
+	ACTOR static Future<std::vector<Optional<Value>>> readValuePrefixes_impl(
+	    KeyValueStoreRedwood* self,
+	    Standalone<VectorRef<KeyRef>> keys,
+	    std::vector<int> maxLengths,
+	    Optional<UID> debugID) {
+		state VersionedBTree::BTreeCursor cur;
+		wait(
+		    self->m_tree->initBTreeCursor(&cur, self->m_tree->getLastCommittedVersion(), PagerEventReasons::PointRead));
+
+		state std::vector<Optional<Value>> result;
+		result.reserve(keys.size());
+		state int i = 0;
+		for (; i < keys.size(); ++i) {
+			++g_redwoodMetrics.metric.opGet;
+			wait(cur.seekGTE(keys[i], true));
+			if (cur.isValid() && cur.get().key == keys[i]) {
+				Value v;
+				v.arena().dependsOn(cur.back().page->getArena());
+				v.contents() = cur.get().value.get();
+				if (v.size() > maxLengths[i]) {
+					v.contents() = v.substr(0, maxLengths[i]);
+				}
+				g_redwoodMetrics.kvSizeReadByGet->sample(cur.get().kvBytes());
+				result.push_back(v);
+			} else {
+				result.push_back(Optional<Value>());
+			}
+		}
+		return result;
+	}
+
+	Future<std::vector<Optional<Value>>> readValuePrefixes(std::vector<std::pair<KeyRef, int>> const& keys,
+	                                                       IKeyValueStore::ReadType,
+	                                                       Optional<UID> debugID) override {
+		// Chunks of the batch are read concurrently, each with its own cursor
+		std::vector<Future<std::vector<Optional<Value>>>> chunks;
+		for (int begin = 0; begin < keys.size(); begin += SERVER_KNOBS->REDWOOD_KVSTORE_BATCH_READ_KEYS) {
+			int end = std::min<int>(begin + SERVER_KNOBS->REDWOOD_KVSTORE_BATCH_READ_KEYS, keys.size());
+			Standalone<VectorRef<KeyRef>> keyCopies;
+			std::vector<int> maxLengths;
+			keyCopies.reserve(keyCopies.arena(), end - begin);
+			maxLengths.reserve(end - begin);
+			for (int i = begin; i < end; i++) {
+				keyCopies.push_back_deep(keyCopies.arena(), keys[i].first);
+				maxLengths.push_back(keys[i].second);
+			}
+			chunks.push_back(readValuePrefixes_impl(this, keyCopies, maxLengths, debugID));
+		}
+		return catchError(map(getAll(chunks), [](std::vector<std::vector<Optional<Value>>> const& results) {
+			std::vector<Optional<Value>> values;
+			for (auto const& result : results) {
+				values.insert(values.end(), result.begin(), result.end());
+			}
+			return values;
+		}));
+	}
+
 	~KeyValueStoreRedwood() override{};
 
 private:
 	std::string m_filename;
 	VersionedBTree* m_tree;
+	IPager2* m_pager; // Owned by m_tree
 	Future<Void> m_init;
 	Promise<Void> m_closed;
 	Promise<Void> m_error;
@@ -8219,6 +8801,99 @@ TEST_CASE("/redwood/correctness/unit/RedwoodRecordRef") {
 	return Void();
 }
 
+struct TestCacheItem {
+	bool pinned = false;
+	bool evictable() const { return !pinned; }
+	Future<Void> onEvictable() const { return Void(); }
+};
+
+TEST_CASE("/redwood/correctness/unit/ObjectCache") {
+	state ObjectCache<int, TestCacheItem> cache;
+	cache.setBudgets({ 0.75, 0.25 }, 0.5);
+	cache.setSizeLimit(100);
+
+	// A hot set read twice is promoted, and internal entries have their own budget
+	for (int r = 0; r < 2; ++r) {
+		for (int i = 0; i < 30; ++i) {
+			cache.get(i, 1);
+		}
+	}
+	for (int i = 5000; i < 5020; ++i) {
+		cache.get(i, 1, false, false, 1);
+	}
+
+	// A scan many times larger than the cache, touching each page repeatedly, evicts neither
+	for (int r = 0; r < 3; ++r) {
+		for (int i = 1000; i < 3000; ++i) {
+			cache.get(i, 1, false, true);
+		}
+	}
+	for (int i = 0; i < 30; ++i) {
+		ASSERT(cache.getIfExists(i) != nullptr);
+	}
+	for (int i = 5000; i < 5020; ++i) {
+		ASSERT(cache.getIfExists(i) != nullptr);
+	}
+	ASSERT(cache.count() == 100);
+
+	// Shrinking evicts immediately, but never an entry that is not evictable
+	cache.get(7, 1).pinned = true;
+	cache.setSizeLimit(10);
+	ASSERT(cache.count() <= 10);
+	ASSERT(cache.getIfExists(7) != nullptr);
+	cache.get(7, 1).pinned = false;
+
+	wait(cache.clear());
+	ASSERT(cache.count() == 0);
+
+	return Void();
+}
+
+TEST_CASE("/redwood/correctness/unit/pageCompression") {
+	for (int c = 1; c < (int)BTreePage::Codec::MAX; ++c) {
+		BTreePage::Codec codec = (BTreePage::Codec)c;
+		if (!compressionCodecAvailable(codec)) {
+			continue;
+		}
+
+		for (int i = 0; i < 100; ++i) {
+			// Repetitive input that is more compressible the smaller the alphabet is
+			int size = deterministicRandom()->randomInt(1, 32768);
+			int alphabet = deterministicRandom()->randomInt(1, 256);
+			std::string input;
+			while ((int)input.size() < size) {
+				char ch = (char)deterministicRandom()->randomInt(0, alphabet);
+				input.append(deterministicRandom()->randomInt(1, 20), ch);
+			}
+			input.resize(size);
+
+			std::string compressed(size, '\0');
+			int compressedSize =
+			    compressBytes(codec, (const uint8_t*)input.data(), size, (uint8_t*)compressed.data(), size);
+			ASSERT(compressedSize >= 0 && compressedSize <= size);
+			if (compressedSize == 0) {
+				continue;
+			}
+
+			std::string output(size, '\0');
+			int decodedSize = decompressBytes(
+			    codec, (const uint8_t*)compressed.data(), compressedSize, (uint8_t*)output.data(), size);
+			ASSERT(decodedSize == size);
+			ASSERT(input == output);
+
+			// Decoding into a buffer that is too small must fail rather than overflow
+			if (size > 1) {
+				decodedSize = decompressBytes(
+				    codec, (const uint8_t*)compressed.data(), compressedSize, (uint8_t*)output.data(), size - 1);
+				ASSERT(decodedSize < 0);
+			}
+		}
+	}
+
+	ASSERT(decompressBytes(BTreePage::Codec::MAX, nullptr, 0, nullptr, 0) < 0);
+	return Void();
+}
+
 TEST_CASE("Lredwood/correctness/unit/deltaTree/RedwoodRecordRef") {
 	// Sanity check on delta tree node format
 	ASSERT(DeltaTree2<RedwoodRecordRef>::Node::headerSize(false) == 4);
@@ -10303,6 +10978,71 @@ Future<Void> closeKVS(IKeyValueStore* kvs) {
 	return closed;
 }
 
+// Compares batched reads, whose cursors reuse the path from one key to the next, with a readValuePrefix() of each key
+TEST_CASE("/redwood/correctness/unit/readValuePrefixes") {
+	state std::string fileName = params.get("fileName").orDefault("unittest.redwood-v1");
+	state int keyCount = params.getInt("keyCount").orDefault(20000);
+	state int rounds = params.getInt("rounds").orDefault(100);
+
+	deleteFile(fileName);
+	state IKeyValueStore* kvs = openKVStore(KeyValueStoreType::SSD_REDWOOD_V1, fileName, UID(), 0);
+	wait(kvs->init());
+
+	// Enough data for a tree several levels deep, so that consecutive keys share some but not all of their path
+	state std::map<Key, Value> written;
+	state int i = 0;
+	for (; i < keyCount; ++i) {
+		Key key = randomString(deterministicRandom()->randomInt(1, 20), 'a', 'd');
+		Value value = randomString(deterministicRandom()->randomInt(0, 200));
+		kvs->set(KeyValueRef(key, value));
+		written[key] = value;
+		if (i % 1000 == 999) {
+			wait(kvs->commit());
+		}
+	}
+	wait(kvs->commit());
+
+	state int round = 0;
+	for (; round < rounds; ++round) {
+		// A sorted batch of keys that are present and keys that are not
+		std::set<Key> keySet;
+		int batchSize = deterministicRandom()->randomInt(1, 200);
+		while ((int)keySet.size() < batchSize) {
+			Key key = randomString(deterministicRandom()->randomInt(1, 20), 'a', 'd');
+			if (deterministicRandom()->coinflip()) {
+				auto w = written.lower_bound(key);
+				if (w != written.end()) {
+					keySet.insert(w->first);
+				}
+			} else {
+				keySet.insert(key);
+			}
+		}
+		state std::vector<Key> keys(keySet.begin(), keySet.end());
+		state std::vector<std::pair<KeyRef, int>> batch;
+		for (auto const& k : keys) {
+			batch.emplace_back(k, deterministicRandom()->randomInt(0, 250));
+		}
+
+		state std::vector<Optional<Value>> values;
+		wait(store(values, kvs->readValuePrefixes(batch)));
+		ASSERT(values.size() == batch.size());
+		for (i = 0; i < batch.size(); ++i) {
+			Optional<Value> v = wait(kvs->readValuePrefix(batch[i].first, batch[i].second));
+			ASSERT(v == values[i]);
+			auto w = written.find(keys[i]);
+			ASSERT(v.present() == (w != written.end()));
+			if (v.present()) {
+				ASSERT(v.get() == w->second.substr(0, std::min(w->second.size(), batch[i].second)));
+			}
+		}
+	}
+
+	wait(closeKVS(kvs));
+	deleteFile(fileName);
+	return Void();
+}
+
 ACTOR Future<Void> doPrefixInsertComparison(int suffixSize,
                                             int valueSize,
                                             int recordCountTarget,
@@ -101,6 +101,7 @@ enum {
 	OPT_TRACECLOCK, OPT_NUMTESTERS, OPT_DEVHELP, OPT_ROLLSIZE, OPT_MAXLOGS, OPT_MAXLOGSSIZE, OPT_KNOB, OPT_UNITTESTPARAM, OPT_TESTSERVERS, OPT_TEST_ON_SERVERS, OPT_METRICSCONNFILE,
 	OPT_METRICSPREFIX, OPT_LOGGROUP, OPT_LOCALITY, OPT_IO_TRUST_SECONDS, OPT_IO_TRUST_WARN_ONLY, OPT_FILESYSTEM, OPT_PROFILER_RSS_SIZE, OPT_KVFILE,
 	OPT_TRACE_FORMAT, OPT_WHITELIST_BINPATH, OPT_BLOB_CREDENTIAL_FILE, OPT_CONFIG_PATH, OPT_USE_TEST_CONFIG_DB, OPT_FAULT_INJECTION, OPT_PROFILER, OPT_PRINT_SIMTIME,
+	OPT_CPU_AFFINITY,
 };
 
 CSimpleOpt::SOption g_rgOptions[] = {
@@ -189,6 +190,7 @@ CSimpleOpt::SOption g_rgOptions[] = {
 	{ OPT_FAULT_INJECTION,       "--fault-injection",           SO_REQ_SEP },
 	{ OPT_PROFILER,	             "--profiler-",                 SO_REQ_SEP},
 	{ OPT_PRINT_SIMTIME,         "--print-sim-time",             SO_NONE },
+	{ OPT_CPU_AFFINITY,          "--cpu-affinity",              SO_REQ_SEP },
 
 #ifndef TLS_DISABLED
 	TLS_OPTION_FLAGS
@@ -603,8 +605,8 @@ static void printUsage(const char* name, bool devhelp) {
 	                 " Sets the LogGroup field with the specified value for all"
 	                 " events in the trace output (defaults to `default').");
 	printOptionUsage("--trace-format FORMAT",
-	                 " Select the format of the log files. xml (the default) and json"
-	                 " are supported.");
+	                 " Select the format of the log files. xml (the default), json"
+	                 " and binary are supported.");
 	printOptionUsage("--tracer       TRACER",
 	                 " Select a tracer for transaction tracing. Currently disabled"
 	                 " (the default) and log_file are supported.");
@@ -627,6 +629,11 @@ static void printUsage(const char* name, bool devhelp) {
 	                 " The amount of memory to use for caching disk pages."
 	                 " The default value is 2GiB. When specified without a unit,"
 	                 " MiB is assumed.");
+	printOptionUsage("--cpu-affinity CPUS",
+	                 " Run this process on the given processors only, as a"
+	                 " comma separated list of numbers and ranges (for example"
+	                 " `0-3,8'). Running several processes per machine, each on"
+	                 " its own processors, keeps their run loops from competing.");
 	printOptionUsage("-c CLASS, --class CLASS",
 	                 " Machine class (valid options are storage, transaction,"
 	                 " resolution, grv_proxy, commit_proxy, master, test, unset, stateless, log, router,"
@@ -771,6 +778,36 @@ void operator delete[](void* ptr, const std::nothrow_t&) throw() {
 }
 #endif
 
+// Parses a list of processors such as "0-3,8". Processors the platform cannot bind to are rejected before ranges are
+// expanded.
+Optional<std::vector<int>> parseProcessorList(std::string const& list) {
+	auto parseProcessor = [](std::string const& s, int& proc) {
+		char* end;
+		long l = strtol(s.c_str(), &end, 10);
+		proc = l;
+		return !s.empty() && !*end && l >= 0 && l < getAffinityProcessorLimit();
+	};
+
+	std::vector<int> procs;
+	StringRef remaining(list);
+	while (remaining.size()) {
+		std::string item = remaining.eat(",").toString();
+		size_t dash = item.find('-');
+		int first, last;
+		if (!parseProcessor(item.substr(0, dash), first) ||
+		    !parseProcessor(dash == std::string::npos ? item : item.substr(dash + 1), last) || last < first) {
+			return Optional<std::vector<int>>();
+		}
+		for (int proc = first; proc <= last; ++proc) {
+			procs.push_back(proc);
+		}
+	}
+	if (procs.empty()) {
+		return Optional<std::vector<int>>();
+	}
+	return procs;
+}
+
 Optional<bool> checkBuggifyOverride(const char* testFile) {
 	std::ifstream ifs;
 	ifs.open(testFile, std::ifstream::in);
@@ -1015,6 +1052,7 @@ struct CLIOptions {
 
 	std::map<std::string, std::string> profilerConfig;
 	bool printSimTime = false;
+	std::vector<int> cpuAffinity;
 
 	static CLIOptions parseArgs(int argc, char* argv[]) {
 		CLIOptions opts;
@@ -1496,6 +1534,16 @@ private:
 			case OPT_PRINT_SIMTIME:
 				printSimTime = true;
 				break;
+			case OPT_CPU_AFFINITY: {
+				auto procs = parseProcessorList(args.OptionArg());
+				if (!procs.present()) {
+					fprintf(stderr, "ERROR: Could not parse cpu_affinity `%s'\n", args.OptionArg());
+					printHelpTeaser(argv[0]);
+					flushAndExit(FDB_EXIT_ERROR);
+				}
+				cpuAffinity = procs.get();
+				break;
+			}
 
 #ifndef TLS_DISABLED
 			case TLSConfig::OPT_TLS_PLUGIN:
@@ -1792,6 +1840,11 @@ int main(int argc, char* argv[]) {
 			openTracer(TracerType(deterministicRandom()->randomInt(static_cast<int>(TracerType::DISABLED),
 			                                                       static_cast<int>(TracerType::SIM_END))));
 		} else {
+			// Set before the network and its helper threads start so that they all inherit it
+			if (!opts.cpuAffinity.empty() && !setAffinity(opts.cpuAffinity)) {
+				fprintf(stderr, "ERROR: Could not restrict the process to the processors given by --cpu-affinity\n");
+				flushAndExit(FDB_EXIT_ERROR);
+			}
 			g_network = newNet2(opts.tlsConfig, opts.useThreadPool, true);
 			g_network->addStopCallback(Net2FileSystem::stop);
 			FlowTransport::createInstance(false, 1, WLTOKEN_RESERVED_COUNT);
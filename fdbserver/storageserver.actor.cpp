@@ -85,6 +85,7 @@ bool canReplyWith(Error e) {
 	case error_code_watch_cancelled:
 	case error_code_unknown_change_feed:
 	case error_code_server_overloaded:
+	case error_code_transaction_timed_out:
 	// getRangeAndMap related exceptions that are not retriable:
 	case error_code_mapper_bad_index:
 	case error_code_mapper_no_such_key:
@@ -200,6 +201,8 @@ struct StorageServerDisk {
 
 	void writeMutation(MutationRef mutation);
 	void writeKeyValue(KeyValueRef kv);
+	Future<Void> ingestKeyValues(Standalone<VectorRef<KeyValueRef>> data);
+	bool canIngest() const { return storage->canIngest(); }
 	void clearRange(KeyRangeRef keys);
 
 	Future<Void> getError() { return storage->getError(); }
@@ -229,6 +232,13 @@ struct StorageServerDisk {
 		++(*kvGets);
 		return storage->readValuePrefix(key, maxLength, type, debugID);
 	}
+	Future<std::vector<Optional<Value>>> readValuePrefixes(
+	    std::vector<std::pair<KeyRef, int>> const& keys,
+	    IKeyValueStore::ReadType type = IKeyValueStore::ReadType::NORMAL,
+	    Optional<UID> debugID = Optional<UID>()) {
+		*kvGets += keys.size();
+		return storage->readValuePrefixes(keys, type, debugID);
+	}
 	Future<RangeResult> readRange(KeyRangeRef keys,
 	                              int rowLimit = 1 << 30,
 	                              int byteLimit = 1 << 30,
@@ -541,6 +551,10 @@ public:
 	void byteSampleApplyMutation(MutationRef const& m, Version ver);
 	void byteSampleApplySet(KeyValueRef kv, Version ver);
 	void byteSampleApplyClear(KeyRangeRef range, Version ver);
+	KeyRef byteSampleChunkEnd(KeyRef key) const;
+	std::map<Key, int64_t>::iterator byteSampleEstimateContaining(KeyRef key);
+	void byteSampleReduceEstimate(std::map<Key, int64_t>::iterator e, int64_t bytes);
+	void byteSampleRemoveRestoredEstimates(KeyRangeRef range);
 
 	void popVersion(Version v, bool popAllTags = false) {
 		if (logSystem && !isTss()) {
@@ -686,6 +700,15 @@ public:
 	CoalescedKeyRangeMap<bool, int64_t, KeyBytesMetric<int64_t>> byteSampleClears;
 	AsyncVar<bool> byteSampleClearsTooLarge;
 	Future<Void> byteSampleRecovery;
+
+	// The byte sample checkpoint: the first key of each chunk of the user key space and the sampled bytes in it as
+	// last persisted in persistByteSampleCheckpointKeys
+	std::map<Key, int64_t> byteSampleCheckpoint;
+	// Chunks of the byte sample checkpoint that stand in for the persisted byte sample until the restore reaches them.
+	// The bytes of each are added to the byte sample at the chunk's first key (or at the end of a clear of its start),
+	// shrink as samples in the chunk are restored, and are dropped once the whole chunk is restored or cleared.
+	std::map<Key, int64_t> byteSampleEstimates;
+	bool byteSampleEstimated = false; // Metrics were served from byteSampleEstimates during this restore
 	Future<Void> durableInProgress;
 
 	AsyncMap<Key, bool> watches;
@@ -846,6 +869,8 @@ public:
 		Counter loops;
 		Counter fetchWaitingMS, fetchWaitingCount, fetchExecutingMS, fetchExecutingCount;
 		Counter readsRejected;
+		// Reads dropped because their client had already given up on them (see TimedRequest::expired())
+		Counter expiredQueries;
 		Counter wrongShardServer;
 		Counter fetchedVersions;
 		Counter fetchesFromLogs;
@@ -888,6 +913,7 @@ public:
 		    updateVersions("UpdateVersions", cc), loops("Loops", cc), fetchWaitingMS("FetchWaitingMS", cc),
 		    fetchWaitingCount("FetchWaitingCount", cc), fetchExecutingMS("FetchExecutingMS", cc),
 		    fetchExecutingCount("FetchExecutingCount", cc), readsRejected("ReadsRejected", cc),
+		    expiredQueries("ExpiredQueries", cc),
 		    wrongShardServer("WrongShardServer", cc), fetchedVersions("FetchedVersions", cc),
 		    fetchesFromLogs("FetchesFromLogs", cc), quickGetValueHit("QuickGetValueHit", cc),
 		    quickGetValueMiss("QuickGetValueMiss", cc), quickGetKeyValuesHit("QuickGetKeyValuesHit", cc),
@@ -929,7 +955,8 @@ public:
 	StorageServer(IKeyValueStore* storage,
 	              Reference<AsyncVar<ServerDBInfo> const> const& db,
 	              StorageServerInterface const& ssi)
-	  : tlogCursorReadsLatencyHistogram(Histogram::getHistogram(STORAGESERVER_HISTOGRAM_GROUP,
+	  : versionedData(SERVER_KNOBS->STORAGE_VERSION_CHAINS),
+	    tlogCursorReadsLatencyHistogram(Histogram::getHistogram(STORAGESERVER_HISTOGRAM_GROUP,
 	                                                            TLOG_CURSOR_READS_LATENCY_HISTOGRAM,
 	                                                            Histogram::Unit::microseconds)),
 	    ssVersionLockLatencyHistogram(Histogram::getHistogram(STORAGESERVER_HISTOGRAM_GROUP,
@@ -1036,6 +1063,14 @@ public:
 		return true;
 	}
 
+	void checkNotExpired(TimedRequest const& req) {
+		if (req.expired()) {
+			TEST(true); // Storage server dropped an expired read
+			++counters.expiredQueries;
+			throw transaction_timed_out();
+		}
+	}
+
 	void checkChangeCounter(uint64_t oldShardChangeCounter, KeyRef const& key) {
 		if (oldShardChangeCounter != shardChangeCounter && shards[key]->changeCounter > oldShardChangeCounter) {
 			TEST(true); // shard change during getValueQ
@@ -1138,6 +1173,9 @@ const KeyRangeRef StorageServer::CurrentRunningFetchKeys::emptyKeyRange =
 
 // So P(key is sampled) * sampledSize == |key+value|
 
+// Until the restore of the persisted byte sample reaches it, the metric of a key in byteSampleEstimates is its
+// sampledSize (if any) plus its estimate
+
 void StorageServer::byteSampleApplyMutation(MutationRef const& m, Version ver) {
 	if (m.type == MutationRef::ClearRange)
 		byteSampleApplyClear(KeyRangeRef(m.param1, m.param2), ver);
@@ -1375,7 +1413,9 @@ ACTOR Future<Void> getValueQ(StorageServer* data, GetValueRequest req) {
 			                      "getValueQ.DoRead"); //.detail("TaskID", g_network->getCurrentTask());
 
 		state Optional<Value> v;
+		data->checkNotExpired(req);
 		state Version version = wait(waitForVersion(data, req.version, req.spanContext));
+		data->checkNotExpired(req);
 		if (req.debugID.present())
 			g_traceBatch.addEvent("GetValueDebug",
 			                      req.debugID.get().first(),
@@ -2173,6 +2213,8 @@ ACTOR Future<Optional<Value>> quickGetValue(StorageServer* data,
 	}
 };
 
+static ArenaProfile rangeReadArenaProfile("GetKeyValuesReply");
+
 // If limit>=0, it returns the first rows in the range (sorted ascending), otherwise the last rows (sorted descending).
 // readRange has O(|result|) + O(log |data|) cost
 ACTOR Future<GetKeyValuesReply> readRange(StorageServer* data,
@@ -2197,6 +2239,8 @@ ACTOR Future<GetKeyValuesReply> readRange(StorageServer* data,
 	// for remembering the position in the resultCache
 	state int pos = 0;
 
+	result.arena = rangeReadArenaProfile.newArena();
+
 	// Check if the desired key-range is cached
 	auto containingRange = data->cachedRangeMap.rangeContaining(range.begin);
 	if (containingRange.value() && containingRange->range().end >= range.end) {
@@ -2372,6 +2416,7 @@ ACTOR Future<GetKeyValuesReply> readRange(StorageServer* data,
 	ASSERT(result.data.size() == 0 || *pLimitBytes + result.data.end()[-1].expectedSize() + sizeof(KeyValueRef) > 0);
 	result.more = limit == 0 || *pLimitBytes <= 0; // FIXME: Does this have to be exact?
 	result.version = version;
+	rangeReadArenaProfile.record(result.arena);
 	return result;
 }
 
@@ -2520,7 +2565,9 @@ ACTOR Future<Void> getKeyValuesQ(StorageServer* data, GetKeyValuesRequest req)
 	try {
 		if (req.debugID.present())
 			g_traceBatch.addEvent("TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValues.Before");
+		data->checkNotExpired(req);
 		state Version version = wait(waitForVersion(data, req.version, span.context));
+		data->checkNotExpired(req);
 
 		state uint64_t changeCounter = data->shardChangeCounter;
 		//		try {
@@ -2966,7 +3013,9 @@ ACTOR Future<Void> getKeyValuesAndFlatMapQ(StorageServer* data, GetKeyValuesAndF
 		if (req.debugID.present())
 			g_traceBatch.addEvent(
 			    "TransactionDebug", req.debugID.get().first(), "storageserver.getKeyValuesAndFlatMap.Before");
+		data->checkNotExpired(req);
 		state Version version = wait(waitForVersion(data, req.version, span.context));
+		data->checkNotExpired(req);
 
 		state uint64_t changeCounter = data->shardChangeCounter;
 		//		try {
@@ -3322,7 +3371,9 @@ ACTOR Future<Void> getKeyQ(StorageServer* data, GetKeyRequest req) {
 	wait(data->getQueryDelay());
 
 	try {
+		data->checkNotExpired(req);
 		state Version version = wait(waitForVersion(data, req.version, req.spanContext));
+		data->checkNotExpired(req);
 
 		state uint64_t changeCounter = data->shardChangeCounter;
 		state KeyRange shard = getShardKeyRange(data, req.sel);
@@ -3438,12 +3489,8 @@ ACTOR Future<Void> doEagerReads(StorageServer* data, UpdateEagerReadInfo* eager)
 		eager->keyEnd = keyEndVal;
 	}
 
-	std::vector<Future<Optional<Value>>> value(eager->keys.size());
-	for (int i = 0; i < value.size(); i++)
-		value[i] =
-		    data->storage.readValuePrefix(eager->keys[i].first, eager->keys[i].second, IKeyValueStore::ReadType::EAGER);
-
-	state Future<std::vector<Optional<Value>>> futureValues = getAll(value);
+	state Future<std::vector<Optional<Value>>> futureValues =
+	    data->storage.readValuePrefixes(eager->keys, IKeyValueStore::ReadType::EAGER);
 	std::vector<Optional<Value>> optionalValues = wait(futureValues);
 	for (const auto& value : optionalValues) {
 		if (value.present()) {
@@ -3946,6 +3993,8 @@ static const KeyRangeRef persistByteSampleKeys =
 static const KeyRangeRef persistByteSampleSampleKeys =
     KeyRangeRef(LiteralStringRef(PERSIST_PREFIX "BS/" PERSIST_PREFIX "BS/"),
                 LiteralStringRef(PERSIST_PREFIX "BS/" PERSIST_PREFIX "BS0"));
+static const KeyRangeRef persistByteSampleCheckpointKeys =
+    KeyRangeRef(LiteralStringRef(PERSIST_PREFIX "BSC/"), LiteralStringRef(PERSIST_PREFIX "BSC0"));
 static const KeyRef persistLogProtocol = LiteralStringRef(PERSIST_PREFIX "LogProtocol");
 static const KeyRef persistPrimaryLocality = LiteralStringRef(PERSIST_PREFIX "PrimaryLocality");
 static const KeyRangeRef persistChangeFeedKeys =
@@ -4207,6 +4256,14 @@ ACTOR Future<Void> fetchKeys(StorageServer* data, AddingShard* shard) {
 		// we must refresh the cache manually.
 		data->cx->invalidateCache(keys);
 
+		// Engines without a cheaper way to load a block take it through set() with a yield() after each key
+		state bool ingest = SERVER_KNOBS->FETCH_KEYS_INGEST && data->storage.canIngest();
+		if (ingest) {
+			// Ingested blocks can take effect ahead of uncommitted writes, so first let the clear left behind by an
+			// earlier, cancelled fetch of these keys be committed
+			wait(data->durableVersion.whenAtLeast(data->storageVersion() + 1));
+		}
+
 		loop {
 			state Transaction tr(data->cx);
 			fetchVersion = data->version.get();
@@ -4260,9 +4317,17 @@ ACTOR Future<Void> fetchKeys(StorageServer* data, AddingShard* shard) {
 
 					// Write this_block to storage
 					state KeyValueRef* kvItr = this_block.begin();
-					for (; kvItr != this_block.end(); ++kvItr) {
-						data->storage.writeKeyValue(*kvItr);
-						wait(yield());
+					if (ingest) {
+						// The storage engine may load the whole block at once instead of taking it through its write
+						// path. The keys are not readable before the fetch completes, so it does not matter if the
+						// block is durable before the next commit: if the server restarts first, the keys are not
+						// available and so are cleared.
+						wait(data->storage.ingestKeyValues(this_block.castTo<VectorRef<KeyValueRef>>()));
+					} else {
+						for (; kvItr != this_block.end(); ++kvItr) {
+							data->storage.writeKeyValue(*kvItr);
+							wait(yield());
+						}
 					}
 
 					kvItr = this_block.begin();
@@ -5736,6 +5801,11 @@ void StorageServerDisk::writeKeyValue(KeyValueRef kv) {
 	*kvCommitLogicalBytes += kv.expectedSize();
 }
 
+Future<Void> StorageServerDisk::ingestKeyValues(Standalone<VectorRef<KeyValueRef>> data) {
+	*kvCommitLogicalBytes += data.expectedSize();
+	return storage->ingest(data);
+}
+
 void StorageServerDisk::writeMutation(MutationRef mutation) {
 	if (mutation.type == MutationRef::SetValue) {
 		storage->set(KeyValueRef(mutation.param1, mutation.param2));
@@ -5827,31 +5897,51 @@ ACTOR Future<Void> applyByteSampleResult(StorageServer* data,
 		totalFetches++;
 		totalKeys += bs.size();
 		totalBytes += rangeSize;
+		auto& byteSample = data->metrics.byteSample.sample;
 		for (int j = 0; j < bs.size(); j++) {
 			KeyRef key = bs[j].key.removePrefix(persistByteSampleKeys.begin);
 			if (!data->byteSampleClears.rangeContaining(key).value()) {
-				data->metrics.byteSample.sample.insert(
-				    key, BinaryReader::fromStringRef<int32_t>(bs[j].value, Unversioned()), false);
+				int32_t sampledSize = BinaryReader::fromStringRef<int32_t>(bs[j].value, Unversioned());
+				if (!data->byteSampleEstimated) {
+					byteSample.insert(key, sampledSize, false);
+				} else {
+					// Metrics are already being served, so waiting requests need to hear about restored bytes. The
+					// estimate for the chunk stands in for the part of it that is not restored yet, so it shrinks by
+					// what is.
+					auto e = data->byteSampleEstimateContaining(key);
+					auto sample = byteSample.find(key);
+					if (sample == byteSample.end()) {
+						byteSample.insert(key, sampledSize);
+						data->metrics.notifyBytes(key, sampledSize);
+					} else if (e != data->byteSampleEstimates.end() && e->first == key &&
+					           byteSample.getMetric(sample) == e->second) {
+						byteSample.insert(key, sampledSize + e->second);
+						data->metrics.notifyBytes(key, sampledSize);
+					}
+					if (e != data->byteSampleEstimates.end()) {
+						data->byteSampleReduceEstimate(e, sampledSize);
+					}
+				}
 			}
 		}
+		KeyRange restored;
 		if (rangeSize >= SERVER_KNOBS->STORAGE_LIMIT_BYTES) {
 			Key nextBegin = keyAfter(bs.back().key);
-			data->byteSampleClears.insert(KeyRangeRef(begin, nextBegin).removePrefix(persistByteSampleKeys.begin),
-			                              true);
-			data->byteSampleClearsTooLarge.set(data->byteSampleClears.size() >
-			                                   SERVER_KNOBS->MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE);
+			restored = KeyRangeRef(begin, nextBegin).removePrefix(persistByteSampleKeys.begin);
 			begin = nextBegin;
-			if (begin == end) {
-				break;
-			}
 		} else {
-			data->byteSampleClears.insert(KeyRangeRef(begin.removePrefix(persistByteSampleKeys.begin),
-			                                          end == persistByteSampleKeys.end
-			                                              ? LiteralStringRef("\xff\xff\xff")
-			                                              : end.removePrefix(persistByteSampleKeys.begin)),
-			                              true);
-			data->byteSampleClearsTooLarge.set(data->byteSampleClears.size() >
-			                                   SERVER_KNOBS->MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE);
+			restored = KeyRangeRef(begin.removePrefix(persistByteSampleKeys.begin),
+			                       end == persistByteSampleKeys.end ? LiteralStringRef("\xff\xff\xff")
+			                                                        : end.removePrefix(persistByteSampleKeys.begin));
+			begin = end;
+		}
+		data->byteSampleClears.insert(restored, true);
+		data->byteSampleClearsTooLarge.set(data->byteSampleClears.size() > SERVER_KNOBS->MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE);
+		if (!data->byteSampleEstimates.empty()) {
+			// Ranges are restored in parallel, so a chunk's estimate goes only once all of the chunk is restored
+			data->byteSampleRemoveRestoredEstimates(restored);
+		}
+		if (begin == end) {
 			break;
 		}
 
@@ -5868,6 +5958,39 @@ ACTOR Future<Void> applyByteSampleResult(StorageServer* data,
 	return Void();
 }
 
+// Reads the byte sample checkpoint and, if enabled, adds its chunks to the byte sample as estimates of the bytes in
+// them, so that metrics can be served without waiting for the persisted byte sample to be restored
+ACTOR Future<Void> restoreByteSampleCheckpoint(StorageServer* data, IKeyValueStore* storage) {
+	state Key begin = persistByteSampleCheckpointKeys.begin;
+	loop {
+		RangeResult chunks =
+		    wait(storage->readRange(KeyRangeRef(begin, persistByteSampleCheckpointKeys.end),
+		                            SERVER_KNOBS->STORAGE_LIMIT_BYTES,
+		                            SERVER_KNOBS->STORAGE_LIMIT_BYTES));
+		data->bytesRestored += chunks.logicalSize();
+		data->counters.kvScanBytes += chunks.logicalSize();
+		for (auto& kv : chunks) {
+			Key key = kv.key.removePrefix(persistByteSampleCheckpointKeys.begin);
+			int64_t bytes = BinaryReader::fromStringRef<int64_t>(kv.value, Unversioned());
+			data->byteSampleCheckpoint[key] = bytes;
+			if (bytes > 0 && SERVER_KNOBS->BYTE_SAMPLE_CHECKPOINT_BYTES > 0) {
+				data->byteSampleEstimates[key] = bytes;
+				data->metrics.byteSample.sample.insert(key, bytes);
+			}
+		}
+		if (chunks.expectedSize() < SERVER_KNOBS->STORAGE_LIMIT_BYTES) {
+			break;
+		}
+		begin = keyAfter(chunks.back().key);
+	}
+	data->byteSampleEstimated = !data->byteSampleEstimates.empty();
+	TraceEvent("RecoveredByteSampleCheckpoint", data->thisServerID)
+	    .detail("Chunks", data->byteSampleCheckpoint.size())
+	    .detail("Estimates", data->byteSampleEstimates.size())
+	    .detail("EstimatedBytes", data->metrics.byteSample.getEstimate(allKeys));
+	return Void();
+}
+
 ACTOR Future<Void> restoreByteSample(StorageServer* data,
                                      IKeyValueStore* storage,
                                      Promise<Void> byteSampleSampleRecovered,
@@ -5875,6 +5998,7 @@ ACTOR Future<Void> restoreByteSample(StorageServer* data,
 	state std::vector<Standalone<VectorRef<KeyValueRef>>> byteSampleSample;
 	wait(applyByteSampleResult(
 	    data, storage, persistByteSampleSampleKeys.begin, persistByteSampleSampleKeys.end, &byteSampleSample));
+	wait(restoreByteSampleCheckpoint(data, storage));
 	byteSampleSampleRecovered.send(Void());
 	wait(startRestore);
 	wait(delay(SERVER_KNOBS->BYTE_SAMPLE_START_DELAY));
@@ -5909,6 +6033,8 @@ ACTOR Future<Void> restoreByteSample(StorageServer* data,
 
 	wait(waitForAll(sampleRanges));
 	TraceEvent("RecoveredByteSampleChunkedRead", data->thisServerID).detail("Ranges", sampleRanges.size());
+	// Every chunk is now restored or cleared, so no estimate is left standing in for one
+	ASSERT(data->byteSampleEstimates.empty());
 
 	if (BUGGIFY)
 		wait(delay(deterministicRandom()->random01() * 10.0));
@@ -6171,14 +6297,20 @@ void StorageServer::byteSampleApplySet(KeyValueRef kv, Version ver) {
 	auto& byteSample = metrics.byteSample.sample;
 
 	int64_t delta = 0;
+	int64_t estimate = 0;
 	const KeyRef key = kv.key;
 
 	auto old = byteSample.find(key);
-	if (old != byteSample.end())
+	if (old != byteSample.end()) {
 		delta = -byteSample.getMetric(old);
+		if (!byteSampleEstimates.empty()) {
+			auto e = byteSampleEstimates.find(key);
+			estimate = e != byteSampleEstimates.end() ? e->second : 0;
+		}
+	}
 	if (sampleInfo.inSample) {
-		delta += sampleInfo.sampledSize;
-		byteSample.insert(key, sampleInfo.sampledSize);
+		delta += sampleInfo.sampledSize + estimate;
+		byteSample.insert(key, sampleInfo.sampledSize + estimate);
 		addMutationToMutationLogOrStorage(ver,
 		                                  MutationRef(MutationRef::SetValue,
 		                                              key.withPrefix(persistByteSampleKeys.begin),
@@ -6193,7 +6325,12 @@ void StorageServer::byteSampleApplySet(KeyValueRef kv, Version ver) {
 			}
 		}
 		if (any) {
-			byteSample.erase(old);
+			if (estimate) {
+				delta += estimate;
+				byteSample.insert(key, estimate);
+			} else {
+				byteSample.erase(old);
+			}
 			auto diskRange = singleKeyRange(key.withPrefix(persistByteSampleKeys.begin));
 			addMutationToMutationLogOrStorage(ver,
 			                                  MutationRef(MutationRef::ClearRange, diskRange.begin, diskRange.end));
@@ -6242,12 +6379,148 @@ void StorageServer::byteSampleApplyClear(KeyRangeRef range, Version ver) {
 
 	if (any) {
 		byteSample.eraseAsync(range.begin, range.end);
+		if (!byteSampleEstimates.empty()) {
+			// The part of a chunk's estimate for what lies past the clear moves to its end
+			int64_t moved = 0;
+			auto e = byteSampleEstimates.lower_bound(range.begin);
+			while (e != byteSampleEstimates.end() && e->first < range.end) {
+				if (byteSampleChunkEnd(e->first) > range.end) {
+					moved += e->second;
+				}
+				e = byteSampleEstimates.erase(e);
+			}
+			if (moved) {
+				auto sample = byteSample.find(range.end);
+				byteSample.insert(range.end, moved + (sample != byteSample.end() ? byteSample.getMetric(sample) : 0));
+				byteSampleEstimates[range.end] = moved;
+				metrics.notifyBytes(range.end, moved);
+			}
+			if (!byteSampleRecovery.isReady()) {
+				byteSampleRemoveRestoredEstimates(KeyRangeRef(range.begin, keyAfter(range.end)));
+			}
+		}
 		auto diskRange = range.withPrefix(persistByteSampleKeys.begin);
 		addMutationToMutationLogOrStorage(ver, MutationRef(MutationRef::ClearRange, diskRange.begin, diskRange.end));
 		++counters.kvSystemClearRanges;
 	}
 }
 
+KeyRef StorageServer::byteSampleChunkEnd(KeyRef key) const {
+	auto next = byteSampleCheckpoint.upper_bound(key);
+	return next != byteSampleCheckpoint.end() ? KeyRef(next->first) : allKeys.end;
+}
+
+// Returns the estimate standing in for the chunk containing key, or byteSampleEstimates.end() if there is none
+std::map<Key, int64_t>::iterator StorageServer::byteSampleEstimateContaining(KeyRef key) {
+	auto e = byteSampleEstimates.upper_bound(key);
+	if (e == byteSampleEstimates.begin()) {
+		return byteSampleEstimates.end();
+	}
+	--e;
+	return key < byteSampleChunkEnd(e->first) ? e : byteSampleEstimates.end();
+}
+
+// Takes up to bytes off the estimate, dropping it once nothing is left
+void StorageServer::byteSampleReduceEstimate(std::map<Key, int64_t>::iterator e, int64_t bytes) {
+	auto& byteSample = metrics.byteSample.sample;
+	bytes = std::min(bytes, e->second);
+	auto sample = byteSample.find(e->first);
+	ASSERT(sample != byteSample.end());
+	int64_t metric = byteSample.getMetric(sample) - bytes;
+	if (metric > 0) {
+		byteSample.insert(e->first, metric);
+	} else {
+		byteSample.erase(sample);
+	}
+	metrics.notifyBytes(e->first, -bytes);
+	e->second -= bytes;
+	if (e->second <= 0) {
+		byteSampleEstimates.erase(e);
+	}
+}
+
+// Drops the estimates of the chunks intersecting range that have been restored or cleared in full
+void StorageServer::byteSampleRemoveRestoredEstimates(KeyRangeRef range) {
+	auto e = byteSampleEstimates.upper_bound(range.begin);
+	if (e != byteSampleEstimates.begin()) {
+		--e;
+	}
+	while (e != byteSampleEstimates.end() && e->first < range.end) {
+		auto next = std::next(e);
+		KeyRangeRef chunk(e->first, byteSampleChunkEnd(e->first));
+		bool restored = chunk.end > range.begin;
+		for (auto r : byteSampleClears.intersectingRanges(chunk)) {
+			if (!r.value()) {
+				restored = false;
+				break;
+			}
+		}
+		if (restored) {
+			TEST(true); // Byte sample estimate dropped once its chunk is restored
+			byteSampleReduceEstimate(e, e->second);
+		}
+		e = next;
+	}
+}
+
+// Brings the chunk of the byte sample checkpoint at the given position up to date with the byte sample, splitting or
+// merging it with the next chunk to keep chunks near BYTE_SAMPLE_CHECKPOINT_BYTES, and advances past it. Chunk
+// boundaries only move when chunks change size a lot, and a chunk is only rewritten when its bytes are off by more
+// than an eighth of a chunk, so each pass writes little more than what changed since the last one. Returns the number
+// of chunks written.
+static int updateByteSampleCheckpointChunk(StorageServer* data, std::map<Key, int64_t>::iterator& chunk) {
+	auto& byteSample = data->metrics.byteSample.sample;
+	const int64_t chunkBytes = SERVER_KNOBS->BYTE_SAMPLE_CHECKPOINT_BYTES;
+
+	auto next = std::next(chunk);
+	KeyRef chunkBegin = chunk->first;
+	KeyRef chunkEnd = next != data->byteSampleCheckpoint.end() ? KeyRef(next->first) : allKeys.end;
+	int64_t bytes = byteSample.sumRange(chunkBegin, chunkEnd);
+	bool changed = std::abs(bytes - chunk->second) > chunkBytes / 8;
+
+	if (bytes > 2 * chunkBytes) {
+		auto split = byteSample.index(byteSample.sumTo(byteSample.lower_bound(chunk->first)) + chunkBytes);
+		if (split != byteSample.end() && *split == chunk->first) {
+			++split;
+		}
+		if (split != byteSample.end() && *split < chunkEnd) {
+			// The new chunk is visited next, and split again if it is still too large
+			next = data->byteSampleCheckpoint.emplace_hint(next, *split, 0);
+			bytes = byteSample.sumRange(chunk->first, *split);
+			changed = true;
+		}
+	} else if (bytes < chunkBytes / 4 && next != data->byteSampleCheckpoint.end()) {
+		auto afterNext = std::next(next);
+		KeyRef nextEnd = afterNext != data->byteSampleCheckpoint.end() ? KeyRef(afterNext->first) : allKeys.end;
+		int64_t merged = bytes + byteSample.sumRange(chunkEnd, nextEnd);
+		if (merged < chunkBytes) {
+			auto& mLV = data->addVersionToMutationLog(data->data().getLatestVersion());
+			auto diskRange = singleKeyRange(next->first.withPrefix(persistByteSampleCheckpointKeys.begin));
+			data->addMutationToMutationLog(mLV, MutationRef(MutationRef::ClearRange, diskRange.begin, diskRange.end));
+			++data->counters.kvSystemClearRanges;
+			data->byteSampleCheckpoint.erase(next);
+			chunk->second = merged;
+			data->addMutationToMutationLog(mLV,
+			                               MutationRef(MutationRef::SetValue,
+			                                           chunk->first.withPrefix(persistByteSampleCheckpointKeys.begin),
+			                                           BinaryWriter::toValue(merged, Unversioned())));
+			// The merged chunk is visited again, and merged again if it is still small
+			return 1;
+		}
+	}
+
+	if (changed) {
+		chunk->second = bytes;
+		auto& mLV = data->addVersionToMutationLog(data->data().getLatestVersion());
+		data->addMutationToMutationLog(mLV,
+		                               MutationRef(MutationRef::SetValue,
+		                                           chunk->first.withPrefix(persistByteSampleCheckpointKeys.begin),
+		                                           BinaryWriter::toValue(bytes, Unversioned())));
+	}
+	chunk = next;
+	return changed ? 1 : 0;
+}
+
 ACTOR Future<Void> waitMetrics(StorageServerMetrics* self, WaitMetricsRequest req, Future<Void> timeout) {
 	state PromiseStream<StorageMetrics> change;
 	state StorageMetrics metrics = self->getMetrics(req.keys);
@@ -6355,8 +6628,13 @@ Future<Void> StorageServerMetrics::waitMetrics(WaitMetricsRequest req, Future<Vo
 ACTOR Future<Void> metricsCore(StorageServer* self, StorageServerInterface ssi) {
 	state Future<Void> doPollMetrics = Void();
 
-	wait(self->byteSampleRecovery);
-	TraceEvent("StorageServerRestoreDurableState", self->thisServerID).detail("RestoredBytes", self->bytesRestored);
+	// With a byte sample checkpoint metrics are estimated from it until the byte sample is restored
+	if (!self->byteSampleEstimated) {
+		wait(self->byteSampleRecovery);
+	}
+	TraceEvent("StorageServerRestoreDurableState", self->thisServerID)
+	    .detail("RestoredBytes", self->bytesRestored)
+	    .detail("ByteSampleEstimated", self->byteSampleEstimated);
 
 	// Logs all counters in `counters.cc` and reset the interval.
 	self->actors.add(traceCounters("StorageMetrics",
@@ -6444,6 +6722,46 @@ ACTOR Future<Void> logLongByteSampleRecovery(Future<Void> recovery) {
 	return Void();
 }
 
+// Periodically persists the byte sample checkpoint, which lets a restarted storage server serve metrics before it has
+// restored the whole persisted byte sample
+ACTOR Future<Void> checkpointByteSample(StorageServer* self) {
+	state std::map<Key, int64_t>::iterator chunk;
+	state int chunks;
+	state int writes;
+
+	wait(self->byteSampleRecovery);
+	if (SERVER_KNOBS->BYTE_SAMPLE_CHECKPOINT_BYTES <= 0) {
+		// Don't leave an old checkpoint behind to be used if checkpoints are enabled again
+		if (!self->byteSampleCheckpoint.empty()) {
+			auto& mLV = self->addVersionToMutationLog(self->data().getLatestVersion());
+			self->addMutationToMutationLog(mLV,
+			                               MutationRef(MutationRef::ClearRange,
+			                                           persistByteSampleCheckpointKeys.begin,
+			                                           persistByteSampleCheckpointKeys.end));
+			++self->counters.kvSystemClearRanges;
+			self->byteSampleCheckpoint.clear();
+		}
+		return Void();
+	}
+
+	self->byteSampleCheckpoint.emplace(allKeys.begin, 0);
+	loop {
+		wait(delay(SERVER_KNOBS->BYTE_SAMPLE_CHECKPOINT_INTERVAL));
+		chunk = self->byteSampleCheckpoint.begin();
+		chunks = 0;
+		writes = 0;
+		while (chunk != self->byteSampleCheckpoint.end()) {
+			writes += updateByteSampleCheckpointChunk(self, chunk);
+			if (++chunks % 1000 == 0) {
+				wait(yield());
+			}
+		}
+		TraceEvent(SevDebug, "ByteSampleCheckpoint", self->thisServerID)
+		    .detail("Chunks", self->byteSampleCheckpoint.size())
+		    .detail("Writes", writes);
+	}
+}
+
 ACTOR Future<Void> checkBehind(StorageServer* self) {
 	state int behindCount = 0;
 	loop {
@@ -6714,6 +7032,7 @@ ACTOR Future<Void> storageServerCore(StorageServer* self, StorageServerInterface
 	self->actors.add(self->otherError.getFuture());
 	self->actors.add(metricsCore(self, ssi));
 	self->actors.add(logLongByteSampleRecovery(self->byteSampleRecovery));
+	self->actors.add(checkpointByteSample(self));
 	self->actors.add(checkBehind(self));
 	self->actors.add(serveGetValueRequests(self, ssi.getValue.getFuture()));
 	self->actors.add(serveGetKeyValuesRequests(self, ssi.getKeyValues.getFuture()));
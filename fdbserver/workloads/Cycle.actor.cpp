@@ -33,6 +33,7 @@
 struct CycleWorkload : TestWorkload {
 	int actorCount, nodeCount;
 	double testDuration, transactionsPerSecond, minExpectedTransactionsPerSecond, traceParentProbability;
+	bool useGrvCache;
 	Key keyPrefix;
 
 	std::vector<Future<Void>> clients;
@@ -49,6 +50,8 @@ struct CycleWorkload : TestWorkload {
 		keyPrefix = unprintable(getOption(options, "keyPrefix"_sr, LiteralStringRef("")).toString());
 		traceParentProbability = getOption(options, "traceParentProbability "_sr, 0.01);
 		minExpectedTransactionsPerSecond = transactionsPerSecond * getOption(options, "expectedRate"_sr, 0.7);
+		useGrvCache =
+		    getOption(options, "useGrvCache"_sr, g_network->isSimulated() && deterministicRandom()->coinflip());
 	}
 
 	std::string description() const override { return "CycleWorkload"; }
@@ -108,6 +111,9 @@ struct CycleWorkload : TestWorkload {
 					tr.setOption(FDBTransactionOptions::SPAN_PARENT,
 					             BinaryWriter::toValue(span.context, Unversioned()));
 				}
+				if (self->useGrvCache) {
+					tr.setOption(FDBTransactionOptions::USE_GRV_CACHE);
+				}
 				while (true) {
 					try {
 						// Reverse next and next^2 node
@@ -98,6 +98,7 @@ struct ReadWriteWorkload : KVWorkload {
 	bool rampTransactionType;
 	bool rampUpConcurrency;
 	bool batchPriority;
+	bool useGrvCache;
 
 	Standalone<StringRef> descriptionString;
 
@@ -180,6 +181,8 @@ struct ReadWriteWorkload : KVWorkload {
 		rampUpConcurrency = getOption(options, LiteralStringRef("rampUpConcurrency"), false);
 		doSetup = getOption(options, LiteralStringRef("setup"), true);
 		batchPriority = getOption(options, LiteralStringRef("batchPriority"), false);
+		useGrvCache = getOption(
+		    options, LiteralStringRef("useGrvCache"), g_network->isSimulated() && deterministicRandom()->coinflip());
 		descriptionString = getOption(options, LiteralStringRef("description"), LiteralStringRef("ReadWrite"));
 
 		if (rampUpConcurrency)
@@ -332,6 +335,10 @@ struct ReadWriteWorkload : KVWorkload {
 		if (batchPriority) {
 			tr->setOption(FDBTransactionOptions::PRIORITY_BATCH);
 		}
+		// Transactions that are not ReadYourWritesTransactions do not take the database's transaction defaults
+		if (useGrvCache && !useRYW) {
+			tr->setOption(FDBTransactionOptions::USE_GRV_CACHE);
+		}
 	}
 
 	ACTOR static Future<Void> tracePeriodically(ReadWriteWorkload* self) {
@@ -605,15 +612,22 @@ struct ReadWriteWorkload : KVWorkload {
 		if (self->enableReadLatencyLogging)
 			clients.push_back(tracePeriodically(self));
 
+		Database clientDb = cx;
+		if (self->useGrvCache && self->useRYW) {
+			// Set on a clone so that other workloads sharing cx are not affected
+			clientDb = cx->clone();
+			clientDb->setOption(FDBDatabaseOptions::TRANSACTION_USE_GRV_CACHE, Optional<StringRef>());
+		}
+
 		self->clientBegin = now();
 		for (int c = 0; c < self->actorCount; c++) {
 			Future<Void> worker;
 			if (self->useRYW)
 				worker = self->randomReadWriteClient<ReadYourWritesTransaction>(
-				    cx, self, self->actorCount / self->transactionsPerSecond, c);
+				    clientDb, self, self->actorCount / self->transactionsPerSecond, c);
 			else
 				worker = self->randomReadWriteClient<Transaction>(
-				    cx, self, self->actorCount / self->transactionsPerSecond, c);
+				    clientDb, self, self->actorCount / self->transactionsPerSecond, c);
 			clients.push_back(worker);
 		}
 
@@ -33,6 +33,8 @@ extern "C" const char* __lsan_default_options(void) {
 #include <memcheck.h>
 #endif
 
+std::atomic<int64_t> g_arenaBlockPoolMemory(0);
+
 // For each use of arena-internal memory (e.g. ArenaBlock::getSize()), unpoison the memory before use and
 // poison it when done.
 // When creating a new ArenaBlock, poison the memory that will be later allocated to users.
@@ -75,6 +77,80 @@ void makeNoAccess(void*, size_t) {}
 void makeDefined(void*, size_t) {}
 void makeUndefined(void*, size_t) {}
 #endif
+
+// Blocks too large for FastAllocator come from new[]. Up to MAX_POOLED_BLOCK bytes, their sizes are rounded up to one
+// of four classes per power of two, and freed blocks are kept per thread (up to ARENA_BLOCK_POOL_BYTES) for the next
+// arena that needs one of that class. The rounding only adds room to the block, which the arena goes on to use.
+constexpr int MAX_POOLED_BLOCK = 1 << 20;
+constexpr int POOLED_BLOCK_CLASSES = 28; // Four for each power of two from 8K to 1M
+
+// Rounds size up to its pooled size class and returns the class, or returns -1 if blocks of this size are not pooled
+int pooledBlockClass(int& size) {
+#if defined(ADDRESS_SANITIZER)
+	return -1;
+#endif
+#if VALGRIND
+	if (valgrindPrecise()) {
+		return -1;
+	}
+#endif
+	if (!FLOW_KNOBS || FLOW_KNOBS->ARENA_BLOCK_POOL_BYTES <= 0 || size <= 8192 || size > MAX_POOLED_BLOCK) {
+		return -1;
+	}
+	int log = 0;
+	while ((2 << log) < size) {
+		log++;
+	}
+	// size is in (2^log, 2^(log+1)], and is rounded up to a multiple of a quarter of 2^log
+	int step = 1 << (log - 2);
+	size = (size + step - 1) & ~(step - 1);
+	return (log - 13) * 4 + size / step - 5;
+}
+
+struct ArenaBlockPool {
+	void* blocks[POOLED_BLOCK_CLASSES] = {}; // Each free block holds a pointer to the next one in its class
+	int64_t bytes = 0;
+
+	~ArenaBlockPool() {
+		for (void* b : blocks) {
+			while (b) {
+				void* next = *(void**)b;
+				delete[](uint8_t*) b;
+				b = next;
+			}
+		}
+		g_arenaBlockPoolMemory.fetch_sub(bytes);
+	}
+};
+thread_local ArenaBlockPool arenaBlockPool;
+
+uint8_t* newHugeBlock(int& size) {
+	int c = pooledBlockClass(size);
+	if (c >= 0 && arenaBlockPool.blocks[c]) {
+		void* b = arenaBlockPool.blocks[c];
+		arenaBlockPool.blocks[c] = *(void**)b;
+		arenaBlockPool.bytes -= size;
+		g_arenaBlockPoolMemory.fetch_sub(size);
+		return (uint8_t*)b;
+	}
+	return new uint8_t[size];
+}
+
+void deleteHugeBlock(void* b, int size) {
+	int classSize = size;
+	int c = pooledBlockClass(classSize);
+	// A block allocated while pooling was off may not be exactly the size of its class
+	if (c >= 0 && classSize == size && arenaBlockPool.bytes + size <= FLOW_KNOBS->ARENA_BLOCK_POOL_BYTES) {
+		*(void**)b = arenaBlockPool.blocks[c];
+		arenaBlockPool.blocks[c] = b;
+		arenaBlockPool.bytes += size;
+		g_arenaBlockPoolMemory.fetch_add(size);
+		return;
+	}
+	delete[](uint8_t*) b;
+}
+
+std::atomic<ArenaProfile*> arenaProfiles(nullptr);
 } // namespace
 
 Arena::Arena() : impl(nullptr) {}
@@ -115,6 +191,15 @@ size_t Arena::getSize() const {
 	}
 	return 0;
 }
+size_t Arena::getUsedSize() const {
+	if (impl) {
+		allowAccess(impl.getPtr());
+		auto result = impl->totalUsed();
+		disallowAccess(impl.getPtr());
+		return result;
+	}
+	return 0;
+}
 bool Arena::hasFree(size_t size, const void* address) {
 	if (impl) {
 		allowAccess(impl.getPtr());
@@ -189,6 +274,28 @@ size_t ArenaBlock::totalSize() {
 	}
 	return s;
 }
+size_t ArenaBlock::totalUsed() {
+	if (isTiny()) {
+		return used();
+	}
+
+	size_t s = used();
+	int o = nextBlockOffset;
+	while (o) {
+		ArenaBlockRef* r = (ArenaBlockRef*)((char*)getData() + o);
+		makeDefined(r, sizeof(ArenaBlockRef));
+		if (r->aligned4kBufferSize != 0) {
+			s += r->aligned4kBufferSize;
+		} else {
+			allowAccess(r->next);
+			s += r->next->totalUsed();
+			disallowAccess(r->next);
+		}
+		o = r->nextBlockOffset;
+		makeNoAccess(r, sizeof(ArenaBlockRef));
+	}
+	return s;
+}
 // just for debugging:
 void ArenaBlock::getUniqueBlocks(std::set<ArenaBlock*>& a) {
 	a.insert(this);
@@ -344,10 +451,10 @@ ArenaBlock* ArenaBlock::create(int dataSize, Reference<ArenaBlock>& next) {
 			b->tinySize = b->tinyUsed = NOT_TINY;
 			b->bigUsed = sizeof(ArenaBlock);
 		} else {
+			b = (ArenaBlock*)newHugeBlock(reqSize);
 #ifdef ALLOC_INSTRUMENTATION
 			allocInstr["ArenaHugeKB"].alloc((reqSize + 1023) >> 10);
 #endif
-			b = (ArenaBlock*)new uint8_t[reqSize];
 			b->tinySize = b->tinyUsed = NOT_TINY;
 			b->bigSize = reqSize;
 			b->bigUsed = sizeof(ArenaBlock);
@@ -454,8 +561,54 @@ void ArenaBlock::destroyLeaf() {
 			allocInstr["ArenaHugeKB"].dealloc((bigSize + 1023) >> 10);
 #endif
 			g_hugeArenaMemory.fetch_sub(bigSize);
-			delete[](uint8_t*) this;
+			deleteHugeBlock(this, bigSize);
+		}
+	}
+}
+
+ArenaProfile::ArenaProfile(const char* name)
+  : name(name), estimate(0), arenas(0), usedBytes(0), slackBytes(0), next(arenaProfiles.load()) {
+	while (!arenaProfiles.compare_exchange_weak(next, this)) {
+	}
+}
+
+Arena ArenaProfile::newArena() const {
+	int64_t reserve = std::min<int64_t>(estimate.load(std::memory_order_relaxed),
+	                                    FLOW_KNOBS ? FLOW_KNOBS->ARENA_PROFILE_MAX_RESERVED_BYTES : 0);
+	return reserve > 0 ? Arena(reserve) : Arena();
+}
+
+void ArenaProfile::record(const Arena& arena) {
+	// Walking the arena's blocks and updating the counters is not free, so nothing is recorded while profiles are off
+	if (!FLOW_KNOBS || FLOW_KNOBS->ARENA_PROFILE_MAX_RESERVED_BYTES <= 0) {
+		return;
+	}
+	int64_t used = arena.getUsedSize();
+	int64_t size = arena.getSize();
+
+	// Tracks the 90th percentile of the used sizes: each arena that outgrew the estimate raises it 9 times as much as
+	// each arena that fit lowers it, so it settles where 10% of arenas outgrow it. Updates racing between threads may
+	// be lost, which only slows this down.
+	double e = estimate.load(std::memory_order_relaxed);
+	estimate.store(e == 0 ? used : used > e ? e * 1.018 : e * 0.998, std::memory_order_relaxed);
+
+	arenas.fetch_add(1, std::memory_order_relaxed);
+	usedBytes.fetch_add(used, std::memory_order_relaxed);
+	slackBytes.fetch_add(size - used, std::memory_order_relaxed);
+}
+
+void ArenaProfile::traceAll() {
+	for (ArenaProfile* p = arenaProfiles.load(); p; p = p->next) {
+		int64_t arenas = p->arenas.exchange(0, std::memory_order_relaxed);
+		if (arenas == 0) {
+			continue;
 		}
+		TraceEvent("ArenaProfile")
+		    .detail("Name", p->name)
+		    .detail("Arenas", arenas)
+		    .detail("UsedBytes", p->usedBytes.exchange(0, std::memory_order_relaxed))
+		    .detail("SlackBytes", p->slackBytes.exchange(0, std::memory_order_relaxed))
+		    .detail("Estimate", int64_t(p->estimate.load(std::memory_order_relaxed)));
 	}
 }
 
@@ -649,4 +802,46 @@ TEST_CASE("/flow/Arena/DefaultBoostHash") {
 	ASSERT(hashFunc(d) == hashFunc(d));
 
 	return Void();
-}
\ No newline at end of file
+}
+
+TEST_CASE("/flow/Arena/ArenaProfile") {
+	static ArenaProfile profile("UnitTest");
+	for (int i = 0; i < 1000; i++) {
+		Arena arena = profile.newArena();
+		new (arena) uint8_t[deterministicRandom()->randomInt(1000, 10000)];
+		profile.record(arena);
+	}
+
+	// About nine in ten arenas built like these fit in their first block
+	int fit = 0;
+	for (int i = 0; i < 1000; i++) {
+		Arena arena = profile.newArena();
+		size_t size = arena.getSize();
+		new (arena) uint8_t[deterministicRandom()->randomInt(1000, 10000)];
+		fit += arena.getSize() == size;
+	}
+	ASSERT(FLOW_KNOBS->ARENA_PROFILE_MAX_RESERVED_BYTES < 10000 || fit > 750);
+
+	return Void();
+}
+
+TEST_CASE("/flow/Arena/HugeBlockPool") {
+	if (FLOW_KNOBS->ARENA_BLOCK_POOL_BYTES < 20480) {
+		return Void();
+	}
+
+	void* first;
+	{
+		Arena arena(20000);
+		// The block is rounded up to its size class, and the arena can use the difference. Sanitizer and valgrind
+		// builds don't pool blocks.
+		if (arena.getSize() != 20480) {
+			return Void();
+		}
+		first = new (arena) uint8_t[20000];
+	}
+	Arena arena(19000);
+	ASSERT(new (arena) uint8_t[19000] == first);
+
+	return Void();
+}
@@ -105,6 +105,8 @@ public:
 	void dependsOn(const Arena& p);
 	void* allocate4kAlignedBuffer(uint32_t size);
 	size_t getSize() const;
+	// The part of getSize() that has been allocated
+	size_t getUsedSize() const;
 
 	bool hasFree(size_t size, const void* address);
 
@@ -117,6 +119,38 @@ private:
 	Reference<struct ArenaBlock> impl;
 };
 
+// Memory held by the per-thread pools of freed arena blocks that are too large for FastAllocator
+extern std::atomic<int64_t> g_arenaBlockPoolMemory;
+
+// Remembers how large the arenas built at one call site grow, so that new ones can start with a single block of about
+// the size they will need instead of growing through several, and reports the memory they leave unused. Declare one
+// as a static at the call site:
+//
+//   static ArenaProfile profile("GetKeyValuesReply");
+//   reply.arena = profile.newArena();
+//   ... build the reply ...
+//   profile.record(reply.arena);
+class ArenaProfile : NonCopyable {
+public:
+	explicit ArenaProfile(const char* name);
+
+	// Returns an arena whose first block is about as large as 90% of the recorded arenas needed
+	Arena newArena() const;
+	// Records the final size of an arena built at this call site. Does nothing if ARENA_PROFILE_MAX_RESERVED_BYTES is 0.
+	void record(const Arena& arena);
+
+	// Logs an ArenaProfile event for each profile with its activity since the last call
+	static void traceAll();
+
+private:
+	const char* name;
+	std::atomic<double> estimate;
+	std::atomic<int64_t> arenas;
+	std::atomic<int64_t> usedBytes;
+	std::atomic<int64_t> slackBytes;
+	ArenaProfile* next;
+};
+
 template <>
 struct scalar_traits<Arena> : std::true_type {
 	constexpr static size_t size = 0;
@@ -166,6 +200,7 @@ struct ArenaBlock : NonCopyable, ThreadSafeReferenceCounted<ArenaBlock> {
 	const void* getData() const;
 	const void* getNextData() const;
 	size_t totalSize();
+	size_t totalUsed();
 	// just for debugging:
 	void getUniqueBlocks(std::set<ArenaBlock*>& a);
 	int addUsed(int bytes);
@@ -0,0 +1,336 @@
+/*
+ * BinaryTraceLogFormatter.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2022 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/flow.h"
+#include "flow/BinaryTraceLogFormatter.h"
+#include "flow/UnitTest.h"
+
+#include <cstring>
+
+namespace {
+
+enum ValueTag : uint8_t { String = 0, StringId = 1, Integer = 2, DoubleG = 3, DoubleFixed = 4 };
+
+// Short values are interned so that repeated ones (types, addresses, roles, IDs) are written once per file. The limit
+// keeps a file of unique values from growing the table without bound.
+constexpr int maxInternedValueLength = 64;
+constexpr size_t maxStrings = 1 << 16;
+
+void appendVarint(std::string& out, uint64_t v) {
+	while (v >= 0x80) {
+		out.push_back(char(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back(char(v));
+}
+
+bool isInteger(const std::string& s) {
+	size_t i = s.size() && s[0] == '-' ? 1 : 0;
+	size_t digits = s.size() - i;
+	if (digits == 0 || digits > 18 || (s[i] == '0' && (digits > 1 || i == 1))) {
+		return false;
+	}
+	for (; i < s.size(); i++) {
+		if (s[i] < '0' || s[i] > '9') {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool mayBeDouble(const std::string& s) {
+	if (s.empty() || s.size() > 24) {
+		return false;
+	}
+	for (char c : s) {
+		if (!((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == '-' || c == '+')) {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct Reader {
+	const uint8_t* p;
+	const uint8_t* end;
+
+	bool varint(uint64_t& v) {
+		v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (p == end) {
+				return false;
+			}
+			uint8_t b = *p++;
+			v |= uint64_t(b & 0x7f) << shift;
+			if (!(b & 0x80)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool bytes(size_t n, std::string& out) {
+		if (size_t(end - p) < n) {
+			return false;
+		}
+		out.assign((const char*)p, n);
+		p += n;
+		return true;
+	}
+
+	bool doubleValue(double& d) {
+		if (end - p < 8) {
+			return false;
+		}
+		memcpy(&d, p, 8);
+		p += 8;
+		return true;
+	}
+};
+
+} // namespace
+
+void BinaryTraceLogFormatter::addref() {
+	ReferenceCounted<BinaryTraceLogFormatter>::addref();
+}
+
+void BinaryTraceLogFormatter::delref() {
+	ReferenceCounted<BinaryTraceLogFormatter>::delref();
+}
+
+const char* BinaryTraceLogFormatter::getExtension() const {
+	return "btrace";
+}
+
+const char* BinaryTraceLogFormatter::getHeader() const {
+	strings.clear();
+	schemas.clear();
+	return header;
+}
+
+const char* BinaryTraceLogFormatter::getFooter() const {
+	return "";
+}
+
+uint32_t BinaryTraceLogFormatter::defineString(std::string& out, const std::string& s) const {
+	auto it = strings.find(s);
+	if (it != strings.end()) {
+		return it->second;
+	}
+	uint32_t id = strings.size();
+	strings[s] = id;
+	out.push_back('D');
+	appendVarint(out, s.size());
+	out.append(s);
+	return id;
+}
+
+void BinaryTraceLogFormatter::formatValue(std::string& definitions, std::string& out, const std::string& value) const {
+	if (isInteger(value)) {
+		int64_t v = strtoll(value.c_str(), nullptr, 10);
+		out.push_back(Integer);
+		appendVarint(out, (uint64_t(v) << 1) ^ uint64_t(v >> 63));
+		return;
+	}
+
+	if (mayBeDouble(value)) {
+		char* end;
+		double d = strtod(value.c_str(), &end);
+		if (*end == '\0') {
+			ValueTag tag = value == format("%g", d) ? DoubleG : value == format("%.6f", d) ? DoubleFixed : String;
+			if (tag != String) {
+				out.push_back(tag);
+				out.append((const char*)&d, sizeof(d));
+				return;
+			}
+		}
+	}
+
+	auto it = strings.find(value);
+	if (it == strings.end() && value.size() <= maxInternedValueLength && strings.size() < maxStrings) {
+		defineString(definitions, value);
+		it = strings.find(value);
+	}
+	if (it != strings.end()) {
+		out.push_back(StringId);
+		appendVarint(out, it->second);
+	} else {
+		out.push_back(String);
+		appendVarint(out, value.size());
+		out.append(value);
+	}
+}
+
+std::string BinaryTraceLogFormatter::formatEvent(const TraceEventFields& fields) const {
+	std::string out;
+
+	schema.clear();
+	for (auto const& field : fields) {
+		schema.push_back(defineString(out, field.first));
+	}
+	auto s = schemas.find(schema);
+	if (s == schemas.end()) {
+		s = schemas.emplace(schema, schemas.size()).first;
+		out.push_back('S');
+		appendVarint(out, schema.size());
+		for (uint32_t id : schema) {
+			appendVarint(out, id);
+		}
+	}
+
+	// Strings first used by the values are defined ahead of the event record
+	std::string values;
+	for (auto const& field : fields) {
+		formatValue(out, values, field.second);
+	}
+	out.push_back('E');
+	appendVarint(out, s->second);
+	out.append(values);
+	return out;
+}
+
+bool decodeBinaryTraceLog(const std::string& data, std::vector<TraceEventFields>& events) {
+	size_t headerLength = strlen(BinaryTraceLogFormatter::header);
+	if (data.compare(0, headerLength, BinaryTraceLogFormatter::header) != 0) {
+		return false;
+	}
+
+	std::vector<std::string> strings;
+	std::vector<std::vector<uint32_t>> schemas;
+	Reader r{ (const uint8_t*)data.data() + headerLength, (const uint8_t*)data.data() + data.size() };
+	while (r.p != r.end) {
+		char type = *r.p++;
+		uint64_t v;
+		if (type == 'D') {
+			std::string s;
+			if (!r.varint(v) || !r.bytes(v, s)) {
+				return true;
+			}
+			strings.push_back(std::move(s));
+		} else if (type == 'S') {
+			std::vector<uint32_t> schema;
+			if (!r.varint(v)) {
+				return true;
+			}
+			for (uint64_t count = v; count > 0; count--) {
+				if (!r.varint(v)) {
+					return true;
+				}
+				if (v >= strings.size()) {
+					return false;
+				}
+				schema.push_back(v);
+			}
+			schemas.push_back(std::move(schema));
+		} else if (type == 'E') {
+			if (!r.varint(v)) {
+				return true;
+			}
+			if (v >= schemas.size()) {
+				return false;
+			}
+			TraceEventFields fields;
+			for (uint32_t name : schemas[v]) {
+				if (r.p == r.end) {
+					return true;
+				}
+				uint8_t tag = *r.p++;
+				std::string value;
+				double d;
+				if (tag == String) {
+					if (!r.varint(v) || !r.bytes(v, value)) {
+						return true;
+					}
+				} else if (tag == StringId) {
+					if (!r.varint(v)) {
+						return true;
+					}
+					if (v >= strings.size()) {
+						return false;
+					}
+					value = strings[v];
+				} else if (tag == Integer) {
+					if (!r.varint(v)) {
+						return true;
+					}
+					value = std::to_string(int64_t(v >> 1) ^ -int64_t(v & 1));
+				} else if (tag == DoubleG || tag == DoubleFixed) {
+					if (!r.doubleValue(d)) {
+						return true;
+					}
+					value = format(tag == DoubleG ? "%g" : "%.6f", d);
+				} else {
+					return false;
+				}
+				fields.addField(strings[name], std::move(value));
+			}
+			events.push_back(std::move(fields));
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST_CASE("/flow/BinaryTraceLogFormatter/RoundTrip") {
+	BinaryTraceLogFormatter formatter;
+	std::string file = formatter.getHeader();
+	std::vector<TraceEventFields> logged;
+
+	for (int i = 0; i < 100; i++) {
+		TraceEventFields fields;
+		fields.addField("Severity", "10");
+		fields.addField("Time", format("%.6f", deterministicRandom()->random01() * 1e6));
+		fields.addField("Type", deterministicRandom()->coinflip() ? "TestEvent" : "OtherTestEvent");
+		fields.addField("ID", deterministicRandom()->randomUniqueID().shortString());
+		fields.addField("Count", std::to_string(deterministicRandom()->randomInt64(-1e12, 1e12)));
+		fields.addField("Ratio", format("%g", deterministicRandom()->random01()));
+		fields.addField("Padded", "007");
+		fields.addField("Long", std::string(deterministicRandom()->randomInt(0, 200), 'x'));
+		if (deterministicRandom()->coinflip()) {
+			fields.addField("Optional", "-0");
+		}
+		file += formatter.formatEvent(fields);
+		logged.push_back(fields);
+	}
+
+	std::vector<TraceEventFields> decoded;
+	ASSERT(decodeBinaryTraceLog(file, decoded));
+	ASSERT(decoded.size() == logged.size());
+	for (int i = 0; i < logged.size(); i++) {
+		ASSERT(decoded[i].toString() == logged[i].toString());
+	}
+
+	// A truncated last event is dropped
+	decoded.clear();
+	ASSERT(decodeBinaryTraceLog(file.substr(0, file.size() - 1), decoded));
+	ASSERT(decoded.size() == logged.size() - 1);
+
+	// Starting a new file starts new string and schema tables
+	std::string file2 = formatter.getHeader();
+	file2 += formatter.formatEvent(logged[0]);
+	decoded.clear();
+	ASSERT(decodeBinaryTraceLog(file2, decoded));
+	ASSERT(decoded.size() == 1 && decoded[0].toString() == logged[0].toString());
+
+	ASSERT(!decodeBinaryTraceLog("<?xml version=\"1.0\"?>", decoded));
+
+	return Void();
+}
@@ -0,0 +1,76 @@
+/*
+ * BinaryTraceLogFormatter.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2022 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOW_BINARY_TRACE_LOG_FORMATTER_H
+#define FLOW_BINARY_TRACE_LOG_FORMATTER_H
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "flow/FastRef.h"
+#include "flow/Trace.h"
+
+// A compact trace file format. Each file starts with the header below and is followed by records:
+//
+//   'D' <varint length> <bytes>           Defines the next string id (field names and repeated short values)
+//   'S' <varint count> <varint string id>* Defines the next schema id as an ordered list of field names
+//   'E' <varint schema id> <value>*        An event with one value per field of its schema
+//
+// A value is a tag byte followed by its payload:
+//
+//   0 <varint length> <bytes>  A string
+//   1 <varint string id>       A previously defined string
+//   2 <zigzag varint>          An integer, printed in decimal
+//   3 <8 byte double>          A double, printed with "%g"
+//   4 <8 byte double>          A double, printed with "%.6f"
+//
+// Numbers are only stored in binary when they print back to exactly the original text, so decoding a file reproduces
+// the fields that were logged. String and schema ids start over in each file.
+struct BinaryTraceLogFormatter final : public ITraceLogFormatter, ReferenceCounted<BinaryTraceLogFormatter> {
+	static constexpr const char* header = "FDBBinaryTrace1\n";
+
+	void addref() override;
+	void delref() override;
+
+	const char* getExtension() const override;
+	const char* getHeader() const override;
+	const char* getFooter() const override;
+
+	std::string formatEvent(const TraceEventFields& fields) const override;
+
+private:
+	// Only used by the trace writer thread. getHeader() starts a new file and so resets them.
+	mutable std::unordered_map<std::string, uint32_t> strings;
+	mutable std::map<std::vector<uint32_t>, uint32_t> schemas;
+	mutable std::vector<uint32_t> schema;
+
+	uint32_t defineString(std::string& out, const std::string& s) const;
+	void formatValue(std::string& definitions, std::string& out, const std::string& value) const;
+};
+
+// Decodes a binary trace file into events that can be given to the XML or JSON formatters. A truncated last record,
+// such as one being written when the process died, is ignored. Returns false if data is not a binary trace file or is
+// corrupt, in which case events holds what was decoded before the problem.
+bool decodeBinaryTraceLog(const std::string& data, std::vector<TraceEventFields>& events);
+
+#endif
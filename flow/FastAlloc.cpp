@@ -29,6 +29,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <thread>
 #include <unordered_map>
 
 //#ifdef WIN32
@@ -48,6 +49,14 @@
 
 #define FAST_ALLOCATOR_DEBUG 0
 
+// Slab mode carves magazines out of huge page slabs and gives fully free slabs back with madvise(), which needs the
+// free lists to be walkable outside of the allocating thread
+#if defined(__linux__) && !FAST_ALLOCATOR_DEBUG && !defined(VALGRIND)
+#define FAST_ALLOCATOR_SLABS 1
+#else
+#define FAST_ALLOCATOR_SLABS 0
+#endif
+
 #ifdef _MSC_VER
 // warning 4073 warns about "initializers put in library initialization area", which is our intent
 #pragma warning(disable : 4073)
@@ -252,7 +261,19 @@ struct FastAllocator<Size>::GlobalData {
 	std::atomic<long long> totalMemory;
 	long long partialMagazineUnallocatedMemory;
 	std::atomic<long long> activeThreads;
-	GlobalData() : totalMemory(0), partialMagazineUnallocatedMemory(0), activeThreads(0) {
+
+	// Slab mode (FAST_ALLOC_SLABS)
+	std::unordered_map<uintptr_t, int> slabs; // Slab address -> number of magazines carved from it
+	std::vector<uintptr_t> releasedSlabs; // Slabs returned to the OS, which are carved again before mapping new ones
+	uintptr_t currentSlab; // The slab magazines are being carved from, or 0
+	bool releasingSlabs;
+	std::atomic<long long> slabMemory; // Part of totalMemory
+	std::atomic<long long> releasedSlabMemory; // Total over the life of the process
+	std::atomic<long long> slabFragmentedMemory; // Unused memory in slabs that could not be released last time
+
+	GlobalData()
+	  : totalMemory(0), partialMagazineUnallocatedMemory(0), activeThreads(0), currentSlab(0), releasingSlabs(false),
+	    slabMemory(0), releasedSlabMemory(0), slabFragmentedMemory(0) {
 		InitializeCriticalSection(&mutex);
 	}
 };
@@ -277,6 +298,21 @@ long long FastAllocator<Size>::getActiveThreads() {
 	return globalData()->activeThreads.load();
 }
 
+template <int Size>
+long long FastAllocator<Size>::getSlabMemory() {
+	return globalData()->slabMemory.load();
+}
+
+template <int Size>
+long long FastAllocator<Size>::getReleasedSlabMemory() {
+	return globalData()->releasedSlabMemory.load();
+}
+
+template <int Size>
+long long FastAllocator<Size>::getSlabFragmentedMemory() {
+	return globalData()->slabFragmentedMemory.load();
+}
+
 #if FAST_ALLOCATOR_DEBUG
 static int64_t getSizeCode(int i) {
 	switch (i) {
@@ -498,6 +534,12 @@ void FastAllocator<Size>::getMagazine() {
 		return;
 	}
 	globalData()->totalMemory.fetch_add(magazine_size * Size);
+	void** block = nullptr;
+#if FAST_ALLOCATOR_SLABS
+	if (FLOW_KNOBS && FLOW_KNOBS->FAST_ALLOC_SLABS) {
+		block = (void**)carveSlabMagazine();
+	}
+#endif
 	LeaveCriticalSection(&globalData()->mutex);
 
 // Allocate a new page of data from the system allocator
@@ -505,7 +547,6 @@ void FastAllocator<Size>::getMagazine() {
 	interlockedIncrement(&pageCount);
 #endif
 
-	void** block = nullptr;
 #if FAST_ALLOCATOR_DEBUG
 #ifdef WIN32
 	static int alt = 0;
@@ -524,16 +565,17 @@ void FastAllocator<Size>::getMagazine() {
 	ASSERT(block == desiredBlock);
 #endif
 #else
-	// FIXME: We should be able to allocate larger magazine sizes here if we
-	// detect that the underlying system supports hugepages.  Using hugepages
-	// with smaller-than-2MiB magazine sizes strands memory.  See issue #909.
+	// Without FAST_ALLOC_SLABS, magazines are allocated one at a time on small pages; using hugepages with
+	// smaller-than-2MiB magazine sizes strands memory.  See issue #909.
 	if (FLOW_KNOBS && g_allocation_tracing_disabled == 0 &&
 	    nondeterministicRandom()->random01() < (magazine_size * Size) / FLOW_KNOBS->FAST_ALLOC_LOGGING_BYTES) {
 		++g_allocation_tracing_disabled;
 		TraceEvent("GetMagazineSample").detail("Size", Size).backtrace();
 		--g_allocation_tracing_disabled;
 	}
-	block = (void**)::allocate(magazine_size * Size, false);
+	if (!block) {
+		block = (void**)::allocate(magazine_size * Size, false);
+	}
 #endif
 
 	// void** block = new void*[ magazine_size * PSize ];
@@ -554,6 +596,183 @@ void FastAllocator<Size>::releaseMagazine(void* mag) {
 	globalData()->magazines.push_back(mag);
 	LeaveCriticalSection(&globalData()->mutex);
 }
+#if FAST_ALLOCATOR_SLABS
+static bool explicitHugePagesFailed = false;
+
+// Maps a slab aligned to its size, so that the slab an item belongs to can be found from its address
+static void* mapSlab(size_t size) {
+	if (FLOW_KNOBS->FAST_ALLOC_SLAB_EXPLICIT_HUGE_PAGES && !explicitHugePagesFailed) {
+		// Explicit huge page mappings are always aligned to the huge page size
+		void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) {
+			return p;
+		}
+		explicitHugePagesFailed = true;
+	}
+
+	char* p = (char*)mmap(nullptr, 2 * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		return nullptr;
+	}
+	char* slab = (char*)(((uintptr_t)p + size - 1) & ~(uintptr_t)(size - 1));
+	if (slab > p) {
+		munmap(p, slab - p);
+	}
+	if (slab + size < p + 2 * size) {
+		munmap(slab + size, p + 2 * size - (slab + size));
+	}
+#ifdef MADV_HUGEPAGE
+	madvise(slab, size, MADV_HUGEPAGE);
+#endif
+	return slab;
+}
+#endif
+
+// Called with globalData()->mutex held. Returns the next magazine of the current slab, or nullptr if no slab could be
+// mapped. Magazines are carved lazily so that only the part of a slab that is in use has to be resident.
+template <int Size>
+void* FastAllocator<Size>::carveSlabMagazine() {
+#if FAST_ALLOCATOR_SLABS
+	GlobalData* data = globalData();
+	if (!data->currentSlab) {
+		if (data->releasedSlabs.size()) {
+			data->currentSlab = data->releasedSlabs.back();
+			data->releasedSlabs.pop_back();
+		} else {
+			data->currentSlab = (uintptr_t)mapSlab(slab_size);
+			if (!data->currentSlab) {
+				return nullptr;
+			}
+		}
+	}
+
+	int& carved = data->slabs[data->currentSlab];
+	void* magazine = (void*)(data->currentSlab + (uintptr_t)carved * magazine_size * Size);
+	if (++carved == magazines_per_slab) {
+		data->currentSlab = 0;
+	}
+	data->slabMemory.fetch_add(magazine_size * Size);
+	return magazine;
+#else
+	return nullptr;
+#endif
+}
+
+// Gives slabs whose items are all sitting in the global magazines back to the OS, if the global magazines hold at least
+// FAST_ALLOC_SLAB_RELEASE_UNUSED_BYTES. Items cached by threads keep their slabs resident. The free lists are walked
+// outside of the mutex, so other threads keep allocating (from new magazines) while this runs.
+template <int Size>
+long long FastAllocator<Size>::releaseUnusedSlabs() {
+#if FAST_ALLOCATOR_SLABS
+	GlobalData* data = globalData();
+	std::vector<void*> magazines;
+	std::vector<std::pair<int, void*>> partialMagazines;
+	// Slab address -> (magazines carved, free items found)
+	std::unordered_map<uintptr_t, std::pair<int, int>> slabs;
+
+	EnterCriticalSection(&data->mutex);
+	long long unused = data->magazines.size() * magazine_size * Size + data->partialMagazineUnallocatedMemory;
+	if (data->releasingSlabs || data->slabs.empty() || unused < FLOW_KNOBS->FAST_ALLOC_SLAB_RELEASE_UNUSED_BYTES) {
+		LeaveCriticalSection(&data->mutex);
+		return 0;
+	}
+	data->releasingSlabs = true;
+	magazines.swap(data->magazines);
+	partialMagazines.swap(data->partial_magazines);
+	data->partialMagazineUnallocatedMemory = 0;
+	for (auto const& [slab, carved] : data->slabs) {
+		// The current slab is still being carved by other threads
+		if (slab != data->currentSlab && carved > 0) {
+			slabs[slab] = std::make_pair(carved, 0);
+		}
+	}
+	LeaveCriticalSection(&data->mutex);
+
+	auto slabOf = [](void* p) { return (uintptr_t)p & ~(uintptr_t)(slab_size - 1); };
+	// Calls f on every free item taken from the global magazines; f may overwrite the item's link
+	auto forEachItem = [&](auto f) {
+		for (void* m : magazines) {
+			for (void *p = m, *next; p; p = next) {
+				next = *(void**)p;
+				f(p);
+			}
+		}
+		for (auto const& m : partialMagazines) {
+			for (void *p = m.second, *next; p; p = next) {
+				next = *(void**)p;
+				f(p);
+			}
+		}
+	};
+
+	forEachItem([&](void* p) {
+		auto s = slabs.find(slabOf(p));
+		if (s != slabs.end()) {
+			s->second.second++;
+		}
+	});
+
+	std::vector<uintptr_t> released;
+	long long releasedMemory = 0;
+	long long fragmentedMemory = 0;
+	for (auto const& [slab, counts] : slabs) {
+		if (counts.second == counts.first * magazine_size) {
+			released.push_back(slab);
+			releasedMemory += (long long)counts.first * magazine_size * Size;
+		} else {
+			fragmentedMemory += (long long)counts.second * Size;
+		}
+	}
+
+	// Relink the items of the slabs that are kept into magazines
+	std::vector<void*> keptMagazines;
+	std::vector<std::pair<int, void*>> keptPartialMagazines;
+	void* head = nullptr;
+	int count = 0;
+	forEachItem([&](void* p) {
+		auto s = slabs.find(slabOf(p));
+		if (s != slabs.end() && s->second.second == s->second.first * magazine_size) {
+			return;
+		}
+		*(void**)p = head;
+		head = p;
+		if (++count == magazine_size) {
+			keptMagazines.push_back(head);
+			head = nullptr;
+			count = 0;
+		}
+	});
+	if (count) {
+		keptPartialMagazines.emplace_back(count, head);
+	}
+
+	for (uintptr_t slab : released) {
+		madvise((void*)slab, slab_size, MADV_DONTNEED);
+	}
+
+	EnterCriticalSection(&data->mutex);
+	data->magazines.insert(data->magazines.end(), keptMagazines.begin(), keptMagazines.end());
+	for (auto const& m : keptPartialMagazines) {
+		data->partial_magazines.push_back(m);
+		data->partialMagazineUnallocatedMemory += m.first * Size;
+	}
+	for (uintptr_t slab : released) {
+		data->slabs.erase(slab);
+		data->releasedSlabs.push_back(slab);
+	}
+	data->totalMemory.fetch_sub(releasedMemory);
+	data->slabMemory.fetch_sub(releasedMemory);
+	data->releasedSlabMemory.fetch_add(releasedMemory);
+	data->slabFragmentedMemory = fragmentedMemory;
+	data->releasingSlabs = false;
+	LeaveCriticalSection(&data->mutex);
+
+	return releasedMemory;
+#else
+	return 0;
+#endif
+}
+
 template <int Size>
 void FastAllocator<Size>::releaseThreadMagazines() {
 	if (threadInitialized) {
@@ -595,6 +814,103 @@ void releaseAllThreadMagazines() {
 	FastAllocator<16384>::releaseThreadMagazines();
 }
 
+#if FAST_ALLOCATOR_SLABS
+static std::atomic<bool> releasingUnusedSlabs(false);
+static std::atomic<int64_t> releasedUnusedSlabMemory(0);
+
+static int64_t releaseUnusedSlabsOfAllSizes() {
+	int64_t releasedMemory = 0;
+
+	releasedMemory += FastAllocator<16>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<32>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<64>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<96>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<128>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<256>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<512>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<1024>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<2048>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<4096>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<8192>::releaseUnusedSlabs();
+	releasedMemory += FastAllocator<16384>::releaseUnusedSlabs();
+
+	return releasedMemory;
+}
+#endif
+
+int64_t releaseUnusedFastAllocatorSlabs() {
+#if FAST_ALLOCATOR_SLABS
+	// Walking the free lists of a large process takes long enough to stall the caller's run loop, so it is done on a
+	// thread of its own, one pass at a time
+	if (FLOW_KNOBS->FAST_ALLOC_SLABS && !releasingUnusedSlabs.exchange(true)) {
+		std::thread([] {
+			releasedUnusedSlabMemory.fetch_add(releaseUnusedSlabsOfAllSizes());
+			releasingUnusedSlabs.store(false);
+		}).detach();
+	}
+	return releasedUnusedSlabMemory.exchange(0);
+#else
+	return 0;
+#endif
+}
+
+int64_t getTotalSlabMemory() {
+	int64_t slabMemory = 0;
+
+	slabMemory += FastAllocator<16>::getSlabMemory();
+	slabMemory += FastAllocator<32>::getSlabMemory();
+	slabMemory += FastAllocator<64>::getSlabMemory();
+	slabMemory += FastAllocator<96>::getSlabMemory();
+	slabMemory += FastAllocator<128>::getSlabMemory();
+	slabMemory += FastAllocator<256>::getSlabMemory();
+	slabMemory += FastAllocator<512>::getSlabMemory();
+	slabMemory += FastAllocator<1024>::getSlabMemory();
+	slabMemory += FastAllocator<2048>::getSlabMemory();
+	slabMemory += FastAllocator<4096>::getSlabMemory();
+	slabMemory += FastAllocator<8192>::getSlabMemory();
+	slabMemory += FastAllocator<16384>::getSlabMemory();
+
+	return slabMemory;
+}
+
+int64_t getTotalReleasedSlabMemory() {
+	int64_t releasedMemory = 0;
+
+	releasedMemory += FastAllocator<16>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<32>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<64>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<96>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<128>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<256>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<512>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<1024>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<2048>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<4096>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<8192>::getReleasedSlabMemory();
+	releasedMemory += FastAllocator<16384>::getReleasedSlabMemory();
+
+	return releasedMemory;
+}
+
+int64_t getTotalSlabFragmentedMemory() {
+	int64_t fragmentedMemory = 0;
+
+	fragmentedMemory += FastAllocator<16>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<32>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<64>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<96>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<128>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<256>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<512>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<1024>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<2048>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<4096>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<8192>::getSlabFragmentedMemory();
+	fragmentedMemory += FastAllocator<16384>::getSlabFragmentedMemory();
+
+	return fragmentedMemory;
+}
+
 int64_t getTotalUnusedAllocatedMemory() {
 	int64_t unusedMemory = 0;
 
@@ -113,8 +113,12 @@ public:
 	static long long getTotalMemory();
 	static long long getApproximateMemoryUnused();
 	static long long getActiveThreads();
+	static long long getSlabMemory();
+	static long long getReleasedSlabMemory();
+	static long long getSlabFragmentedMemory();
 
 	static void releaseThreadMagazines();
+	static long long releaseUnusedSlabs();
 
 #ifdef ALLOC_INSTRUMENTATION
 	static volatile int32_t pageCount;
@@ -129,6 +133,8 @@ private:
 
 	static const int magazine_size = (128 << 10) / Size;
 	static const int PSize = Size / sizeof(void*);
+	static const int slab_size = 2 << 20; // One huge page
+	static const int magazines_per_slab = slab_size / (magazine_size * Size);
 	struct GlobalData;
 	struct ThreadData {
 		void* freelist;
@@ -154,12 +160,20 @@ private:
 	static void initThread();
 	static void getMagazine();
 	static void releaseMagazine(void*);
+	static void* carveSlabMagazine();
 };
 
 extern std::atomic<int64_t> g_hugeArenaMemory;
 void hugeArenaSample(int size);
 void releaseAllThreadMagazines();
 int64_t getTotalUnusedAllocatedMemory();
+// Starts returning fully free FastAllocator slabs to the OS, on a background thread, for each size whose unused memory
+// exceeds FAST_ALLOC_SLAB_RELEASE_UNUSED_BYTES, unless that is already in progress. Returns the number of bytes released
+// by passes that finished since the previous call.
+int64_t releaseUnusedFastAllocatorSlabs();
+int64_t getTotalSlabMemory();
+int64_t getTotalReleasedSlabMemory();
+int64_t getTotalSlabFragmentedMemory();
 void setFastAllocatorThreadInitFunction(
     void (*)()); // The given function will be called at least once in each thread that allocates from a FastAllocator.
                  // Currently just one such function is tracked.
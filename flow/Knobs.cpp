@@ -64,8 +64,13 @@ void FlowKnobs::initialize(Randomize randomize, IsSimulated isSimulated) {
 
 	init( RANDOMSEED_RETRY_LIMIT,                                4 );
 	init( FAST_ALLOC_LOGGING_BYTES,                           10e6 );
+	init( FAST_ALLOC_SLABS,                                  false ); if( randomize && BUGGIFY ) FAST_ALLOC_SLABS = true; // Only takes effect on Linux
+	init( FAST_ALLOC_SLAB_EXPLICIT_HUGE_PAGES,               false ); // Falls back to transparent huge pages if none are reserved
+	init( FAST_ALLOC_SLAB_RELEASE_UNUSED_BYTES,              256e6 );
 	init( HUGE_ARENA_LOGGING_BYTES,                          100e6 );
 	init( HUGE_ARENA_LOGGING_INTERVAL,                         5.0 );
+	init( ARENA_PROFILE_MAX_RESERVED_BYTES,                      0 ); if( randomize && BUGGIFY ) ARENA_PROFILE_MAX_RESERVED_BYTES = 1 << 20; // 0 is off
+	init( ARENA_BLOCK_POOL_BYTES,                                0 ); if( randomize && BUGGIFY ) ARENA_BLOCK_POOL_BYTES = 16e6; // Per thread, 0 is off
 
 	// Chaos testing - enabled for simulation by default
 	init( ENABLE_CHAOS_FEATURES,                       isSimulated );
@@ -150,6 +155,10 @@ void FlowKnobs::initialize(Randomize randomize, IsSimulated isSimulated) {
 	init( PAGE_WRITE_CHECKSUM_HISTORY,                           0 ); if( randomize && BUGGIFY ) PAGE_WRITE_CHECKSUM_HISTORY = 10000000;
 	init( DISABLE_POSIX_KERNEL_AIO,                              0 );
 
+	//AsyncFileIOUring
+	init( ENABLE_IO_URING,                                       0 ); // Only takes effect in builds with WITH_LIBURING
+	init( IO_URING_FIXED_FILES,                                256 );
+
 	//AsyncFileNonDurable
 	init( NON_DURABLE_MAX_WRITE_DELAY,                         2.0 ); if( randomize && BUGGIFY ) NON_DURABLE_MAX_WRITE_DELAY = 5.0;
 	init( MAX_PRIOR_MODIFICATION_DELAY,                        1.0 ); if( randomize && BUGGIFY ) MAX_PRIOR_MODIFICATION_DELAY = 10.0;
@@ -182,6 +191,7 @@ void FlowKnobs::initialize(Randomize randomize, IsSimulated isSimulated) {
 	init( MIN_PACKET_BUFFER_FREE_BYTES,                        256 );
 	init( FLOW_TCP_NODELAY,                                      1 );
 	init( FLOW_TCP_QUICKACK,                                     0 );
+	init( ZERO_COPY_SEND_MIN_BYTES,                              0 ); // 64 * 1024 is a reasonable threshold where supported
 
 	//Sim2
 	init( MIN_OPEN_TIME,                                    0.0002 );
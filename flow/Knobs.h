@@ -113,8 +113,13 @@ public:
 
 	int RANDOMSEED_RETRY_LIMIT;
 	double FAST_ALLOC_LOGGING_BYTES;
+	bool FAST_ALLOC_SLABS;
+	bool FAST_ALLOC_SLAB_EXPLICIT_HUGE_PAGES;
+	int64_t FAST_ALLOC_SLAB_RELEASE_UNUSED_BYTES;
 	double HUGE_ARENA_LOGGING_BYTES;
 	double HUGE_ARENA_LOGGING_INTERVAL;
+	int ARENA_PROFILE_MAX_RESERVED_BYTES;
+	int64_t ARENA_BLOCK_POOL_BYTES;
 
 	// Chaos testing
 	bool ENABLE_CHAOS_FEATURES;
@@ -204,6 +209,10 @@ public:
 	int PAGE_WRITE_CHECKSUM_HISTORY;
 	int DISABLE_POSIX_KERNEL_AIO;
 
+	// AsyncFileIOUring
+	int ENABLE_IO_URING;
+	int IO_URING_FIXED_FILES;
+
 	// AsyncFileNonDurable
 	double NON_DURABLE_MAX_WRITE_DELAY;
 	double MAX_PRIOR_MODIFICATION_DELAY;
@@ -237,6 +246,7 @@ public:
 	int MIN_PACKET_BUFFER_FREE_BYTES;
 	int FLOW_TCP_NODELAY;
 	int FLOW_TCP_QUICKACK;
+	int ZERO_COPY_SEND_MIN_BYTES; // 0 disables MSG_ZEROCOPY sends
 
 	// Sim2
 	// FIMXE: more parameters could be factored out
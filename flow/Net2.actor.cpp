@@ -57,6 +57,15 @@
 #ifdef WIN32
 #include <mmsystem.h>
 #endif
+#ifdef __linux__
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <linux/errqueue.h>
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define FLOW_ZERO_COPY_SEND 1
+#endif
+#endif
 #include "flow/actorcompiler.h" // This must be the last #include.
 
 // Defined to track the stack limit
@@ -399,6 +408,8 @@ public:
 	explicit Connection(boost::asio::io_service& io_service)
 	  : id(nondeterministicRandom()->randomUniqueID()), socket(io_service) {}
 
+	~Connection() { releaseZeroCopySends(); }
+
 	// This is not part of the IConnection interface, because it is wrapped by INetwork::connect()
 	ACTOR static Future<Reference<IConnection>> connect(boost::asio::io_service* ios, NetworkAddress addr) {
 		state Reference<Connection> self(new Connection(*ios));
@@ -453,6 +464,8 @@ public:
 	int read(uint8_t* begin, uint8_t* end) override {
 		boost::system::error_code err;
 		++g_net2->countReads;
+		// Completions of zero copy sends wake up readers too, so this is a good time to collect them
+		reapZeroCopySends();
 		size_t toRead = end - begin;
 		size_t size = socket.read_some(boost::asio::mutable_buffers_1(begin, toRead), err);
 		g_net2->bytesReceived += size;
@@ -504,6 +517,59 @@ public:
 		return sent;
 	}
 
+	// Sends at least ZERO_COPY_SEND_MIN_BYTES with MSG_ZEROCOPY, so that the kernel transmits straight out of the packet
+	// buffers instead of copying them into socket buffers. The buffers are referenced until the kernel reports that it
+	// is done with them. Smaller writes, and kernels that do not support it, take the usual copying path.
+	int writePacketBuffers(PacketBuffer* data, int limit) override {
+#ifdef FLOW_ZERO_COPY_SEND
+		if (zeroCopy) {
+			reapZeroCopySends();
+
+			PacketBuffer* buffers[64];
+			iovec iov[64];
+			int count = 0;
+			int total = 0;
+			for (PacketBuffer* p = data; p && total < limit && count < 64; p = p->nextPacketBuffer()) {
+				int len = std::min(p->bytes_unsent(), limit - total);
+				if (len > 0) {
+					buffers[count] = p;
+					iov[count].iov_base = p->data() + p->bytes_sent;
+					iov[count].iov_len = len;
+					++count;
+					total += len;
+				}
+			}
+
+			if (total >= FLOW_KNOBS->ZERO_COPY_SEND_MIN_BYTES) {
+				++g_net2->countWrites;
+				msghdr msg = {};
+				msg.msg_iov = iov;
+				msg.msg_iovlen = count;
+				ssize_t sent = ::sendmsg(socket.native_handle(), &msg, MSG_ZEROCOPY | MSG_DONTWAIT | MSG_NOSIGNAL);
+				if (sent > 0) {
+					ZeroCopySend& send = zeroCopySends.emplace_back();
+					send.id = nextZeroCopyId++;
+					for (int i = 0, covered = 0; i < count && covered < sent; covered += iov[i++].iov_len) {
+						buffers[i]->addref();
+						send.buffers.push_back(buffers[i]);
+					}
+					return sent;
+				}
+				if (errno == EAGAIN || errno == EWOULDBLOCK) {
+					++g_net2->countWouldBlock;
+					return 0;
+				}
+				// ENOBUFS means the socket has too many zero copy sends outstanding, so this one is copied instead
+				if (errno != ENOBUFS) {
+					onWriteError(boost::system::error_code(errno, boost::system::system_category()));
+					throw connection_failed();
+				}
+			}
+		}
+#endif
+		return write(data, limit);
+	}
+
 	NetworkAddress getPeerAddress() const override { return peer_address; }
 
 	UID getDebugID() const override { return id; }
@@ -515,6 +581,65 @@ private:
 	tcp::socket socket;
 	NetworkAddress peer_address;
 
+	// Buffers of sends made with MSG_ZEROCOPY that the kernel may still be reading. The kernel numbers these sends
+	// consecutively per socket from 0 and reports their completion in ranges on the socket's error queue.
+	struct ZeroCopySend {
+		uint32_t id;
+		bool done = false;
+		std::vector<PacketBuffer*> buffers;
+	};
+	std::deque<ZeroCopySend> zeroCopySends;
+	uint32_t nextZeroCopyId = 0;
+	bool zeroCopy = false;
+
+	void reapZeroCopySends() {
+#ifdef FLOW_ZERO_COPY_SEND
+		if (zeroCopySends.empty()) {
+			return;
+		}
+		loop {
+			char control[128];
+			msghdr msg = {};
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+			if (::recvmsg(socket.native_handle(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+				break;
+			}
+			for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+				if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+				    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+					continue;
+				}
+				auto const* err = reinterpret_cast<sock_extended_err const*>(CMSG_DATA(cm));
+				if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+					continue;
+				}
+				// [ee_info, ee_data] is the inclusive range of completed send ids, which may wrap around
+				for (auto& send : zeroCopySends) {
+					if (send.id - err->ee_info <= err->ee_data - err->ee_info) {
+						send.done = true;
+					}
+				}
+			}
+		}
+		while (!zeroCopySends.empty() && zeroCopySends.front().done) {
+			for (auto b : zeroCopySends.front().buffers) {
+				b->delref();
+			}
+			zeroCopySends.pop_front();
+		}
+#endif
+	}
+
+	void releaseZeroCopySends() {
+		for (auto& send : zeroCopySends) {
+			for (auto b : send.buffers) {
+				b->delref();
+			}
+		}
+		zeroCopySends.clear();
+	}
+
 	void init() {
 		// Socket settings that have to be set after connect or accept succeeds
 		socket.non_blocking(true);
@@ -529,10 +654,25 @@ private:
 #endif
 		}
 		platform::setCloseOnExec(socket.native_handle());
+#ifdef FLOW_ZERO_COPY_SEND
+		if (FLOW_KNOBS->ZERO_COPY_SEND_MIN_BYTES > 0) {
+			int one = 1;
+			zeroCopy = setsockopt(socket.native_handle(), SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+			if (!zeroCopy) {
+				TraceEvent(SevWarn, "N2_InitWarn").suppressFor(60.0).detail("Message", "SO_ZEROCOPY not supported");
+			}
+		}
+#endif
 	}
 
 	void closeSocket() {
 		boost::system::error_code error;
+		reapZeroCopySends();
+		if (!zeroCopySends.empty() && socket.is_open()) {
+			// Reset rather than gracefully close the connection, so that the kernel drops what it still holds of our
+			// buffers and they can be released
+			socket.set_option(boost::asio::socket_base::linger(true, 0), error);
+		}
 		socket.close(error);
 		if (error)
 			TraceEvent(SevWarn, "N2_CloseError", id)
@@ -20,6 +20,10 @@
 
 #include "flow/Net2Packet.h"
 
+int IConnection::writePacketBuffers(PacketBuffer* buffer, int limit) {
+	return write(buffer, limit);
+}
+
 void PacketWriter::init(PacketBuffer* buf, ReliablePacket* reliable) {
 	this->buffer = buf;
 	this->reliable = reliable;
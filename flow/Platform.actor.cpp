@@ -2127,6 +2127,48 @@ void setAffinity(int proc) {
 #endif
 }
 
+int getAffinityProcessorLimit() {
+#if defined(_WIN32)
+	return 8 * sizeof(DWORD_PTR);
+#elif defined(__linux__) || defined(__FreeBSD__)
+	return CPU_SETSIZE;
+#else
+	return 0;
+#endif
+}
+
+bool setAffinity(std::vector<int> const& procs) {
+#if defined(_WIN32)
+	DWORD_PTR mask = 0;
+	for (int proc : procs) {
+		if (proc < 0 || proc >= getAffinityProcessorLimit())
+			return false;
+		mask |= DWORD_PTR(1) << proc;
+	}
+	return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int proc : procs) {
+		if (proc < 0 || proc >= CPU_SETSIZE)
+			return false;
+		CPU_SET(proc, &set);
+	}
+	return sched_setaffinity(0, sizeof(cpu_set_t), &set) == 0;
+#elif defined(__FreeBSD__)
+	cpuset_t set;
+	CPU_ZERO(&set);
+	for (int proc : procs) {
+		if (proc < 0 || proc >= CPU_SETSIZE)
+			return false;
+		CPU_SET(proc, &set);
+	}
+	return cpuset_setaffinity(CPU_LEVEL_WHICH, CPU_WHICH_TID, -1, sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
 namespace platform {
 
 int getRandomSeed() {
@@ -290,6 +290,13 @@ void* allocate(size_t length, bool allowLargePages);
 
 void setAffinity(int proc);
 
+// Restricts the calling thread, and threads it creates afterwards, to the given processors. Returns false if the
+// platform does not support it or rejects the set.
+bool setAffinity(std::vector<int> const& procs);
+
+// Processors passed to setAffinity() must be less than this
+int getAffinityProcessorLimit();
+
 void threadSleep(double seconds);
 
 void threadYield(); // Attempt to yield to other processes or threads
@@ -72,6 +72,7 @@ SystemStatistics customSystemMonitor(std::string const& eventName, StatisticsSta
 	NetworkData netData;
 	netData.init();
 	if (!g_network->isSimulated() && currentStats.initialized) {
+		int64_t releasedSlabMemory = releaseUnusedFastAllocatorSlabs();
 		{
 			TraceEvent(eventName.c_str())
 			    .detail("Elapsed", currentStats.elapsed)
@@ -159,6 +160,7 @@ SystemStatistics customSystemMonitor(std::string const& eventName, StatisticsSta
 			    .DETAILALLOCATORMEMUSAGE(4096)
 			    .DETAILALLOCATORMEMUSAGE(8192)
 			    .detail("HugeArenaMemory", g_hugeArenaMemory.load())
+			    .detail("ArenaBlockPoolMemory", g_arenaBlockPoolMemory.load())
 			    .detail("DCID", machineState.dcId)
 			    .detail("ZoneID", machineState.zoneId)
 			    .detail("MachineID", machineState.machineId);
@@ -193,9 +195,15 @@ SystemStatistics customSystemMonitor(std::string const& eventName, StatisticsSta
 				TraceEvent("FastAllocMemoryUsage")
 				    .detail("TotalMemory", total_memory)
 				    .detail("UnusedMemory", unused_memory)
-				    .detail("Utilization", format("%f%%", (total_memory - unused_memory) * 100.0 / total_memory));
+				    .detail("Utilization", format("%f%%", (total_memory - unused_memory) * 100.0 / total_memory))
+				    .detail("SlabMemory", getTotalSlabMemory())
+				    .detail("SlabFragmentedMemory", getTotalSlabFragmentedMemory())
+				    .detail("ReleasedSlabMemory", releasedSlabMemory)
+				    .detail("TotalReleasedSlabMemory", getTotalReleasedSlabMemory());
 			}
 
+			ArenaProfile::traceAll();
+
 			TraceEvent n("NetworkMetrics");
 			n.detail("Elapsed", currentStats.elapsed)
 			    .detail("CantSleep", netData.countCantSleep - statState->networkState.countCantSleep)
@@ -23,6 +23,7 @@
 #include "flow/Knobs.h"
 #include "flow/XmlTraceLogFormatter.h"
 #include "flow/JsonTraceLogFormatter.h"
+#include "flow/BinaryTraceLogFormatter.h"
 #include "flow/flow.h"
 #include "flow/DeterministicRandom.h"
 #include <stdlib.h>
@@ -248,11 +249,11 @@ public:
 		struct WriteBuffer final : TypedAction<WriterThread, WriteBuffer> {
 			std::vector<TraceEventFields> events;
 
-			WriteBuffer(std::vector<TraceEventFields> events) : events(events) {}
+			WriteBuffer(std::vector<TraceEventFields> events) : events(std::move(events)) {}
 			double getTimeEstimate() const override { return .001; }
 		};
 		void action(WriteBuffer& a) {
-			for (auto event : a.events) {
+			for (auto const& event : a.events) {
 				event.validateFormat();
 				logWriter->write(formatter->formatEvent(event));
 			}
@@ -389,10 +390,17 @@ public:
 			return;
 		}
 
+		if (trackError) {
+			latestEventCache.setLatestError(fields);
+		}
+		if (!trackLatestKey.empty()) {
+			latestEventCache.set(trackLatestKey, fields);
+		}
+
 		// FIXME: What if we are using way too much memory for buffer?
 		ASSERT(!isOpen() || fields.isAnnotated());
-		eventBuffer.push_back(fields);
 		bufferLength += fields.sizeBytes();
+		eventBuffer.push_back(std::move(fields));
 
 		// If we have queued up a large number of events in simulation, then throw an error. This makes it easier to
 		// diagnose cases where we get stuck in a loop logging trace events that eventually runs out of memory.
@@ -404,13 +412,6 @@ public:
 			bufferLength = 0;
 			ASSERT(false);
 		}
-
-		if (trackError) {
-			latestEventCache.setLatestError(fields);
-		}
-		if (!trackLatestKey.empty()) {
-			latestEventCache.set(trackLatestKey, fields);
-		}
 	}
 
 	void log(int severity, const char* name, UID id, uint64_t event_ts) {
@@ -654,6 +655,11 @@ bool traceFormatImpl(std::string& format) {
 			g_traceLog.formatter = Reference<ITraceLogFormatter>(new JsonTraceLogFormatter());
 		}
 		return true;
+	} else if (format == "binary") {
+		if (!validate) {
+			g_traceLog.formatter = Reference<ITraceLogFormatter>(new BinaryTraceLogFormatter());
+		}
+		return true;
 	} else {
 		if (!validate) {
 			g_traceLog.formatter = Reference<ITraceLogFormatter>(new XmlTraceLogFormatter());
@@ -1237,7 +1243,7 @@ void TraceEvent::log() {
 					TraceEvent::eventCounts[severity / 10]++;
 				}
 
-				g_traceLog.writeEvent(fields, trackingKey, severity > SevWarnAlways);
+				g_traceLog.writeEvent(std::move(fields), trackingKey, severity > SevWarnAlways);
 
 				if (g_traceLog.isOpen()) {
 					// Log Metrics
@@ -451,8 +451,9 @@ public:
 	virtual Future<int64_t> read() = 0;
 };
 
-// forward declare SendBuffer, declared in serialize.h
+// forward declare SendBuffer and PacketBuffer, declared in serialize.h
 class SendBuffer;
+struct PacketBuffer;
 
 class IConnection {
 public:
@@ -489,6 +490,10 @@ public:
 	// the first buffer in the chain.
 	virtual int write(SendBuffer const* buffer, int limit = std::numeric_limits<int>::max()) = 0;
 
+	// Like write(), but the connection may keep references to the PacketBuffers it sends after returning, so that it
+	// can hand them to the kernel without copying. Callers must not change bytes that have been written.
+	virtual int writePacketBuffers(PacketBuffer* buffer, int limit = std::numeric_limits<int>::max());
+
 	// Returns the network address and port of the other end of the connection.  In the case of an incoming connection,
 	// this may not be an address we can connect to!
 	virtual NetworkAddress getPeerAddress() const = 0;